@@ -17,9 +17,11 @@
  */
 
 #include <getopt.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "cwctl.h"
 #include "script-asset.h"
@@ -43,13 +45,21 @@ static char *screen_help =
     "  get <PROPERTY>\n"
     "       get the property of a screen\n"
     "\n"
+    "  frames\n"
+    "       show the frame timing statistics of a screen\n"
+    "\n"
+    "  trace <PATH>\n"
+    "       write the recent frames of every screen as chrome trace event "
+    "JSON\n"
+    "\n"
     "Options:\n"
     "  -h, --help   get the property of a screen\n"
     "  -f, --filter specify which output name for get,set,toggle to apply. "
     "default is 'focused' output, use '*' for every output\n"
     "\n"
     "Example:\n"
-    "  cwctl screen -f 'eDP-1' set enabled false\n";
+    "  cwctl screen -f 'eDP-1' set enabled false\n"
+    "  cwctl screen -f '*' frames\n";
 ;
 
 static struct option screen_long_opt[] = {
@@ -106,9 +116,46 @@ static void handle_get(int cmd_argcount, int argc, char **argv, char *script)
     repl(script);
 }
 
+static void handle_frames(char *script)
+{
+    snprintf(formatted, 99, "return scr_frames('%s')\n", filter);
+    strcat(script, formatted);
+    repl(script);
+}
+
+static void handle_trace(int cmd_argcount, int argc, char **argv, char *script)
+{
+    if (cmd_argcount < 1) {
+        fprintf(stderr, "missing path argument\n");
+        return;
+    }
+
+    // the file is written by the compositor so make it relative to our cwd
+    char path[PATH_MAX] = {0};
+    char *arg           = argv[optind + 1];
+    if (arg[0] != '/') {
+        if (!getcwd(path, sizeof(path) - 1)) {
+            perror("getcwd");
+            return;
+        }
+        strcat(path, "/");
+    }
+
+    if (strlen(path) + strlen(arg) >= sizeof(path)) {
+        fprintf(stderr, "path is too long\n");
+        return;
+    }
+    strcat(path, arg);
+
+    strcat(script, "return scr_trace([[");
+    strcat(script, path);
+    strcat(script, "]])\n");
+    repl(script);
+}
+
 int screen_cmd(int argc, char **argv)
 {
-    char *script = calloc(1, _cwctl_script_screen_lua_len + 100);
+    char *script = calloc(1, _cwctl_script_screen_lua_len + 100 + PATH_MAX);
     strcpy(script, (char *)_cwctl_script_screen_lua);
 
     int c;
@@ -141,6 +188,10 @@ int screen_cmd(int argc, char **argv)
         handle_set(cmd_argcount, argc, argv, script);
     } else if (strcmp(command, "get") == 0) {
         handle_get(cmd_argcount, argc, argv, script);
+    } else if (strcmp(command, "frames") == 0) {
+        handle_frames(script);
+    } else if (strcmp(command, "trace") == 0) {
+        handle_trace(cmd_argcount, argc, argv, script);
     } else if (strcmp(command, "help") == 0) {
         puts(screen_help);
     } else {
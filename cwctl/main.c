@@ -39,6 +39,8 @@ static char *help_txt =
     "  -s, --socket     path to cwc ipc socket\n"
     "  -c, --command    evaluate lua expression without entering repl\n"
     "  -f, --file       evaluate lua script from file\n"
+    "  -w, --watch      print the signals as they are emitted, separated by\n"
+    "                   comma (e.g. client::new,client::focus)\n"
     "\n"
     "Commands:\n"
     "  client    Get all client information\n"
@@ -47,12 +49,14 @@ static char *help_txt =
     "  plugin    Get all loaded plugin information\n"
     "  input     Get all input information\n"
     "  reload    Reload currently running cwc session\n"
+    "  ipc       Show ipc eval cache statistic\n"
     "  help      Help about any command/subcommand\n"
     "  version   Print cwc version\n"
     "\n"
     "Example:\n"
     "  cwctl -s /tmp/cwc.sock -c 'return cwc.client.focused().title'\n"
     "  cwctl -f ./show-all-client.lua\n"
+    "  cwctl -w client::focus,screen::prop::active_tag\n"
     "  cwctl screen\n"
     "  cwctl -s /tmp/cwc.sock screen --filter 'DP-1' set enabled false";
 
@@ -61,6 +65,7 @@ static struct option long_options[] = {
     {"socket",  ARG,    NULL, 's'},
     {"command", ARG,    NULL, 'c'},
     {"file",    ARG,    NULL, 'f'},
+    {"watch",   ARG,    NULL, 'w'},
     {NULL,      0,      NULL, 0  },
 };
 
@@ -69,6 +74,87 @@ static char *input       = NULL;
 static char *result      = NULL;
 static int client_fd     = 0;
 
+static bool send_all(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t sent = send(fd, buf, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+
+        if (sent <= 0)
+            return false;
+
+        buf += sent;
+        len -= sent;
+    }
+
+    return true;
+}
+
+static bool recv_all(int fd, char *buf, size_t len)
+{
+    while (len) {
+        ssize_t received = recv(fd, buf, len, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+
+        if (received <= 0)
+            return false;
+
+        buf += received;
+        len -= received;
+    }
+
+    return true;
+}
+
+/* read one message into result, return the body length or -1 on error */
+static int recv_message(int fd, enum cwc_ipc_opcode *opcode)
+{
+    if (!recv_all(fd, result, HEADER_SIZE) || !check_header(result))
+        return -1;
+
+    ipc_get_body(result, opcode);
+    uint32_t body_len = ipc_get_body_length(result);
+    if (body_len > IPC_MAX_BODY
+        || !recv_all(fd, result + HEADER_SIZE, body_len))
+        return -1;
+
+    return body_len;
+}
+
+static int watch(char *signals)
+{
+    for (char *c = signals; *c; c++)
+        if (*c == ',')
+            *c = ' ';
+
+    int msg_size =
+        ipc_create_message(result, IPC_MAX_MESSAGE, IPC_SUBSCRIBE, signals);
+    if (msg_size < 0 || !send_all(client_fd, result, msg_size))
+        return 1;
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    int body_len;
+    enum cwc_ipc_opcode opcode;
+    while ((body_len = recv_message(client_fd, &opcode)) >= 0) {
+        if (opcode != IPC_SIGNAL)
+            continue;
+
+        // one line per signal: name<tab>args
+        char *body = result + HEADER_SIZE;
+        char *nl   = memchr(body, '\n', body_len);
+        if (nl)
+            *nl = '\t';
+
+        fwrite(body, 1, body_len, stdout);
+        putchar('\n');
+    }
+
+    return 0;
+}
+
 void repl(char *cmd)
 {
     int cfd = client_fd;
@@ -87,21 +173,26 @@ void repl(char *cmd)
         if (strlen(input) == 1)
             goto new_prompt;
 
-        int msg_size = ipc_create_message(result, BUFFER_SIZE, IPC_EVAL, input);
-        send(cfd, result, msg_size, 0);
+        int msg_size =
+            ipc_create_message(result, IPC_MAX_MESSAGE, IPC_EVAL, input);
+        if (msg_size < 0 || !send_all(cfd, result, msg_size)) {
+            fprintf(stderr, "failed to send the message\n");
+            return;
+        }
 
-        int res_len = 0;
+        int body_len = 0;
         enum cwc_ipc_opcode opcode;
-        const char *ipc_body = NULL;
         do {
-            res_len  = recv(cfd, result, BUFFER_SIZE, 0);
-            ipc_body = ipc_get_body(result, &opcode);
-        } while (opcode != IPC_EVAL_RESPONSE);
+            body_len = recv_message(cfd, &opcode);
+        } while (body_len >= 0 && opcode != IPC_EVAL_RESPONSE);
 
-        if (res_len - HEADER_SIZE == 0) {
+        if (body_len < 0) {
+            fprintf(stderr, "connection closed\n");
+            return;
+        } else if (body_len == 0) {
             printf("<empty>");
         } else {
-            write(1, ipc_body, res_len - HEADER_SIZE);
+            write(1, result + HEADER_SIZE, body_len);
         }
 
         putchar('\n');
@@ -134,6 +225,10 @@ static int object_command(int argc, char **argv)
         repl((char *)_cwctl_script_input_lua);
     } else if (strcmp(command, "reload") == 0) {
         repl("return cwc.reload()");
+    } else if (strcmp(command, "ipc") == 0) {
+        repl("local s = cwc.ipc_cache_stats() "
+             "return string.format('eval cache: %d hits, %d misses, %d cached',"
+             " s.hits, s.misses, s.size)");
     } else if (strcmp(command, "version") == 0) {
         repl("return cwc.get_version()");
     } else {
@@ -149,12 +244,14 @@ static int object_command(int argc, char **argv)
 
 int main(int argc, char **argv)
 {
-    socket_path = getenv("CWC_SOCK");
-    char *cmd   = NULL;
-    char *file  = NULL;
+    socket_path         = getenv("CWC_SOCK");
+    char *cmd           = NULL;
+    char *file          = NULL;
+    char *watch_signals = NULL;
 
     int c;
-    while ((c = getopt_long(argc, argv, "+hs:c:f:", long_options, NULL)) != -1)
+    while ((c = getopt_long(argc, argv, "+hs:c:f:w:", long_options, NULL))
+           != -1)
         switch (c) {
         case 's':
             socket_path = optarg;
@@ -168,6 +265,9 @@ int main(int argc, char **argv)
         case 'f':
             file = optarg;
             break;
+        case 'w':
+            watch_signals = optarg;
+            break;
         default:
             puts(help_txt);
             return 1;
@@ -193,7 +293,13 @@ int main(int argc, char **argv)
     }
 
     input  = malloc(BUFFER_SIZE + 1);
-    result = malloc(BUFFER_SIZE + 1);
+    result = malloc(IPC_MAX_MESSAGE + 1);
+
+    if (watch_signals && input && result) {
+        int ret = watch(watch_signals);
+        close(client_fd);
+        return ret;
+    }
 
     int any_error = object_command(argc, argv);
 
@@ -210,7 +316,7 @@ int main(int argc, char **argv)
         if (!fstream)
             goto error_cleanup;
 
-        fread(input, 1, BUFFER_SIZE, fstream);
+        input[fread(input, 1, BUFFER_SIZE, fstream)] = '\0';
         fclose(fstream);
         cmd = input;
     }
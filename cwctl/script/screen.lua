@@ -138,3 +138,54 @@ local function scr_get(filter, key)
 
     return out
 end
+
+local function scr_frames(filter)
+    local scrs = cwc.screen.get()
+    local focused = cwc.screen.focused()
+
+    local template =
+        "[%d] %s:\n" ..
+        "\tFrames: %d\n" ..
+        "\tRendered: %d\n" ..
+        "\tSkipped: %d\n" ..
+        "\tHeld for resize: %d\n" ..
+        "\tBuild failed: %d\n" ..
+        "\tCommit failed: %d\n" ..
+        "\tTearing page flip: %d\n" ..
+        "\tFrame time (last %d rendered):\n" ..
+        "\t\tmean: %.1f us\n" ..
+        "\t\tp50: %.1f us\n" ..
+        "\t\tp99: %.1f us\n" ..
+        "\t\tmax: %.1f us\n" ..
+        ""
+
+    local out = ""
+    for i, s in pairs(scrs) do
+        if filter == "*" or filter == s.name
+            or (filter == "focused" and s == focused) then
+            local st = s:frame_stats()
+            local ft = st.frame_time
+            out = out .. template:format(
+                i, s.name,
+                st.frames,
+                st.rendered,
+                st.skipped,
+                st.held,
+                st.build_failed,
+                st.commit_failed,
+                st.tearing,
+                ft.count, ft.mean, ft.p50, ft.p99, ft.max
+            )
+        end
+    end
+
+    return out
+end
+
+local function scr_trace(path)
+    if not cwc.screen.export_frame_trace(path) then
+        return "error: cannot write frame trace to " .. path
+    end
+
+    return "frame trace written to " .. path
+end
@@ -24,6 +24,7 @@ struct cwc_config {
     int cursor_inactive_timeout;                 // milisecond
     int cursor_edge_threshold;                   // px
     float cursor_edge_snapping_overlay_color[4]; // rgba
+    bool cursor_coalesce_motion;
 
     // kbd
     int repeat_rate;
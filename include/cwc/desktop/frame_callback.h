@@ -0,0 +1,50 @@
+#ifndef _CWC_FRAME_CALLBACK_H
+#define _CWC_FRAME_CALLBACK_H
+
+#include <lua.h>
+#include <stdbool.h>
+#include <wayland-util.h>
+
+struct cwc_output;
+
+/* lua function called right before the output renders a frame. It only runs
+ * when it has been requested since the last call so an idle widget doesn't
+ * wake up the output.
+ */
+struct cwc_frame_callback {
+    struct wl_list link; // cwc_output.frame_callbacks
+    int id;
+    int cb_ref;   // object registry
+    int data_ref; // object registry, 0 if no data
+    bool dirty;
+    bool visited; // already reached by the ongoing dispatch
+    bool removed; // removed while dispatching, freed after the dispatch
+};
+
+/* register the function at func_idx with optional data at data_idx (0 for
+ * none), return the callback id.
+ */
+int cwc_frame_callback_add(lua_State *L,
+                           struct cwc_output *output,
+                           int func_idx,
+                           int data_idx);
+
+/* mark the callback dirty and schedule a frame, return false if the id doesn't
+ * exist. During the dispatch a callback that is not visited yet still runs in
+ * the current frame.
+ */
+bool cwc_frame_callback_request(struct cwc_output *output, int id);
+
+bool cwc_frame_callback_remove(struct cwc_output *output, int id);
+
+/* call every dirty callback, must be called in the output frame event before
+ * rendering.
+ */
+void cwc_frame_callback_dispatch(struct cwc_output *output);
+
+/* free all the callbacks, used when the output is destroyed or the lua state
+ * is about to be closed.
+ */
+void cwc_frame_callback_clear(struct cwc_output *output);
+
+#endif // !_CWC_FRAME_CALLBACK_H
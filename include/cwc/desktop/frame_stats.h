@@ -0,0 +1,115 @@
+#ifndef _CWC_FRAME_STATS_H
+#define _CWC_FRAME_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+struct cwc_output;
+
+/* frame records kept per output, the oldest is overwritten */
+#define CWC_FRAME_STATS_LEN 256
+
+enum cwc_frame_result {
+    CWC_FRAME_RENDERED = 0,
+    CWC_FRAME_SKIPPED,       // scene has no damage
+    CWC_FRAME_HELD,          // held until the resizing clients commit
+    CWC_FRAME_BUILD_FAILED,  // wlr_scene_output_build_state failed
+    CWC_FRAME_COMMIT_FAILED, // page flip failed
+
+    CWC_FRAME_RESULT_LENGTH,
+};
+
+/* in the order they run in the output frame event */
+enum cwc_frame_phase {
+    CWC_FRAME_PHASE_CURSOR,  // pending cursor move flush
+    CWC_FRAME_PHASE_LUA,     // lua frame callbacks
+    CWC_FRAME_PHASE_OPACITY, // opacity pass of the scene
+    CWC_FRAME_PHASE_BUILD,   // wlr_scene_output_build_state
+    CWC_FRAME_PHASE_COMMIT,  // output test and commit
+    CWC_FRAME_PHASE_DONE,    // frame done sent to the surfaces
+
+    CWC_FRAME_PHASE_LENGTH,
+};
+
+struct cwc_frame_record {
+    uint64_t start_ns; // CLOCK_MONOTONIC
+    uint32_t phase_ns[CWC_FRAME_PHASE_LENGTH];
+    uint8_t result; // enum cwc_frame_result
+    bool tearing;   // committed with tearing page flip
+    bool tearing_rejected; // tearing test failed and committed without it
+};
+
+struct cwc_frame_stats {
+    struct cwc_frame_record records[CWC_FRAME_STATS_LEN];
+
+    /* total frame event, the next record is at frames % CWC_FRAME_STATS_LEN */
+    uint64_t frames;
+    uint64_t results[CWC_FRAME_RESULT_LENGTH];
+    uint64_t tearing;
+};
+
+/* summary of the rendered frames still in the ring, in nanoseconds */
+struct cwc_frame_summary {
+    uint32_t count;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+/* timer of the frame in progress, lives on the stack of the frame event */
+struct cwc_frame_timer {
+    struct cwc_frame_record record;
+    uint64_t last_ns;
+};
+
+static inline uint64_t cwc_frame_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void cwc_frame_timer_start(struct cwc_frame_timer *timer)
+{
+    *timer                 = (struct cwc_frame_timer){0};
+    timer->last_ns         = cwc_frame_now_ns();
+    timer->record.start_ns = timer->last_ns;
+}
+
+/* account the time since the previous lap to the phase */
+static inline void cwc_frame_timer_lap(struct cwc_frame_timer *timer,
+                                       enum cwc_frame_phase phase)
+{
+    uint64_t now = cwc_frame_now_ns();
+    timer->record.phase_ns[phase] += now - timer->last_ns;
+    timer->last_ns = now;
+}
+
+/* push the record to the output ring */
+void cwc_frame_timer_finish(struct cwc_frame_timer *timer,
+                            struct cwc_output *output);
+
+/* total duration of the record */
+uint64_t cwc_frame_record_duration(const struct cwc_frame_record *record);
+
+/* return the record by age, 0 is the oldest still in the ring, or NULL */
+const struct cwc_frame_record *
+cwc_frame_stats_record_at(const struct cwc_frame_stats *stats, uint32_t idx);
+
+/* record count still in the ring */
+uint32_t cwc_frame_stats_record_count(const struct cwc_frame_stats *stats);
+
+void cwc_frame_stats_summarize(const struct cwc_frame_stats *stats,
+                               struct cwc_frame_summary *summary);
+
+const char *cwc_frame_result_name(enum cwc_frame_result result);
+const char *cwc_frame_phase_name(enum cwc_frame_phase phase);
+
+/* write every output records as chrome trace event JSON, one track per output.
+ * Return false if the file can't be written.
+ */
+bool cwc_frame_stats_export_trace(const char *path);
+
+#endif // !_CWC_FRAME_STATS_H
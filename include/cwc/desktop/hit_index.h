@@ -0,0 +1,38 @@
+#ifndef _CWC_HIT_INDEX_H
+#define _CWC_HIT_INDEX_H
+
+#include <wlr/types/wlr_scene.h>
+
+struct cwc_output;
+struct cwc_container;
+
+/* mark the index outdated, it will be rebuilt on the next lookup. Call it when
+ * the visibility or the layer of a container changed, or anything that affect
+ * many containers at once such as the output layout.
+ */
+void cwc_hit_index_mark_dirty();
+
+/* move the container to the cells of its current box, call it when the
+ * container geometry changed. Only the old and new cells are touched.
+ */
+void cwc_hit_index_update_container(struct cwc_container *container);
+
+/* call it after the container is raised to the top or lowered to the bottom
+ * of its layer, only the cells it covers are reordered.
+ */
+void cwc_hit_index_raise_container(struct cwc_container *container);
+void cwc_hit_index_lower_container(struct cwc_container *container);
+
+/* equivalent to wlr_scene_node_at on the scene root but the toplevel layers
+ * only check the containers that overlap the point.
+ */
+struct wlr_scene_node *
+cwc_scene_node_at(double lx, double ly, double *sx, double *sy);
+
+/* visible tiled container which box contains the point */
+struct cwc_container *cwc_hit_index_tiled_container_at(double lx, double ly);
+
+/* free the output grid */
+void cwc_hit_index_output_fini(struct cwc_output *output);
+
+#endif // !_CWC_HIT_INDEX_H
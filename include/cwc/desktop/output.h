@@ -6,6 +6,8 @@
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/util/box.h>
 
+#include "cwc/desktop/frame_stats.h"
+#include "cwc/luaobject.h"
 #include "cwc/types.h"
 
 struct cwc_server;
@@ -20,6 +22,17 @@ struct cwc_output_state {
     struct wl_list containers;  // cwc_container.link_output_container
     struct wl_list minimized;   // cwc_container.link_output_minimized
 
+    /* NULL terminated tiled toplevels for the master layout, the storage is
+     * reused across arrange.
+     */
+    struct wl_array tiled; // struct cwc_toplevel *
+
+    // cached lua table of the lists above
+    struct luaC_snapshot toplevels_snapshot;
+    struct luaC_snapshot containers_snapshot;
+    struct luaC_snapshot focus_stack_snapshot;
+    struct luaC_snapshot minimized_snapshot;
+
     struct cwc_output *output;
     struct cwc_output *old_output;
 
@@ -52,7 +65,25 @@ struct cwc_output {
     bool tearing_allowed;
     bool enabled;
 
-    struct timespec waiting_since;
+    /* configure of the relayout that the toplevels haven't committed yet, the
+     * frame is held until it's empty. Managed by transaction.c
+     */
+    struct wl_list pending_configures; // cwc_toplevel.pending_configure.link
+    struct wl_event_source *configure_timer;
+
+    /* scene node visited by the opacity pass in the last frame */
+    uint32_t opacity_nodes_visited;
+
+    /* container grid for hit testing, managed by hit_index.c */
+    struct cwc_hit_index *hit_index;
+
+    /* lua callback called before rendering, managed by frame_callback.c */
+    struct wl_list frame_callbacks; // cwc_frame_callback.link
+    bool frame_callbacks_pending;
+    bool frame_callbacks_dispatching;
+
+    /* timing ring of the frame event, managed by frame_stats.c */
+    struct cwc_frame_stats frame_stats;
 
     struct wlr_session_lock_surface_v1 *lock_surface;
 
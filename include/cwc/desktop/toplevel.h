@@ -65,7 +65,14 @@ struct cwc_toplevel {
     bool mapped;
     bool tearing_hint;
     bool urgent;
-    uint32_t resize_serial;
+
+    /* configure waited by the output, managed by transaction.c */
+    struct {
+        struct cwc_output *output; // NULL when nothing is waited
+        uint32_t serial;
+        uint64_t deadline_msec;
+        struct wl_list link; // cwc_output.pending_configures
+    } pending_configure;
 
     char *xdg_tag;
     char *xdg_description;
@@ -108,6 +115,9 @@ struct cwc_popup {
 
 void on_new_xdg_popup(struct wl_listener *listener, void *data);
 
+/* return the toplevel that owns the popup chain, NULL if not a toplevel */
+struct cwc_toplevel *wlr_xdg_popup_get_cwc_toplevel(struct wlr_xdg_popup *popup);
+
 void cwc_toplevel_focus(struct cwc_toplevel *toplevel, bool raise);
 struct cwc_toplevel *cwc_toplevel_get_focused();
 
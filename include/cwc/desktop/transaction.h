@@ -3,10 +3,30 @@
 
 #include "cwc/desktop/output.h"
 
+struct cwc_toplevel;
+
 void transaction_schedule_output(struct cwc_output *output);
 void transaction_schedule_tag(struct cwc_tag_info *tag);
 
 void transaction_pause();
 void transaction_resume();
 
+/* Add the configure to the transaction of the toplevel output. The output
+ * frame is held until every toplevel in it commits its configure or its own
+ * timeout expires, other outputs keep rendering.
+ */
+void transaction_add_configure(struct cwc_toplevel *toplevel, uint32_t serial);
+
+/* check the committed configure serial of the toplevel */
+void transaction_toplevel_commit(struct cwc_toplevel *toplevel);
+
+/* stop waiting for the toplevel e.g. when unmapped */
+void transaction_remove_toplevel(struct cwc_toplevel *toplevel);
+
+/* return true if nothing is waited and the output can render */
+bool transaction_output_ready(struct cwc_output *output);
+
+void transaction_output_init(struct cwc_output *output);
+void transaction_output_fini(struct cwc_output *output);
+
 #endif // !_CWC_TRANSACTION_H
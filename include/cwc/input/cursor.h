@@ -34,6 +34,20 @@ struct hyprcursor_buffer {
     cairo_surface_t *surface;
 };
 
+/* decoded hyprcursor shape, kept in the cursor shape cache */
+struct hyprcursor_shape {
+    struct wl_list link; // struct cwc_cursor.shape_cache
+
+    // key
+    char *name;
+    uint32_t size;
+    float scale;
+
+    hyprcursor_cursor_image_data **images;
+    int images_count;
+    struct wl_array buffers; // struct hyprcursor_buffer *
+};
+
 struct bsp_grab {
     struct bsp_node *horizontal;
     struct bsp_node *vertical;
@@ -66,10 +80,10 @@ struct cwc_cursor {
 
     // hyprcursor
     struct hyprcursor_cursor_style_info info;
-    hyprcursor_cursor_image_data **images;
-    int images_count;
-    int frame_index; // point to animation frame in cursor_buffers
-    struct wl_array cursor_buffers; // struct hyprcursor_buffer *
+    struct hyprcursor_shape *shape; // current shape, owned by the cache
+    struct wl_list shape_cache;     // LRU, most recently used first
+    int shape_cache_len;
+    int frame_index; // point to animation frame in the shape buffers
     struct wl_event_source *animation_timer;
     float scale;
 
@@ -79,6 +93,15 @@ struct cwc_cursor {
     bool send_events;
     struct cwc_output *last_output;
 
+    // pointer::move accumulated until the next frame of the output
+    struct {
+        struct cwc_output *output; // NULL when nothing is pending
+        uint32_t time_msec;
+        uint32_t samples;
+        double dx, dy;
+        double dx_unaccel, dy_unaccel;
+    } pending_move;
+
     // cursor inactive timeout
     bool hidden;
     const char *name_before_hidden;
@@ -151,6 +174,10 @@ void cwc_cursor_update_scale(struct cwc_cursor *cursor);
 
 void cwc_cursor_notify_activity(struct cwc_cursor *cursor);
 
+/* emit the coalesced pointer::move of the cursors waiting for the output frame
+ */
+void cwc_cursor_flush_pending_move(struct cwc_output *output);
+
 /* change style (mainly size)
  *
  * return true if success
@@ -158,6 +185,11 @@ void cwc_cursor_notify_activity(struct cwc_cursor *cursor);
 bool cwc_cursor_hyprcursor_change_style(
     struct cwc_cursor *cursor, struct hyprcursor_cursor_style_info info);
 
+/* decode the shapes ahead so the first switch to them doesn't need to wait.
+ * The array is NULL terminated, pass NULL to load the commonly used shapes.
+ */
+void cwc_cursor_prewarm_shapes(struct cwc_cursor *cursor, const char **names);
+
 void cwc_cursor_send_axis(struct cwc_cursor *cursor,
                           double delta,
                           int delta_discrete,
@@ -197,6 +229,7 @@ struct cwc_pointer_move_event {
     double dy;
     double dx_unaccel;
     double dy_unaccel;
+    uint32_t samples; // motion event merged when coalesced, otherwise 1
 };
 
 struct cwc_pointer_button_event {
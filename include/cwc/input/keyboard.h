@@ -9,6 +9,9 @@
 struct cwc_server;
 struct wlr_keyboard;
 
+/* linux KEY_MAX is 0x2ff, plus the xkb offset of 8 */
+#define CWC_HANDLED_KEYCODE_MAX 1024
+
 struct cwc_keyboard {
     struct wl_list link;
     struct wlr_keyboard *wlr_kbd;
@@ -25,10 +28,22 @@ struct cwc_keyboard_group {
     bool send_events;
     int layout_idx;
 
-    struct cwc_vec *handled_tracker;
+    // bitset of xkb keycode consumed by a keybinding on press
+    uint64_t handled_keys[CWC_HANDLED_KEYCODE_MAX / 64];
+
+    /* keycode to untransformed keysym for each layout, rebuilt on keymap
+     * change so that keybinding lookup doesn't need to create xkb_state.
+     */
+    struct {
+        xkb_keysym_t *syms; // [layout * keycode_count + keycode - min_keycode]
+        xkb_keycode_t min_keycode;
+        xkb_keycode_t keycode_count;
+        xkb_layout_index_t num_layouts;
+    } keysym_table;
 
     struct wl_listener modifiers_l;
     struct wl_listener key_l;
+    struct wl_listener keymap_l;
 
     struct wl_listener config_commit_l; // for native
 };
@@ -55,6 +70,12 @@ void cwc_keyboard_update_keymap(struct wlr_keyboard *wlr_kbd);
 void cwc_keyboard_group_set_xkb_layout(struct cwc_keyboard_group *kbd_group,
                                        int idx);
 
+/* keysym without any modifier applied, XKB_KEY_NoSymbol if not found */
+xkb_keysym_t
+cwc_keyboard_group_get_base_keysym(struct cwc_keyboard_group *kbd_group,
+                                   xkb_keycode_t keycode,
+                                   xkb_layout_index_t layout);
+
 void cwc_keyboard_group_update_modifiers(struct cwc_keyboard_group *kbd_group,
                                          uint32_t depressed,
                                          uint32_t latched_mods,
@@ -107,6 +128,7 @@ struct cwc_keybind_map {
     bool active;
     struct wl_event_source *repeat_timer;
     struct cwc_keybind_info *repeated_bind;
+    struct wl_list repeat_link; // linked while repeated_bind is set
 };
 
 static inline uint32_t kbindinfo_key_get_modifier(uint64_t genkey)
@@ -126,6 +148,12 @@ void cwc_keybind_map_clear(struct cwc_keybind_map *kmap);
 
 void cwc_keybind_map_stop_repeat(struct cwc_keybind_map *kmap);
 
+/* mark the merged index of the keyboard maps outdated, it will be rebuilt on
+ * the next key event. Call it when a map is created, destroyed, cleared,
+ * (de)activated, or a binding is added/removed.
+ */
+void cwc_keybind_index_mark_dirty();
+
 struct lua_State;
 int cwc_keybind_map_register_bind_from_lua(struct lua_State *L,
                                            struct cwc_keybind_map *kmap);
@@ -156,6 +184,17 @@ bool keybind_kbd_execute(struct cwc_keybind_map *kmap,
                          uint32_t modifiers,
                          xkb_keysym_t key,
                          bool press);
+/* execute the binding of the default keyboard map and every active map with
+ * a single lookup, true if any of the binding consume the key.
+ */
+bool keybind_kbd_dispatch(struct cwc_seat *seat,
+                          uint32_t modifiers,
+                          xkb_keysym_t key,
+                          bool press);
+
+/* stop the repeat of every keyboard map */
+void keybind_kbd_stop_repeat();
+
 bool keybind_mouse_execute(struct cwc_keybind_map *kmap,
                            uint32_t modifiers,
                            uint32_t button,
@@ -1,20 +1,27 @@
 #ifndef _CWC_IPC_H
 #define _CWC_IPC_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /* The ipc messaging format is:
  *
  * ```
  * cwc-ipc\n
  * <opcode>\n
- * body...
+ * <length>body...
  * ```
  *
  * The first line contain the signature which is "cwc-ipc", the second line
- * contain a byte of opcode, and the rest is the message body.
+ * contain a byte of opcode, followed by 4 bytes little endian body length and
+ * the message body. The body is not null terminated and a stream may contain
+ * several messages back to back.
  */
 
-#define IPC_HEADER  "cwc-ipc"
-#define HEADER_SIZE (sizeof(IPC_HEADER) + 2)
+#define IPC_HEADER      "cwc-ipc"
+#define HEADER_SIZE     (sizeof(IPC_HEADER) + 2 + 4)
+#define IPC_MAX_BODY    (1 << 20)
+#define IPC_MAX_MESSAGE (HEADER_SIZE + IPC_MAX_BODY)
 
 /* Opcode is 1 byte after header */
 enum cwc_ipc_opcode {
@@ -23,8 +30,17 @@ enum cwc_ipc_opcode {
     /* the compositor response of IPC_EVAL */
     IPC_EVAL_RESPONSE,
 
-    /* compositor object signal such client, screen, etc. */
+    /* compositor object signal such client, screen, etc. The body is the
+     * signal name, a newline, and the tostring of the signal arguments
+     * separated by a tab.
+     */
     IPC_SIGNAL,
+
+    /* start/stop receiving IPC_SIGNAL, the body is the signal names separated
+     * by whitespace.
+     */
+    IPC_SUBSCRIBE,
+    IPC_UNSUBSCRIBE,
 };
 
 /* check if msg header is valid */
@@ -43,7 +59,35 @@ int ipc_create_message(char *dest,
                        enum cwc_ipc_opcode opcode,
                        const char *body);
 
+/* write the message header for a body of length n, dest must be at least
+ * HEADER_SIZE.
+ */
+void ipc_write_header(char *dest, enum cwc_ipc_opcode opcode, uint32_t n);
+
 /* return a pointer to the message body (a slice) in msg.  */
 const char *ipc_get_body(const char *msg, enum cwc_ipc_opcode *opcode);
 
+/* body length of the message, the header must be valid */
+uint32_t ipc_get_body_length(const char *msg);
+
+/* return the full message size if msg of length len contain a complete
+ * message, 0 if it need more data, and -1 if the message is invalid.
+ */
+int ipc_message_size(const char *msg, int len);
+
+//=================== SERVER SIDE ======================
+
+struct lua_State;
+struct cwc_signal_entry;
+
+/* send the signal to the subscribed ipc clients, the lua arguments is at the
+ * top of the stack.
+ */
+void ipc_broadcast_signal(struct cwc_signal_entry *entry,
+                          struct lua_State *L,
+                          int nargs);
+
+/* counter of the compiled IPC_EVAL chunk cache */
+void ipc_eval_cache_stats(uint64_t *hits, uint64_t *misses, int *count);
+
 #endif // !_CWC_IPC_H
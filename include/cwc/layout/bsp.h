@@ -41,6 +41,15 @@ struct bsp_node {
      * this node.
      */
     int width, height;
+
+    /* the node or one of its descendant need to be recomputed */
+    bool dirty;
+
+    /* leaf only, container size and border width after the last configure.
+     * Zero width means the container is not configured by the layout yet.
+     */
+    int configured_width, configured_height;
+    int configured_bw;
 };
 
 /* insert container to the bsp tree, container must not be already in a tree.
@@ -63,9 +72,15 @@ void bsp_node_disable(struct bsp_node *node);
 
 struct bsp_node *bsp_get_root(struct bsp_node *node);
 
-/* update the bsp in O(n) complexity */
+/* mark the node and its ancestor to be recomputed on the next update */
+void bsp_node_mark_dirty(struct bsp_node *node);
+
+/* walk the whole tree and configure the leaf which geometry changed */
 void bsp_update_root(struct cwc_output *output, int workspace);
 
+/* only recompute the dirty subtree */
+void bsp_update_dirty(struct cwc_output *output, int workspace);
+
 void bsp_last_focused_update(struct cwc_container *container);
 
 struct bsp_root_entry *
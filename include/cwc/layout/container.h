@@ -18,11 +18,10 @@ enum container_state_mask {
     CONTAINER_STATE_RESIZING   = 1 << 7, // resized by interactive resize
 };
 
-struct border_buffer {
-    struct wlr_buffer base;
-    struct _cairo_surface *surface;
-    struct wlr_scene_buffer *scene;
-};
+/* rasterized border pattern shared by borders that have the same pattern,
+ * rotation, and thickness. Defined in container.c.
+ */
+struct border_tile;
 
 struct cwc_border {
     enum cwc_data_type type;
@@ -31,10 +30,15 @@ struct cwc_border {
 
     int pattern_rotation; // in degree
     struct _cairo_pattern *pattern;
+    float color[4]; // premultiplied color of a solid pattern
+    bool solid;
     bool enabled;
 
+    struct border_tile *tile;
     struct wlr_scene_tree *attached_tree;
-    struct border_buffer *buffer[4]; // clockwise top to left
+    struct wlr_scene_tree *tree;
+    struct wlr_scene_buffer *corner[4]; // clockwise top left to bottom left
+    struct wlr_scene_node *edge[4];     // clockwise top to left
 };
 
 void cwc_border_init(struct cwc_border *border,
@@ -62,6 +66,9 @@ void cwc_border_set_thickness(struct cwc_border *border, int thickness);
 /* noop if the surface width unchanged */
 void cwc_border_resize(struct cwc_border *border, int rect_w, int rect_h);
 
+/* solid border is a rect so the opacity need to be baked to the color */
+void cwc_border_set_opacity(struct cwc_border *border, float opacity);
+
 struct cwc_container {
     enum cwc_data_type type;
     struct wl_list link;
@@ -96,6 +103,14 @@ struct cwc_container {
     struct wl_list link_output_container; // cwc_output_state.containers
     struct wl_list link_output_fstack;    // cwc_output.state.focus_stack
     struct wl_list link_output_minimized; // cwc_output.state.minimized
+    struct wl_list link_opacity_dirty;    // server.opacity_dirty
+
+    /* managed by hit_index.c */
+    struct {
+        bool indexed;          // present in the output grids
+        uint64_t order;        // stacking order in the grid, lower is above
+        struct wlr_box extent; // area the container is indexed with
+    } hit;
 };
 
 void cwc_container_init(struct cwc_output *output,
@@ -243,4 +258,7 @@ static inline float cwc_container_get_opacity(struct cwc_container *container)
 
 void cwc_container_set_opacity(struct cwc_container *container, float opacity);
 
+/* queue the container subtree for opacity recalculation at the next frame */
+void cwc_container_mark_opacity_dirty(struct cwc_container *container);
+
 #endif // !_CWC_CONTAINER_H
@@ -24,22 +24,28 @@
 
 #include <lauxlib.h>
 #include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 extern const char *const LUAC_OBJECT_REGISTRY_KEY;
 extern const char *const LUAC_OBJECT_UDATA_REGISTRY_KEY;
 
+/* luaL_ref of the registry tables in LUA_REGISTRYINDEX, the tables can still
+ * be accessed with the string key but the ref avoid hashing the string.
+ */
+extern int luaC_object_registry_ref;
+extern int luaC_object_udata_registry_ref;
+
 /* get the object registry table */
 static inline void luaC_object_registry_push(lua_State *L)
 {
-    lua_pushstring(L, LUAC_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luaC_object_registry_ref);
 }
 
 /* get the object user data registry table */
 static inline void luaC_object_data_registry_push(lua_State *L)
 {
-    lua_pushstring(L, LUAC_OBJECT_UDATA_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_rawgeti(L, LUA_REGISTRYINDEX, luaC_object_udata_registry_ref);
 }
 
 /* put a lua object at idx to the object registry with the pointer as key */
@@ -131,4 +137,29 @@ static inline int luaC_object_udata_push(lua_State *L, const void *pointer)
     return 1;
 }
 
+/* cached array of lua object built from a list, it's valid as long as the list
+ * generation doesn't change.
+ */
+struct luaC_snapshot {
+    int ref;             // table in the lua registry, 0 if not built yet
+    uint64_t epoch;      // lua state the table belongs to
+    uint64_t generation; // list generation when the table is built
+};
+
+/* push a copy of the snapshot table if it's still valid, return false and
+ * push nothing otherwise.
+ */
+bool luaC_snapshot_push(lua_State *L,
+                        struct luaC_snapshot *snapshot,
+                        uint64_t generation);
+
+/* store a copy of the array at the top of the stack as the snapshot, the
+ * stack is unchanged.
+ */
+void luaC_snapshot_save(lua_State *L,
+                        struct luaC_snapshot *snapshot,
+                        uint64_t generation);
+
+void luaC_snapshot_stats(uint64_t *hits, uint64_t *misses);
+
 #endif // !_CWC_LUAOBJECT_H
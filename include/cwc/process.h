@@ -9,6 +9,21 @@ enum cwc_process_type {
     CWC_PROCESS_TYPE_C,
 };
 
+/* how stdout/stderr is delivered to the io callback */
+enum cwc_process_output_mode {
+    CWC_PROCESS_OUTPUT_RAW,  // whatever has been read in one wakeup
+    CWC_PROCESS_OUTPUT_LINE, // complete lines, lua get a table of lines
+    CWC_PROCESS_OUTPUT_EXIT, // everything at once before the exit callback
+};
+
+/* what to discard when the buffered output exceed max_buffer, only happen in
+ * exit mode since the other modes stop reading and let the pipe fill up.
+ */
+enum cwc_process_overflow {
+    CWC_PROCESS_OVERFLOW_DROP_OLDEST,
+    CWC_PROCESS_OVERFLOW_DROP_NEWEST,
+};
+
 struct spawn_obj;
 
 struct cwc_process_callback_info {
@@ -30,6 +45,20 @@ struct cwc_process_callback_info {
         void *data;
         int luaref_data;
     };
+
+    enum cwc_process_output_mode mode;
+    enum cwc_process_overflow overflow;
+    size_t max_buffer; // per stream, 0 for default
+};
+
+/* ring buffer for one output pipe of the child */
+struct cwc_process_stream {
+    int fd; // -1 when closed
+    struct wl_event_source *source;
+
+    char *buf; // capacity + 1 for the nul terminator
+    size_t capacity, head, len;
+    size_t dropped; // bytes discarded by the overflow policy
 };
 
 struct spawn_obj {
@@ -38,8 +67,7 @@ struct spawn_obj {
     struct cwc_process_callback_info *info;
 
     struct {
-        int pipefd_out, pipefd_err;
-        struct wl_event_source *out, *err;
+        struct cwc_process_stream out, err;
     } CWC_PRIVATE;
 };
 
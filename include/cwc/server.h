@@ -1,6 +1,7 @@
 #ifndef _CWC_SERVER_H
 #define _CWC_SERVER_H
 
+#include <stdint.h>
 #include <wayland-server-core.h>
 
 enum server_init_return_code {
@@ -47,6 +48,8 @@ struct cwc_server {
     struct wlr_output_power_manager_v1 *output_power_manager;
     struct wl_listener opm_set_mode_l;
 
+    struct wl_listener new_surface_l; // alpha modifier tracking
+
     struct wlr_xdg_shell *xdg_shell;
     struct wl_listener new_xdg_toplevel_l;
     struct wl_listener new_xdg_popup_l;
@@ -130,6 +133,17 @@ struct cwc_server {
     struct wl_list layer_shells; // cwc_layer_surface.link
     struct wl_list kbd_kmaps;    // cwc_keybind_map.link
     struct wl_list timers;       // cwc_timer.link
+    struct wl_list opacity_dirty; // cwc_container.link_opacity_dirty
+
+    /* incremented when the list changed, the lua snapshot of the list is
+     * reused until then.
+     */
+    struct {
+        uint64_t toplevels;   // toplevels, output toplevels, container owner
+        uint64_t containers;  // output containers
+        uint64_t focus_stack; // output focus_stack and front toplevel
+        uint64_t minimized;   // output minimized and front toplevel
+    } list_generation;
 
     // maps
     struct cwc_hhmap *output_state_cache;    // struct cwc_output_state
@@ -140,7 +154,7 @@ struct cwc_server {
     // server wide state
     struct cwc_container *insert_marked; // managed by container.c
     struct cwc_output *focused_output;   // managed by output.c
-    int resize_count;                    // frame synchronization
+    bool scene_opacity_dirty;            // managed by output.c
 };
 
 /* global server instance from main */
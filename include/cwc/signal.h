@@ -2,6 +2,8 @@
 #define _CWC_SIGNAL_H
 
 #include <lua.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <wayland-util.h>
 
 #include "cwc/luaobject.h"
@@ -19,10 +21,49 @@ struct signal_lua_callback {
 };
 
 struct cwc_signal_entry {
+    char *name;
     struct wl_list c_callbacks;   // struct signal_c_callback.link
     struct wl_list lua_callbacks; // struct signal_lua_callback.link
+    uint32_t ipc_subscribers;     // ipc client subscribed to this signal
 };
 
+/* resolved signal name, the entry is never freed until the compositor exit so
+ * it's safe to keep the handle in a static variable.
+ */
+typedef struct cwc_signal_entry *cwc_signal_handle_t;
+
+/* resolve the signal name once so the emitter doesn't need to hash the name
+ * every emission, calling it again with the same name return the same handle.
+ */
+cwc_signal_handle_t cwc_signal_intern(const char *name);
+
+/* like cwc_signal_intern but doesn't create the entry, return NULL if no one
+ * ever used the signal name.
+ */
+cwc_signal_handle_t cwc_signal_lookup(const char *name);
+
+/* check whether there's any C or lua listener connected to the signal, useful
+ * to skip preparing the lua stack when no one is listening.
+ */
+static inline bool cwc_signal_has_listeners(cwc_signal_handle_t handle)
+{
+    return !wl_list_empty(&handle->c_callbacks)
+           || !wl_list_empty(&handle->lua_callbacks)
+           || handle->ipc_subscribers;
+}
+
+/* handle variant of cwc_signal_connect/cwc_signal_disconnect */
+void cwc_signal_connect_handle(cwc_signal_handle_t handle,
+                               signal_callback_t callback);
+void cwc_signal_disconnect_handle(cwc_signal_handle_t handle,
+                                  signal_callback_t callback);
+
+/* handle variant of cwc_signal_emit */
+void cwc_signal_emit_handle(cwc_signal_handle_t handle,
+                            void *data,
+                            lua_State *L,
+                            int nargs);
+
 /* Register a listener for C function */
 void cwc_signal_connect(const char *name, signal_callback_t callback);
 
@@ -63,6 +104,13 @@ int cwc_object_emit_signal_simple(const char *name,
                                   lua_State *L,
                                   void *pointer);
 
+/* handle variant of cwc_object_emit_signal_simple, the object won't be pushed
+ * when there's no listener.
+ */
+int cwc_object_emit_signal_handle_simple(cwc_signal_handle_t handle,
+                                         lua_State *L,
+                                         void *pointer);
+
 /* the C listener data arg is a list of what is passed as by the varargs ... */
 void cwc_object_emit_signal_varr(const char *name,
                                  lua_State *L,
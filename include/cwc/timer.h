@@ -1,12 +1,52 @@
 #ifndef _CWC_TIMER_H
 #define _CWC_TIMER_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <wayland-server-core.h>
 
+/* entry of the timer wheel, all the timers share one event loop timer so
+ * timers that expire at the same millisecond only wake the compositor once.
+ */
+struct cwc_timer_entry {
+    struct wl_list link; // wheel slot, empty when not scheduled
+    uint64_t expires;    // monotonic time in milliseconds
+    void (*notify)(struct cwc_timer_entry *entry);
+};
+
+struct cwc_timer_wheel_stats {
+    uint32_t active;           // scheduled entries
+    uint64_t wakeups;          // event loop timer dispatch
+    uint64_t fired;            // expired entries
+    double wakeups_per_second; // measured in the last one second window
+};
+
+/* initialize the entry before using it */
+void cwc_timer_entry_init(struct cwc_timer_entry *entry,
+                          void (*notify)(struct cwc_timer_entry *entry));
+
+/* (re)schedule the entry to expire in timeout_ms. The expiry is rounded up to
+ * the multiple of slack_ms so the entries with the same slack and close
+ * deadline expire together, zero slack means no rounding.
+ */
+void cwc_timer_entry_schedule(struct cwc_timer_entry *entry,
+                              uint32_t timeout_ms,
+                              uint32_t slack_ms);
+
+void cwc_timer_entry_cancel(struct cwc_timer_entry *entry);
+
+static inline bool cwc_timer_entry_is_scheduled(struct cwc_timer_entry *entry)
+{
+    return !wl_list_empty(&entry->link);
+}
+
+void cwc_timer_wheel_get_stats(struct cwc_timer_wheel_stats *stats);
+
 struct cwc_timer {
-    struct wl_list link;
-    struct wl_event_source *timer;
+    struct wl_list link; // server.timers
+    struct cwc_timer_entry entry;
     double timeout_ms;
+    uint32_t slack_ms;
     bool started;
     bool single_shot;
     bool one_shot;
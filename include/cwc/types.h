@@ -73,6 +73,7 @@ enum cwc_layout_mode {
 struct bsp_root_entry {
     struct bsp_node *root; // NULL indicate empty bsp
     struct cwc_container *last_focused;
+    uint32_t configure_count; // configure sent by the last relayout
 };
 
 struct master_state {
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <wayland-util.h>
 #include <wlr/types/wlr_output_layout.h>
@@ -12,58 +14,60 @@
 //====================== DSA ======================
 
 struct hhash_entry {
-    /* next colliding element in singly linked list */
-    struct hhash_entry *next;
     /* hash result, 0 if entry is unoccupied */
     uint64_t hash;
     /* user data */
     void *data;
+    /* copy of the key, only for map created with cwc_hhmap_create_keyed */
+    void *key;
+    uint32_t key_len;
 };
 
-/* hhmap or hybrid hash map designed for read operation at big table although
- * the data integrity is questionable since the hash collision is not handled
- * which mean it contradict the purpose. Currently the hash
- * collision that produced from xxhash is not yet found with 20 million hash
- * entry with number as a string for the key.
+/* hhmap is a swiss table style open addressing hash map. Every slot has a
+ * control byte which is either empty, deleted, or the low 7 bits of the hash
+ * when it's occupied. Lookup compares a whole group of control bytes at once
+ * (SSE2 or NEON, plain 64-bit arithmetic otherwise) so the entries are only
+ * touched when the 7 bits match.
  *
- * Frequent insert+remove will cause chaos
- * in the linked list logic and may cause infinite loop if it not rehashed. The
- * automatic rehash is available to overcome this with reference count overhead.
+ * The plain map only stores and compares the 64-bit xxhash so two colliding
+ * keys alias each other, no collision has been found so far with 20 million
+ * number as a string keys. Map created with cwc_hhmap_create_keyed keep a copy
+ * of the key and compare it for exact equality.
  *
- * Linear probing is used for finding empty block, and chaining is used for
- * lookup operation using singly linked list that point to other element in
- * the table, so in theory it got better cache locality and faster lookup but
- * hey that's just theory, a ~~game~~ programming theory!
+ * Removed entry leave a tombstone in the control byte, they are cleaned when
+ * the table runs out of empty slots and rehashed in place or grown. The table
+ * never shrink.
  *
- * The performance is twice as slow in small table but become competitive the
- * bigger the table is.
+ * Iterate with table[0] until table[alloc - 1], the entry is occupied when the
+ * hash is not 0. Insertion may rehash so don't insert while iterating.
  */
 struct cwc_hhmap {
     /* filled entry count */
     uint64_t size;
 
-    /* allocated length (in size, not bytes) */
+    /* slot count, always power of two */
     uint64_t alloc;
 
-    /* expensive div/mul cache, must changed after rehashing */
-    uint64_t expand_at_size_exceed; // alloc * 3/4
-    uint64_t shrink_at_size_behind; // alloc / 5
+    /* insertion to an empty slot left before it need to rehash */
+    uint64_t growth_left;
 
-#ifdef HHMAP_AUTOMATIC_REHASH
-    uint32_t rehash_at_remove_counter_exceed;
-    uint32_t remove_counter;
-#endif // HHMAP_AUTOMATIC_REHASH
+    /* store the key for exact comparison */
+    bool keyed;
+
+    /* control byte of each slot, the first group is mirrored at the end */
+    uint8_t *ctrl;
 
     /* pointer to the array of hash entry */
     struct hhash_entry *table;
 };
 
-/* if prealloc_size < 8 it will still 8 entries allocated */
+/* if prealloc_size < 16 it will still 16 entries allocated */
 struct cwc_hhmap *cwc_hhmap_create(int prealloc_size);
+struct cwc_hhmap *cwc_hhmap_create_keyed(int prealloc_size);
 
 void cwc_hhmap_destroy(struct cwc_hhmap *map);
 
-/* insert element */
+/* insert element, replace the data if the key exists */
 void cwc_hhmap_insert(struct cwc_hhmap *map, const char *key, void *data);
 void cwc_hhmap_ninsert(struct cwc_hhmap *map,
                        void *key,
@@ -83,33 +87,122 @@ cwc_hhmap_nget_entry(struct cwc_hhmap *map, const void *key, int key_len);
 void cwc_hhmap_remove(struct cwc_hhmap *map, const char *key);
 void cwc_hhmap_nremove(struct cwc_hhmap *map, const void *key, int key_len);
 
-/* rehash(map->alloc) will reset the linked list */
+/* rebuild the table with at least new_size slots dropping the tombstones */
 void __cwc_hhmap_rehash_to_size(struct cwc_hhmap *map, uint64_t new_size);
 
-struct cwc_vec {
-    /* element count */
-    uint64_t count;
-
-    /* allocated element count (not bytes) */
-    uint64_t alloc;
-
-    /* element size in bytes */
-    uint64_t elem_sizeof;
-
-    /* pointer to the array */
-    void *data;
-};
-
-struct cwc_vec *cwc_vec_create(int size, int reserved);
-void cwc_vec_destroy(struct cwc_vec *vec);
-
-bool cwc_vec_push(struct cwc_vec *vec, void *data);
-bool cwc_vec_push_at(struct cwc_vec *vec, size_t idx, void *data);
-void cwc_vec_pop(struct cwc_vec *vec);
-void cwc_vec_pop_at(struct cwc_vec *vec, size_t idx);
-
-void *cwc_vec_at(struct cwc_vec *vec, size_t idx);
-int cwc_vec_find(struct cwc_vec *vec, void *value);
+/* typed dynamic array, CWC_VEC_DEFINE(name, type, inline_count) generates
+ * struct name and the name_* functions below. The first inline_count elements
+ * are stored in the struct itself so a small vector never allocate, it only
+ * moves to the heap when it grows past that.
+ *
+ * data point to the inline storage at first so don't copy the struct, and the
+ * pointer returned by name_at is invalidated by the next push or insert.
+ *
+ * CWC_VEC_DEFINE_SCALAR additionally generates name_find for integer and
+ * pointer element which compare a whole 16 bytes at once with SSE2 or NEON.
+ */
+#define CWC_VEC_DEFINE(name, type, inline_count)                               \
+    struct name {                                                              \
+        size_t count;                                                          \
+        size_t alloc;                                                          \
+        type *data;                                                            \
+        type inline_data[inline_count];                                        \
+    };                                                                         \
+                                                                               \
+    static inline void name##_init(struct name *vec)                           \
+    {                                                                          \
+        vec->count = 0;                                                        \
+        vec->alloc = inline_count;                                             \
+        vec->data  = vec->inline_data;                                         \
+    }                                                                          \
+                                                                               \
+    static inline void name##_fini(struct name *vec)                           \
+    {                                                                          \
+        if (vec->data != vec->inline_data)                                     \
+            free(vec->data);                                                   \
+        name##_init(vec);                                                      \
+    }                                                                          \
+                                                                               \
+    static inline bool name##_reserve(struct name *vec, size_t alloc)          \
+    {                                                                          \
+        if (alloc <= vec->alloc)                                               \
+            return true;                                                       \
+        return __cwc_vec_grow((void **)&vec->data, &vec->alloc, alloc,         \
+                              sizeof(type), vec->inline_data, vec->count);     \
+    }                                                                          \
+                                                                               \
+    static inline void name##_clear(struct name *vec)                          \
+    {                                                                          \
+        vec->count = 0;                                                        \
+    }                                                                          \
+                                                                               \
+    static inline type *name##_at(struct name *vec, size_t idx)                \
+    {                                                                          \
+        __cwc_vec_bound_check(idx, vec->count);                                \
+        return &vec->data[idx];                                                \
+    }                                                                          \
+                                                                               \
+    static inline bool name##_push(struct name *vec, type value)               \
+    {                                                                          \
+        if (vec->count == vec->alloc && !name##_reserve(vec, vec->count + 1))  \
+            return false;                                                      \
+        vec->data[vec->count++] = value;                                       \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline bool name##_insert(struct name *vec, size_t idx, type value) \
+    {                                                                          \
+        __cwc_vec_bound_check(idx, vec->count + 1);                            \
+        if (vec->count == vec->alloc && !name##_reserve(vec, vec->count + 1))  \
+            return false;                                                      \
+        memmove(&vec->data[idx + 1], &vec->data[idx],                          \
+                (vec->count - idx) * sizeof(type));                            \
+        vec->data[idx] = value;                                                \
+        vec->count++;                                                          \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static inline type name##_pop(struct name *vec)                            \
+    {                                                                          \
+        __cwc_vec_bound_check(0, vec->count);                                  \
+        return vec->data[--vec->count];                                        \
+    }                                                                          \
+                                                                               \
+    static inline void name##_erase(struct name *vec, size_t idx)              \
+    {                                                                          \
+        __cwc_vec_bound_check(idx, vec->count);                                \
+        vec->count--;                                                          \
+        memmove(&vec->data[idx], &vec->data[idx + 1],                          \
+                (vec->count - idx) * sizeof(type));                            \
+    }
+
+/* return the index of the first element equal to value or -1 */
+#define CWC_VEC_DEFINE_SCALAR(name, type, inline_count)                        \
+    CWC_VEC_DEFINE(name, type, inline_count)                                   \
+                                                                               \
+    static inline ptrdiff_t name##_find(const struct name *vec, type value)    \
+    {                                                                          \
+        return __cwc_vec_find(vec->data, vec->count, sizeof(type), &value);    \
+    }
+
+#define cwc_vec_for_each(pos, vec)                                             \
+    for (pos = (vec)->data; pos < (vec)->data + (vec)->count; pos++)
+
+bool __cwc_vec_grow(void **data,
+                    size_t *alloc,
+                    size_t min_alloc,
+                    size_t elem_size,
+                    void *inline_data,
+                    size_t count);
+
+ptrdiff_t
+__cwc_vec_find(const void *data, size_t count, size_t elem_size, void *value);
+
+#ifdef NDEBUG
+static inline void __cwc_vec_bound_check(size_t idx, size_t count) {}
+#else
+void __cwc_vec_bound_check(size_t idx, size_t count);
+#endif
 
 bool wl_list_length_at_least(struct wl_list *list, int more_than_or_equal_to);
 
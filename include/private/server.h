@@ -43,3 +43,6 @@ extern void cleanup_ipc(struct cwc_server *s);
 
 extern void setup_process(struct cwc_server *s);
 extern void cleanup_process(struct cwc_server *s);
+
+extern void setup_timer_wheel(struct cwc_server *s);
+extern void cleanup_timer_wheel(struct cwc_server *s);
@@ -144,6 +144,15 @@ end
 -- @tparam table cursor_edge_snapping_overlay_color
 -- @propertydefault {0.1, 0.2, 0.4, 0.1}
 
+--- Merge the pointer motion into one `pointer::move` signal per output frame.
+--
+-- The signal is emitted with the summed delta and the number of motion event
+-- merged. Useful when the `pointer::move` callback is heavy and the mouse has a
+-- high polling rate.
+--
+-- @config cursor_coalesce_motion
+-- @tparam[opt=false] boolean cursor_coalesce_motion
+
 --- Keyboard repeat rate in hz.
 -- @config repeat_rate
 -- @tparam[opt=30] integer repeat_rate
@@ -202,6 +211,7 @@ local sanity_check = {
     cursor_inactive_timeout            = config.check_positive,
     cursor_edge_threshold              = config.check_positive,
     cursor_edge_snapping_overlay_color = check_rgba,
+    cursor_coalesce_motion             = "boolean",
 
     repeat_rate                        = config.check_positive,
     repeat_delay                       = config.check_positive,
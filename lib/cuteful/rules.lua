@@ -71,65 +71,204 @@ local M = {}
 local signal_map = {}
 local id_counter = 1
 
-local function match_constraint_kv(obj, key, value)
-    if type(value) == "string" then
-        if tostring(obj[key]):lower():match(value) then
-            return true
+-- compiled form of the rule, keyed by the rule table.
+local compiled_rules = setmetatable({}, { __mode = "k" })
+
+-- constraint kind sorted from the cheapest to the most expensive to check.
+local KIND_EQUAL = 1   -- non string value, compared as is
+local KIND_EXACT = 2   -- "^literal$" pattern, compared as a lowercased string
+local KIND_PLAIN = 3   -- pattern without magic character, plain substring find
+local KIND_PATTERN = 4 -- full lua pattern matching
+
+local MAGIC_CHARS = "[%^%$%(%)%%%.%[%]%*%+%-%?]"
+
+local function compile_constraint(key, value, order)
+    local const = { key = key, value = value, order = order }
+
+    if type(value) ~= "string" then
+        const.kind = KIND_EQUAL
+    elseif not value:find(MAGIC_CHARS) then
+        const.kind = KIND_PLAIN
+    else
+        local literal = value:match("^%^(.*)%$$")
+        if literal and not literal:find(MAGIC_CHARS) then
+            const.kind = KIND_EXACT
+            const.value = literal
+        else
+            const.kind = KIND_PATTERN
         end
-    elseif obj[key] == value then
-        return true
     end
 
-    return false
+    return const
 end
 
-function M.check_rule(obj, rule)
-    -- constraints
-    for const_key, const_val in pairs(rule.where or {}) do
-        if not match_constraint_kv(obj, const_key, const_val) then
-            return false
-        end
+local function sort_constraints(list)
+    table.sort(list, function(a, b)
+        if a.kind ~= b.kind then return a.kind < b.kind end
+        return a.order < b.order
+    end)
+
+    return list
+end
+
+local function compile_kv(tbl)
+    local list = {}
+    for key, value in pairs(tbl or {}) do
+        list[#list + 1] = compile_constraint(key, value, #list)
     end
 
-    if type(rule.where_any) == "table" then
-        local match_any = false
-        for const_key, const_vlist in pairs(rule.where_any) do
-            for _, val in ipairs(const_vlist) do
-                if match_constraint_kv(obj, const_key, val) then
-                    match_any = true
-                    goto matched
-                end
-            end
+    return sort_constraints(list)
+end
+
+local function compile_kvlist(tbl)
+    if type(tbl) ~= "table" then return nil end
+
+    local list = {}
+    for key, vlist in pairs(tbl) do
+        for _, value in ipairs(vlist) do
+            list[#list + 1] = compile_constraint(key, value, #list)
         end
+    end
 
-        ::matched::
-        if not match_any then return false end
+    return sort_constraints(list)
+end
+
+local function compile_rule(rule)
+    local effects = {}
+    for key, value in pairs(rule.set or {}) do
+        effects[#effects + 1] = { key = key, setter = "set_" .. key, value = value }
     end
 
-    for const_key, const_val in pairs(rule.where_not or {}) do
-        if match_constraint_kv(obj, const_key, const_val) then
-            return false
-        end
+    return {
+        where         = compile_kv(rule.where),
+        where_any     = compile_kvlist(rule.where_any),
+        where_not     = compile_kv(rule.where_not),
+        where_not_any = compile_kvlist(rule.where_not_any),
+        effects       = effects,
+    }
+end
+
+local function get_compiled(rule)
+    local compiled = compiled_rules[rule]
+    if not compiled then
+        compiled = compile_rule(rule)
+        compiled_rules[rule] = compiled
     end
 
-    if type(rule.where_not_any) == "table" then
-        local match_any = false
-        for const_key, const_vlist in pairs(rule.where_not_any) do
-            for _, val in ipairs(const_vlist) do
-                if match_constraint_kv(obj, const_key, val) then
-                    match_any = true
-                    goto matched
-                end
-            end
-        end
+    return compiled
+end
+
+-- Object property cache so that each property is fetched and lowercased once
+-- no matter how many rules checking it.
+local NIL = {}
 
-        ::matched::
-        if match_any then return false end
+local function new_cache(obj)
+    return { obj = obj, raw = {}, lower = {} }
+end
+
+local function cache_raw(cache, key)
+    local value = cache.raw[key]
+    if value == nil then
+        value = cache.obj[key]
+        if value == nil then value = NIL end
+        cache.raw[key] = value
+    end
+
+    if value == NIL then return nil end
+    return value
+end
+
+local function cache_lower(cache, key)
+    local value = cache.lower[key]
+    if value == nil then
+        value = tostring(cache_raw(cache, key)):lower()
+        cache.lower[key] = value
+    end
+
+    return value
+end
+
+local function cache_invalidate(cache)
+    cache.raw = {}
+    cache.lower = {}
+end
+
+local function match_constraint(cache, const)
+    local kind = const.kind
+    if kind == KIND_EQUAL then
+        return cache_raw(cache, const.key) == const.value
+    elseif kind == KIND_EXACT then
+        return cache_lower(cache, const.key) == const.value
+    elseif kind == KIND_PLAIN then
+        return cache_lower(cache, const.key):find(const.value, 1, true) ~= nil
+    end
+
+    return cache_lower(cache, const.key):match(const.value) ~= nil
+end
+
+local function match_any(cache, list)
+    for i = 1, #list do
+        if match_constraint(cache, list[i]) then return true end
+    end
+
+    return false
+end
+
+local function check_compiled(cache, compiled)
+    local where = compiled.where
+    for i = 1, #where do
+        if not match_constraint(cache, where[i]) then return false end
+    end
+
+    if match_any(cache, compiled.where_not) then return false end
+
+    if compiled.where_any and not match_any(cache, compiled.where_any) then
+        return false
+    end
+
+    if compiled.where_not_any and match_any(cache, compiled.where_not_any) then
+        return false
     end
 
     return true
 end
 
+local function apply_compiled(cache, rule, compiled)
+    if not check_compiled(cache, compiled) then return end
+
+    local obj = cache.obj
+
+    -- effect
+    local applied = false
+    for _, effect in ipairs(compiled.effects) do
+        if obj[effect.setter] == nil then
+            eprint("property " .. effect.key .. " is either read only or not exist")
+        else
+            obj[effect.key] = effect.value
+            applied = true
+        end
+    end
+
+    -- a setter may change other properties (e.g. fullscreen change geometry)
+    if applied then cache_invalidate(cache) end
+
+    -- callback
+    if rule.run then
+        rule.run(obj)
+        cache_invalidate(cache)
+    end
+end
+
+--- Check whether an object satisfy the rule constraint.
+--
+-- @staticfct check_rule
+-- @tparam cwc_object obj The object to check
+-- @tparam table rule Rule table.
+-- @treturn boolean True if the constraint is satisfied.
+function M.check_rule(obj, rule)
+    return check_compiled(new_cache(obj), compile_rule(rule))
+end
+
 --- Apply rule to an object.
 --
 -- @staticfct apply_rule
@@ -143,22 +282,7 @@ end
 -- @tparam[opt=nil] function rule.run Callback function if the constraint match.
 -- @noreturn
 function M.apply_rule(obj, rule)
-    if not M.check_rule(obj, rule) then return end
-
-    -- effect
-    for effect_k, effect_v in pairs(rule.set or {}) do
-        if obj["set_" .. effect_k] == nil then
-            eprint("property " .. effect_k .. " is either read only or not exist")
-            goto continue
-        end
-
-        obj[effect_k] = effect_v
-
-        ::continue::
-    end
-
-    -- callback
-    if rule.run then rule.run(obj) end
+    apply_compiled(new_cache(obj), rule, compile_rule(rule))
 end
 
 local function add_object_rule(sig, rule)
@@ -167,9 +291,10 @@ local function add_object_rule(sig, rule)
     if signal_map[sig] == nil then
         signal_map[sig] = {}
         cwc.connect_signal(sig, function(obj)
+            local cache = new_cache(obj)
             local saved_rules = signal_map[sig]
             for _, ruleset in ipairs(saved_rules) do
-                M.apply_rule(obj, ruleset)
+                apply_compiled(cache, ruleset, get_compiled(ruleset))
             end
         end)
     end
@@ -179,7 +304,9 @@ end
 
 --- Create a rule for an object.
 --
--- Either `set` or `run` field must be not empty.
+-- Either `set` or `run` field must be not empty. Rules with the same signal share the
+-- object property lookup, constraint without pattern magic character (e.g. `"firefox"`
+-- or `"^firefox$"`) is checked with a plain string comparison.
 --
 -- @staticfct add_rule
 -- @tparam table rule Rule table.
@@ -197,6 +324,10 @@ function M.add_rule(rule)
         id_counter = id_counter + 1
     end
 
+    -- the constraint is compiled once here, modifying it afterward requires
+    -- removing and adding the rule again.
+    compiled_rules[rule] = compile_rule(rule)
+
     for _, sig in ipairs(rule.when) do
         add_object_rule(sig, rule)
     end
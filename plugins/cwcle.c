@@ -14,6 +14,7 @@
 #include <wlr/types/wlr_keyboard.h>
 
 #include "cwc/config.h"
+#include "cwc/desktop/hit_index.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/toplevel.h"
 #include "cwc/input/keyboard.h"
@@ -85,6 +86,7 @@ static void raise_container(struct cwc_container *container)
     cairo_pattern_destroy(raised_pattern);
 
     wlr_scene_node_raise_to_top(&container->tree->node);
+    cwc_hit_index_raise_container(container);
     lifecwcle.raised = container;
 }
 
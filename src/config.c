@@ -84,6 +84,8 @@ static void on_commit(struct wl_listener *listener, void *data)
         g_config.cursor_inactive_timeout = lua_tointeger(L, -1);
     if (luaC_config_get(L, "cursor_edge_threshold"))
         g_config.cursor_edge_threshold = lua_tointeger(L, -1);
+    if (luaC_config_get(L, "cursor_coalesce_motion"))
+        g_config.cursor_coalesce_motion = lua_toboolean(L, -1);
     if (luaC_config_get(L, "cursor_edge_snapping_overlay_color")) {
         for (int i = 0; i < 3; i++) {
             lua_rawgeti(L, -1, i + 1);
@@ -139,6 +141,7 @@ void cwc_config_set_default()
     g_config.cursor_edge_snapping_overlay_color[1] = 0.2;
     g_config.cursor_edge_snapping_overlay_color[2] = 0.4;
     g_config.cursor_edge_snapping_overlay_color[3] = 0.1;
+    g_config.cursor_coalesce_motion                = false;
 
     g_config.repeat_rate  = 30;
     g_config.repeat_delay = 400;
@@ -0,0 +1,183 @@
+/* frame_callback.c - lua callback synchronized with the output frame
+ *
+ * Copyright (C) 2025 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* A widget that redraw itself with a short timer wakes up the compositor even
+ * when nothing changed and the redraw is not aligned with the refresh cycle.
+ * With frame callback the widget request a frame when it's dirty and the
+ * callback is called once in the next output frame event, multiple requests
+ * in the same frame are merged.
+ */
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <stdlib.h>
+#include <wayland-util.h>
+#include <wlr/types/wlr_output.h>
+
+#include "cwc/config.h"
+#include "cwc/desktop/frame_callback.h"
+#include "cwc/desktop/output.h"
+#include "cwc/luaobject.h"
+#include "cwc/util.h"
+
+static int next_id = 1;
+
+static void frame_callback_destroy(lua_State *L, struct cwc_frame_callback *cb)
+{
+    luaC_object_registry_push(L);
+    luaL_unref(L, -1, cb->cb_ref);
+    if (cb->data_ref)
+        luaL_unref(L, -1, cb->data_ref);
+    lua_pop(L, 1);
+
+    wl_list_remove(&cb->link);
+    free(cb);
+}
+
+static struct cwc_frame_callback *frame_callback_get(struct cwc_output *output,
+                                                     int id)
+{
+    struct cwc_frame_callback *cb;
+    wl_list_for_each(cb, &output->frame_callbacks, link)
+    {
+        if (cb->id == id && !cb->removed)
+            return cb;
+    }
+
+    return NULL;
+}
+
+int cwc_frame_callback_add(lua_State *L,
+                           struct cwc_output *output,
+                           int func_idx,
+                           int data_idx)
+{
+    struct cwc_frame_callback *cb = calloc(1, sizeof(*cb));
+    cb->id                        = next_id++;
+
+    luaC_object_registry_push(L);
+    lua_pushvalue(L, func_idx);
+    cb->cb_ref = luaL_ref(L, -2);
+    if (data_idx) {
+        lua_pushvalue(L, data_idx);
+        cb->data_ref = luaL_ref(L, -2);
+    }
+    lua_pop(L, 1);
+
+    wl_list_insert(output->frame_callbacks.prev, &cb->link);
+
+    return cb->id;
+}
+
+bool cwc_frame_callback_request(struct cwc_output *output, int id)
+{
+    struct cwc_frame_callback *cb = frame_callback_get(output, id);
+    if (!cb)
+        return false;
+
+    if (cb->dirty)
+        return true;
+
+    cb->dirty = true;
+
+    // the ongoing dispatch will reach it, no need for another frame
+    if (output->frame_callbacks_dispatching && !cb->visited)
+        return true;
+
+    // requested from an already called callback will run in the next frame
+    if (!output->frame_callbacks_pending) {
+        output->frame_callbacks_pending = true;
+        wlr_output_schedule_frame(output->wlr_output);
+    }
+
+    return true;
+}
+
+bool cwc_frame_callback_remove(struct cwc_output *output, int id)
+{
+    struct cwc_frame_callback *cb = frame_callback_get(output, id);
+    if (!cb)
+        return false;
+
+    if (output->frame_callbacks_dispatching)
+        cb->removed = true;
+    else
+        frame_callback_destroy(g_config_get_lua_State(), cb);
+
+    return true;
+}
+
+void cwc_frame_callback_dispatch(struct cwc_output *output)
+{
+    if (!output->frame_callbacks_pending)
+        return;
+
+    lua_State *L                        = g_config_get_lua_State();
+    output->frame_callbacks_pending     = false;
+    output->frame_callbacks_dispatching = true;
+
+    // the callback added during the dispatch is appended so it's still visited
+    struct cwc_frame_callback *cb;
+    wl_list_for_each(cb, &output->frame_callbacks, link)
+    {
+        cb->visited = true;
+        if (!cb->dirty || cb->removed)
+            continue;
+
+        cb->dirty = false;
+
+        luaC_object_registry_push(L);
+        lua_rawgeti(L, -1, cb->cb_ref);
+        luaC_object_push(L, output);
+        if (cb->data_ref)
+            lua_rawgeti(L, -3, cb->data_ref);
+        else
+            lua_pushnil(L);
+
+        if (lua_pcall(L, 2, 0, 0)) {
+            cwc_log(CWC_ERROR, "frame callback contains error : %s",
+                    lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
+
+        lua_pop(L, 1);
+    }
+
+    output->frame_callbacks_dispatching = false;
+
+    struct cwc_frame_callback *tmp;
+    wl_list_for_each_safe(cb, tmp, &output->frame_callbacks, link)
+    {
+        cb->visited = false;
+        if (cb->removed)
+            frame_callback_destroy(L, cb);
+    }
+}
+
+void cwc_frame_callback_clear(struct cwc_output *output)
+{
+    lua_State *L = g_config_get_lua_State();
+
+    struct cwc_frame_callback *cb, *tmp;
+    wl_list_for_each_safe(cb, tmp, &output->frame_callbacks, link)
+    {
+        frame_callback_destroy(L, cb);
+    }
+
+    output->frame_callbacks_pending = false;
+}
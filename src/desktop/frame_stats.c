@@ -0,0 +1,248 @@
+/* frame_stats.c - per output frame timing
+ *
+ * Copyright (C) 2025 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The frame event laps a stack timer between each phase and push the result to
+ * a fixed ring in the output, recording is just a few clock reads and a copy
+ * so it's always enabled. Anything more expensive (sorting, formatting) is
+ * done only when someone reads the stats.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <wayland-util.h>
+#include <wlr/types/wlr_output.h>
+
+#include "cwc/desktop/frame_stats.h"
+#include "cwc/desktop/output.h"
+#include "cwc/server.h"
+#include "cwc/util.h"
+
+static const char *result_names[CWC_FRAME_RESULT_LENGTH] = {
+    [CWC_FRAME_RENDERED]      = "rendered",
+    [CWC_FRAME_SKIPPED]       = "skipped",
+    [CWC_FRAME_HELD]          = "held",
+    [CWC_FRAME_BUILD_FAILED]  = "build_failed",
+    [CWC_FRAME_COMMIT_FAILED] = "commit_failed",
+};
+
+static const char *phase_names[CWC_FRAME_PHASE_LENGTH] = {
+    [CWC_FRAME_PHASE_CURSOR]  = "cursor",
+    [CWC_FRAME_PHASE_LUA]     = "lua",
+    [CWC_FRAME_PHASE_OPACITY] = "opacity",
+    [CWC_FRAME_PHASE_BUILD]   = "build",
+    [CWC_FRAME_PHASE_COMMIT]  = "commit",
+    [CWC_FRAME_PHASE_DONE]    = "frame_done",
+};
+
+const char *cwc_frame_result_name(enum cwc_frame_result result)
+{
+    if (result >= CWC_FRAME_RESULT_LENGTH)
+        return "unknown";
+
+    return result_names[result];
+}
+
+const char *cwc_frame_phase_name(enum cwc_frame_phase phase)
+{
+    if (phase >= CWC_FRAME_PHASE_LENGTH)
+        return "unknown";
+
+    return phase_names[phase];
+}
+
+void cwc_frame_timer_finish(struct cwc_frame_timer *timer,
+                            struct cwc_output *output)
+{
+    struct cwc_frame_stats *stats = &output->frame_stats;
+
+    stats->records[stats->frames % CWC_FRAME_STATS_LEN] = timer->record;
+    stats->frames++;
+    stats->results[timer->record.result]++;
+    stats->tearing += timer->record.tearing;
+}
+
+uint64_t cwc_frame_record_duration(const struct cwc_frame_record *record)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < CWC_FRAME_PHASE_LENGTH; i++)
+        total += record->phase_ns[i];
+
+    return total;
+}
+
+uint32_t cwc_frame_stats_record_count(const struct cwc_frame_stats *stats)
+{
+    return MIN(stats->frames, CWC_FRAME_STATS_LEN);
+}
+
+const struct cwc_frame_record *
+cwc_frame_stats_record_at(const struct cwc_frame_stats *stats, uint32_t idx)
+{
+    uint32_t count = cwc_frame_stats_record_count(stats);
+    if (idx >= count)
+        return NULL;
+
+    uint64_t oldest = stats->frames - count;
+    return &stats->records[(oldest + idx) % CWC_FRAME_STATS_LEN];
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* nearest rank percentile of a sorted array */
+static uint64_t percentile(const uint64_t *sorted, uint32_t len, int pct)
+{
+    uint32_t rank = (len * pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+void cwc_frame_stats_summarize(const struct cwc_frame_stats *stats,
+                               struct cwc_frame_summary *summary)
+{
+    uint64_t durations[CWC_FRAME_STATS_LEN];
+    uint32_t len   = 0;
+    uint64_t total = 0;
+
+    *summary = (struct cwc_frame_summary){0};
+
+    uint32_t count = cwc_frame_stats_record_count(stats);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct cwc_frame_record *record =
+            cwc_frame_stats_record_at(stats, i);
+        if (record->result != CWC_FRAME_RENDERED)
+            continue;
+
+        durations[len] = cwc_frame_record_duration(record);
+        total += durations[len];
+        len++;
+    }
+
+    if (!len)
+        return;
+
+    qsort(durations, len, sizeof(*durations), compare_u64);
+
+    summary->count = len;
+    summary->mean  = total / len;
+    summary->p50   = percentile(durations, len, 50);
+    summary->p99   = percentile(durations, len, 99);
+    summary->max   = durations[len - 1];
+}
+
+/* output name is from the backend, escape it anyway */
+static void write_json_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', f);
+
+        if ((unsigned char)*str < 0x20)
+            fprintf(f, "\\u%04x", *str);
+        else
+            fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+/* complete event without the closing brace so the caller can add args */
+static void write_event(
+    FILE *f, const char *name, int tid, uint64_t start_ns, uint64_t dur_ns)
+{
+    // chrome trace timestamp is in microseconds
+    fprintf(f,
+            ",\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,"
+            "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+            name, tid, start_ns / 1000.0, dur_ns / 1000.0);
+}
+
+static void write_output_records(FILE *f, struct cwc_output *output, int tid)
+{
+    fprintf(f,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":",
+            tid);
+    write_json_string(f, output->wlr_output->name);
+    fputs("}}", f);
+
+    const struct cwc_frame_stats *stats = &output->frame_stats;
+    uint32_t count = cwc_frame_stats_record_count(stats);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct cwc_frame_record *record =
+            cwc_frame_stats_record_at(stats, i);
+
+        write_event(f, "frame", tid, record->start_ns,
+                    cwc_frame_record_duration(record));
+        fprintf(f,
+                ",\"args\":{\"result\":\"%s\",\"tearing\":%s,"
+                "\"tearing_rejected\":%s}}",
+                cwc_frame_result_name(record->result),
+                record->tearing ? "true" : "false",
+                record->tearing_rejected ? "true" : "false");
+
+        // phases are lapped back to back so each one starts where the
+        // previous ended
+        uint64_t start = record->start_ns;
+        for (int phase = 0; phase < CWC_FRAME_PHASE_LENGTH; phase++) {
+            uint64_t dur = record->phase_ns[phase];
+            if (!dur)
+                continue;
+
+            write_event(f, cwc_frame_phase_name(phase), tid, start, dur);
+            fputc('}', f);
+            start += dur;
+        }
+    }
+}
+
+bool cwc_frame_stats_export_trace(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        cwc_log(CWC_ERROR, "cannot open frame trace file %s", path);
+        return false;
+    }
+
+    // the process metadata goes first so every event after it has a comma
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+          "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+          "\"args\":{\"name\":\"cwc\"}}",
+          f);
+
+    int tid = 1;
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        write_output_records(f, output, tid++);
+    }
+
+    fputs("\n]}\n", f);
+
+    bool ok = !ferror(f);
+    if (fclose(f) != 0)
+        ok = false;
+
+    if (!ok)
+        cwc_log(CWC_ERROR, "failed to write frame trace file %s", path);
+
+    return ok;
+}
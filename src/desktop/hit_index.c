@@ -0,0 +1,446 @@
+/* hit_index.c - spatial index for pointer hit testing
+ *
+ * Copyright (C) 2025 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Each output has a uniform grid where every cell contains the containers
+ * overlapping it ordered from the top-most. A lookup only needs to check the
+ * few containers in the cell instead of walking the whole scene graph.
+ *
+ * A container geometry change only moves that container from its old cells to
+ * the new ones, and raising or lowering it only reorders it in the cells it
+ * covers, so an interactive move or a focus change doesn't depend on the
+ * window count. Visibility, layer, and output changes mark the whole index
+ * dirty and it will be rebuilt on the next lookup so a batch of changes (e.g.
+ * switching tag) only cost one rebuild.
+ *
+ * The stacking order of each layer has its own band so a raised container get
+ * an order just above the top-most one of its layer without renumbering.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <wayland-util.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/util/box.h>
+
+#include "cwc/desktop/hit_index.h"
+#include "cwc/desktop/output.h"
+#include "cwc/layout/container.h"
+#include "cwc/server.h"
+#include "cwc/types.h"
+#include "cwc/util.h"
+
+/* cells per row and column */
+#define HIT_INDEX_GRID 8
+/* the surface is clipped to the container box, this is just a safety slack */
+#define HIT_INDEX_MARGIN 32
+/* stacking order band of a layer, the rebuild start at the middle of it */
+#define HIT_INDEX_LAYER_SHIFT 40
+/* top, above, toplevel, and below layer */
+#define HIT_INDEX_LAYERS 4
+
+/* most cells only overlap a few containers */
+CWC_VEC_DEFINE_SCALAR(container_vec, struct cwc_container *, 4)
+
+struct cwc_hit_index {
+    struct wlr_box box; // output layout box when the grid is built
+    struct container_vec cells[HIT_INDEX_GRID * HIT_INDEX_GRID];
+};
+
+static bool hit_index_dirty = true;
+
+/* top-most and bottom-most order given in each layer */
+static struct {
+    uint64_t top;
+    uint64_t bottom;
+} layer_order[HIT_INDEX_LAYERS];
+
+/* indexed layer from the top-most */
+static struct wlr_scene_tree *hit_index_layer(int rank)
+{
+    switch (rank) {
+    case 0:
+        return server.root.top;
+    case 1:
+        return server.root.above;
+    case 2:
+        return server.root.toplevel;
+    default:
+        return server.root.below;
+    }
+}
+
+/* return -1 if the container is not in any indexed layer */
+static int container_layer_rank(struct cwc_container *container)
+{
+    for (int i = 0; i < HIT_INDEX_LAYERS; i++)
+        if (container->tree->node.parent == hit_index_layer(i))
+            return i;
+
+    return -1;
+}
+
+void cwc_hit_index_mark_dirty()
+{
+    hit_index_dirty = true;
+}
+
+static inline int cell_coord(int coord, int origin, int length)
+{
+    if (length <= 0)
+        return 0;
+
+    int cell = (int64_t)(coord - origin) * HIT_INDEX_GRID / length;
+    return CLAMP(cell, 0, HIT_INDEX_GRID - 1);
+}
+
+static void hit_index_reset(struct cwc_output *output)
+{
+    if (!output->hit_index) {
+        output->hit_index = calloc(1, sizeof(*output->hit_index));
+        for (int i = 0; i < HIT_INDEX_GRID * HIT_INDEX_GRID; i++)
+            container_vec_init(&output->hit_index->cells[i]);
+    }
+
+    struct cwc_hit_index *index = output->hit_index;
+    index->box                  = output->output_layout_box;
+
+    for (int i = 0; i < HIT_INDEX_GRID * HIT_INDEX_GRID; i++)
+        container_vec_clear(&index->cells[i]);
+}
+
+/* cell range of the extent, return false if it doesn't overlap the output */
+static bool hit_index_cell_range(struct cwc_hit_index *index,
+                                 struct wlr_box *extent,
+                                 struct wlr_box *range)
+{
+    struct wlr_box area;
+    if (!wlr_box_intersection(&area, &index->box, extent))
+        return false;
+
+    int x0 = cell_coord(area.x, index->box.x, index->box.width);
+    int y0 = cell_coord(area.y, index->box.y, index->box.height);
+    int x1 =
+        cell_coord(area.x + area.width - 1, index->box.x, index->box.width);
+    int y1 =
+        cell_coord(area.y + area.height - 1, index->box.y, index->box.height);
+
+    *range = (struct wlr_box){x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+    return true;
+}
+
+/* the cell is ordered from the top-most */
+static void cell_insert(struct container_vec *cell,
+                        struct cwc_container *container)
+{
+    size_t idx = cell->count;
+    while (idx && (*container_vec_at(cell, idx - 1))->hit.order
+                      > container->hit.order)
+        idx--;
+
+    container_vec_insert(cell, idx, container);
+}
+
+static void cell_remove(struct container_vec *cell,
+                        struct cwc_container *container)
+{
+    ptrdiff_t idx = container_vec_find(cell, container);
+    if (idx >= 0)
+        container_vec_erase(cell, idx);
+}
+
+static void hit_index_insert(struct cwc_hit_index *index,
+                             struct cwc_container *container,
+                             struct wlr_box *extent)
+{
+    struct wlr_box range;
+    if (!hit_index_cell_range(index, extent, &range))
+        return;
+
+    for (int y = range.y; y < range.y + range.height; y++) {
+        for (int x = range.x; x < range.x + range.width; x++) {
+            cell_insert(&index->cells[y * HIT_INDEX_GRID + x], container);
+        }
+    }
+}
+
+static void hit_index_remove(struct cwc_hit_index *index,
+                             struct cwc_container *container,
+                             struct wlr_box *extent)
+{
+    struct wlr_box range;
+    if (!hit_index_cell_range(index, extent, &range))
+        return;
+
+    for (int y = range.y; y < range.y + range.height; y++) {
+        for (int x = range.x; x < range.x + range.width; x++) {
+            cell_remove(&index->cells[y * HIT_INDEX_GRID + x], container);
+        }
+    }
+}
+
+static struct wlr_box container_hit_extent(struct cwc_container *container)
+{
+    // popup is only constrained to the output and can go anywhere, just put it
+    // in every cell until the popup is gone
+    if (!wl_list_empty(&container->popup_tree->children))
+        return (struct wlr_box){
+            .x      = INT32_MIN / 2,
+            .y      = INT32_MIN / 2,
+            .width  = INT32_MAX,
+            .height = INT32_MAX,
+        };
+
+    struct wlr_box box = cwc_container_get_box(container);
+    box.x -= HIT_INDEX_MARGIN;
+    box.y -= HIT_INDEX_MARGIN;
+    box.width += HIT_INDEX_MARGIN * 2;
+    box.height += HIT_INDEX_MARGIN * 2;
+
+    return box;
+}
+
+static void hit_index_rebuild()
+{
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        hit_index_reset(output);
+    }
+
+    struct cwc_container *container;
+    wl_list_for_each(container, &server.containers, link)
+    {
+        container->hit.indexed = false;
+    }
+
+    // the top-most is inserted first, ontop container in the top layer is
+    // already checked by walking the layer but still needed for tiled lookup
+    for (int i = 0; i < HIT_INDEX_LAYERS; i++) {
+        uint64_t order = ((uint64_t)i << HIT_INDEX_LAYER_SHIFT)
+                         + (1ULL << (HIT_INDEX_LAYER_SHIFT - 1));
+        layer_order[i].top    = order;
+        layer_order[i].bottom = order;
+
+        struct wlr_scene_node *node;
+        wl_list_for_each_reverse(node, &hit_index_layer(i)->children, link)
+        {
+            if (!node->enabled || !node->data)
+                continue;
+
+            container = cwc_container_try_from_data_descriptor(node->data);
+            if (!container)
+                continue;
+
+            container->hit.indexed = true;
+            container->hit.order   = layer_order[i].bottom++;
+            container->hit.extent  = container_hit_extent(container);
+            wl_list_for_each(output, &server.outputs, link)
+            {
+                hit_index_insert(output->hit_index, container,
+                                 &container->hit.extent);
+            }
+        }
+    }
+
+    hit_index_dirty = false;
+}
+
+void cwc_hit_index_update_container(struct cwc_container *container)
+{
+    // a hidden container is picked up by the rebuild when it's shown again
+    if (hit_index_dirty || !container->hit.indexed)
+        return;
+
+    struct wlr_box extent = container_hit_extent(container);
+    if (wlr_box_equal(&extent, &container->hit.extent))
+        return;
+
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        if (!output->hit_index)
+            continue;
+
+        hit_index_remove(output->hit_index, container, &container->hit.extent);
+        hit_index_insert(output->hit_index, container, &extent);
+    }
+
+    container->hit.extent = extent;
+}
+
+static void hit_index_restack(struct cwc_container *container, bool raise)
+{
+    // a hidden container is picked up by the rebuild when it's shown again
+    if (hit_index_dirty || !container->hit.indexed)
+        return;
+
+    int rank = container_layer_rank(container);
+    if (rank < 0) {
+        cwc_hit_index_mark_dirty();
+        return;
+    }
+
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        if (output->hit_index)
+            hit_index_remove(output->hit_index, container,
+                             &container->hit.extent);
+    }
+
+    container->hit.order =
+        raise ? --layer_order[rank].top : layer_order[rank].bottom++;
+
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        if (output->hit_index)
+            hit_index_insert(output->hit_index, container,
+                             &container->hit.extent);
+    }
+}
+
+void cwc_hit_index_raise_container(struct cwc_container *container)
+{
+    hit_index_restack(container, true);
+}
+
+void cwc_hit_index_lower_container(struct cwc_container *container)
+{
+    hit_index_restack(container, false);
+}
+
+/* return NULL if the point is outside of the indexed outputs */
+static struct container_vec *hit_index_cell_at(double lx, double ly)
+{
+    if (hit_index_dirty)
+        hit_index_rebuild();
+
+    struct cwc_output *output = cwc_output_at(server.output_layout, lx, ly);
+    if (!output || !output->hit_index)
+        return NULL;
+
+    struct cwc_hit_index *index = output->hit_index;
+    if (!wlr_box_contains_point(&index->box, lx, ly))
+        return NULL;
+
+    int x = cell_coord(lx, index->box.x, index->box.width);
+    int y = cell_coord(ly, index->box.y, index->box.height);
+
+    return &index->cells[y * HIT_INDEX_GRID + x];
+}
+
+static struct wlr_scene_node *
+toplevel_layers_node_at(double lx, double ly, double *sx, double *sy)
+{
+    struct container_vec *cell = hit_index_cell_at(lx, ly);
+    struct wlr_scene_node *node;
+
+    // point is not on any output, fallback to walk the tree
+    if (!cell) {
+        struct wlr_scene_tree *layers[] = {
+            server.root.above,
+            server.root.toplevel,
+            server.root.below,
+        };
+
+        for (size_t i = 0; i < LENGTH(layers); i++) {
+            if ((node = wlr_scene_node_at(&layers[i]->node, lx, ly, sx, sy)))
+                return node;
+        }
+
+        return NULL;
+    }
+
+    struct cwc_container **container;
+    cwc_vec_for_each(container, cell)
+    {
+        node = wlr_scene_node_at(&(*container)->tree->node, lx, ly, sx, sy);
+        if (node)
+            return node;
+    }
+
+    return NULL;
+}
+
+struct wlr_scene_node *
+cwc_scene_node_at(double lx, double ly, double *sx, double *sy)
+{
+    if (!server.main_tree->node.enabled)
+        return NULL;
+
+    struct wlr_scene_node *node;
+
+    struct wlr_scene_tree *above_toplevel[] = {
+        server.root.session_lock,
+        server.root.overlay,
+        server.root.top,
+    };
+    for (size_t i = 0; i < LENGTH(above_toplevel); i++) {
+        if ((node = wlr_scene_node_at(&above_toplevel[i]->node, lx, ly, sx,
+                                      sy)))
+            return node;
+    }
+
+    if ((node = toplevel_layers_node_at(lx, ly, sx, sy)))
+        return node;
+
+    struct wlr_scene_tree *below_toplevel[] = {
+        server.root.bottom,
+        server.root.background,
+    };
+    for (size_t i = 0; i < LENGTH(below_toplevel); i++) {
+        if ((node = wlr_scene_node_at(&below_toplevel[i]->node, lx, ly, sx,
+                                      sy)))
+            return node;
+    }
+
+    return NULL;
+}
+
+struct cwc_container *cwc_hit_index_tiled_container_at(double lx, double ly)
+{
+    struct container_vec *cell = hit_index_cell_at(lx, ly);
+    if (!cell)
+        return NULL;
+
+    struct cwc_container **container;
+    cwc_vec_for_each(container, cell)
+    {
+        if (cwc_container_is_floating(*container)
+            || !cwc_container_is_visible(*container))
+            continue;
+
+        struct wlr_box box = cwc_container_get_box(*container);
+        if (wlr_box_contains_point(&box, lx, ly))
+            return *container;
+    }
+
+    return NULL;
+}
+
+void cwc_hit_index_output_fini(struct cwc_output *output)
+{
+    if (!output->hit_index)
+        return;
+
+    for (int i = 0; i < HIT_INDEX_GRID * HIT_INDEX_GRID; i++)
+        container_vec_fini(&output->hit_index->cells[i]);
+
+    free(output->hit_index);
+    output->hit_index = NULL;
+}
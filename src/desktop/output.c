@@ -27,6 +27,7 @@
 #include <wlr/backend.h>
 #include <wlr/backend/headless.h>
 #include <wlr/types/wlr_alpha_modifier_v1.h>
+#include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_ext_workspace_v1.h>
 #include <wlr/types/wlr_foreign_toplevel_management_v1.h>
 #include <wlr/types/wlr_layer_shell_v1.h>
@@ -37,11 +38,15 @@
 #include <wlr/types/wlr_xdg_output_v1.h>
 
 #include "cwc/config.h"
+#include "cwc/desktop/frame_callback.h"
+#include "cwc/desktop/frame_stats.h"
+#include "cwc/desktop/hit_index.h"
 #include "cwc/desktop/idle.h"
 #include "cwc/desktop/layer_shell.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/toplevel.h"
 #include "cwc/desktop/transaction.h"
+#include "cwc/input/cursor.h"
 #include "cwc/input/manager.h"
 #include "cwc/input/seat.h"
 #include "cwc/layout/bsp.h"
@@ -108,6 +113,19 @@ void cwc_output_tiling_layout_update_container(struct cwc_container *container,
         update_container_workspace ? container->workspace : 0);
 }
 
+/* output layout box cache for cwc_output_at, wlr_output_layout_output_at
+ * recompute the box of every output on each call.
+ */
+struct output_rect {
+    struct wlr_box box;
+    struct cwc_output *output;
+};
+
+static struct {
+    struct wl_array rects; // struct output_rect
+    bool dirty;
+} output_rects = {.dirty = true};
+
 static struct cwc_output_state *
 cwc_output_state_create(struct cwc_output *output)
 {
@@ -125,6 +143,7 @@ cwc_output_state_create(struct cwc_output *output)
     wl_list_init(&state->toplevels);
     wl_list_init(&state->containers);
     wl_list_init(&state->minimized);
+    wl_array_init(&state->tiled);
 
     wlr_ext_workspace_group_handle_v1_output_enter(state->ext_workspace_group,
                                                    output->wlr_output);
@@ -190,6 +209,7 @@ void cwc_output_restore(struct cwc_output *output,
         wl_list_reattach(&output->state->toplevels,
                          &toplevel->link_output_toplevels);
     }
+    server.list_generation.toplevels++;
 
     /* update output for the layer shell */
     struct cwc_layer_surface *layer_surface;
@@ -223,6 +243,7 @@ static bool cwc_output_state_try_restore(struct cwc_output *output)
     cwc_output_restore(output, old_output);
 
     cwc_hhmap_remove(server.output_state_cache, output->wlr_output->name);
+    cwc_hit_index_output_fini(old_output);
     free(old_output);
     output->state->old_output = NULL;
 
@@ -245,11 +266,15 @@ static void _output_configure_scene(struct cwc_output *output,
                                     struct wlr_scene_node *node,
                                     float opacity)
 {
+    output->opacity_nodes_visited++;
+
     if (node->data) {
         struct cwc_container *container =
             cwc_container_try_from_data_descriptor(node->data);
-        if (container)
+        if (container) {
             opacity = container->opacity;
+            cwc_border_set_opacity(&container->border, opacity);
+        }
     }
 
     if (node->type == WLR_SCENE_NODE_BUFFER) {
@@ -277,6 +302,48 @@ static void _output_configure_scene(struct cwc_output *output,
     }
 }
 
+/* only walk the subtree that has its opacity changed and visible in the output
+ * since the last frame, the whole scene is walked only when a surface outside
+ * any container is changed.
+ */
+static void output_configure_scene_opacity(struct cwc_output *output)
+{
+    output->opacity_nodes_visited = 0;
+
+    if (server.scene_opacity_dirty) {
+        server.scene_opacity_dirty = false;
+        _output_configure_scene(output, &server.scene->tree.node, 1.0f);
+
+        struct cwc_container *container, *tmp;
+        wl_list_for_each_safe(container, tmp, &server.opacity_dirty,
+                              link_opacity_dirty)
+        {
+            wl_list_remove(&container->link_opacity_dirty);
+            wl_list_init(&container->link_opacity_dirty);
+        }
+
+        return;
+    }
+
+    struct cwc_container *container, *tmp;
+    wl_list_for_each_safe(container, tmp, &server.opacity_dirty,
+                          link_opacity_dirty)
+    {
+        if (!container->tree->node.enabled)
+            continue;
+
+        struct wlr_box box = cwc_container_get_box(container);
+        if (!wlr_box_intersection(&box, &box, &output->output_layout_box))
+            continue;
+
+        _output_configure_scene(output, &container->tree->node,
+                                container->opacity);
+
+        wl_list_remove(&container->link_opacity_dirty);
+        wl_list_init(&container->link_opacity_dirty);
+    }
+}
+
 static bool output_can_tear(struct cwc_output *output)
 {
     struct cwc_toplevel *toplevel = cwc_toplevel_get_focused();
@@ -291,50 +358,31 @@ static bool output_can_tear(struct cwc_output *output)
     return false;
 }
 
-static bool allow_render(struct cwc_output *output, struct timespec *now)
+static enum cwc_frame_result
+output_repaint(struct cwc_output *output,
+               struct wlr_scene_output *scene_output,
+               struct cwc_frame_timer *timer)
 {
-    bool is_waiting = output->waiting_since.tv_sec;
-    if (is_waiting) {
-        uint64_t delta_waiting =
-            timespec_to_msec(now) - timespec_to_msec(&output->waiting_since);
-
-        if (delta_waiting > 500) {
-            server.resize_count = -1;
-            goto reset;
-        }
-    }
-
-    if (server.resize_count > 0) {
-        if (!is_waiting)
-            clock_gettime(CLOCK_MONOTONIC, &output->waiting_since);
-
-        return false;
-    }
-
-reset:
-    output->waiting_since.tv_sec = 0;
-    return true;
-}
-
-static void output_repaint(struct cwc_output *output,
-                           struct wlr_scene_output *scene_output,
-                           struct timespec *now)
-{
-    _output_configure_scene(output, &server.scene->tree.node, 1.0f);
+    output_configure_scene_opacity(output);
+    cwc_frame_timer_lap(timer, CWC_FRAME_PHASE_OPACITY);
 
     if (!wlr_scene_output_needs_frame(scene_output))
-        return;
+        return CWC_FRAME_SKIPPED;
 
     bool can_tear = output_can_tear(output);
-    if (!allow_render(output, now) && !can_tear)
-        return;
+    // tearing doesn't wait for the clients to finish resizing
+    if (!transaction_output_ready(output) && !can_tear)
+        return CWC_FRAME_HELD;
 
     struct wlr_output_state pending;
     wlr_output_state_init(&pending);
 
-    if (!wlr_scene_output_build_state(scene_output, &pending, NULL)) {
+    bool built = wlr_scene_output_build_state(scene_output, &pending, NULL);
+    cwc_frame_timer_lap(timer, CWC_FRAME_PHASE_BUILD);
+
+    if (!built) {
         wlr_output_state_finish(&pending);
-        return;
+        return CWC_FRAME_BUILD_FAILED;
     }
 
     if (can_tear) {
@@ -345,31 +393,52 @@ static void output_repaint(struct cwc_output *output,
                     "Output test failed on '%s', retrying without tearing "
                     "page-flip",
                     output->wlr_output->name);
-            pending.tearing_page_flip = false;
+            pending.tearing_page_flip      = false;
+            timer->record.tearing_rejected = true;
         }
     }
 
+    enum cwc_frame_result result = CWC_FRAME_RENDERED;
     if (!wlr_output_commit_state(output->wlr_output, &pending)) {
         cwc_log(CWC_ERROR, "Page-flip failed on output %s",
                 output->wlr_output->name);
+        result = CWC_FRAME_COMMIT_FAILED;
+    } else {
+        timer->record.tearing = pending.tearing_page_flip;
     }
 
     wlr_output_state_finish(&pending);
+    cwc_frame_timer_lap(timer, CWC_FRAME_PHASE_COMMIT);
+
+    return result;
 }
 
 static void on_output_frame(struct wl_listener *listener, void *data)
 {
     struct cwc_output *output = wl_container_of(listener, output, frame_l);
     struct wlr_scene_output *scene_output = output->scene_output;
+    struct cwc_frame_timer timer;
     struct timespec now;
 
+    cwc_frame_timer_start(&timer);
+    cwc_cursor_flush_pending_move(output);
+
     if (!scene_output)
         return;
 
+    cwc_frame_timer_lap(&timer, CWC_FRAME_PHASE_CURSOR);
+
+    // let lua update the scene so the change is shown in this frame
+    cwc_frame_callback_dispatch(output);
+    cwc_frame_timer_lap(&timer, CWC_FRAME_PHASE_LUA);
+
     clock_gettime(CLOCK_MONOTONIC, &now);
-    output_repaint(output, scene_output, &now);
+    timer.record.result = output_repaint(output, scene_output, &timer);
 
     wlr_scene_output_send_frame_done(scene_output, &now);
+    cwc_frame_timer_lap(&timer, CWC_FRAME_PHASE_DONE);
+
+    cwc_frame_timer_finish(&timer, output);
 }
 
 void cwc_output_rescue_toplevel_container(struct cwc_output *source,
@@ -412,6 +481,7 @@ void cwc_output_rescue_toplevel_container(struct cwc_output *source,
         wl_list_reattach(target->state->toplevels.prev,
                          &toplevel->link_output_toplevels);
     }
+    server.list_generation.toplevels++;
 }
 
 struct cwc_output *
@@ -484,6 +554,8 @@ static void output_layers_fini(struct cwc_output *output);
 static void on_output_destroy(struct wl_listener *listener, void *data)
 {
     struct cwc_output *output = wl_container_of(listener, output, destroy_l);
+    cwc_cursor_flush_pending_move(output);
+    cwc_frame_callback_clear(output);
     cwc_output_state_save(output);
     cwc_object_emit_signal_simple("screen::destroy", g_config_get_lua_State(),
                                   output);
@@ -533,6 +605,7 @@ static void on_output_destroy(struct wl_listener *listener, void *data)
     transaction_schedule_output(available_o);
 
     luaC_object_unregister(g_config_get_lua_State(), output);
+    transaction_output_fini(output);
     wl_list_remove(&output->link);
 
     cwc_output_update_outputs_state();
@@ -620,6 +693,7 @@ void cwc_output_update_outputs_state()
         output->output_layout_box = output_box;
         output_layer_set_position(output, output_box.x, output_box.y);
     }
+    cwc_hit_index_mark_dirty();
 
     wlr_output_manager_v1_set_configuration(server.output_manager, cfg);
 
@@ -687,6 +761,8 @@ static struct cwc_output *cwc_output_create(struct wlr_output *wlr_output)
     output->output_layout_box.height = wlr_output->height;
 
     output->usable_area = output->output_layout_box;
+    wl_list_init(&output->frame_callbacks);
+    transaction_output_init(output);
 
     if (cwc_output_state_try_restore(output))
         output->restored = true;
@@ -907,6 +983,8 @@ static void on_new_tearing_object(struct wl_listener *listener, void *data)
 
 static void on_output_layout_change(struct wl_listener *listener, void *data)
 {
+    output_rects.dirty = true;
+    cwc_hit_index_mark_dirty();
     wl_event_loop_add_idle(server.wl_event_loop, _sort_output_index, NULL);
 }
 
@@ -962,6 +1040,98 @@ static void on_ext_workspace_manager_commit(struct wl_listener *listener,
     }
 }
 
+/* the alpha modifier state is double buffered in the surface, save the last
+ * committed multiplier so that only the subtree owning the surface is marked.
+ */
+struct opacity_surface_tracker {
+    struct wlr_surface *surface;
+    double multiplier;
+
+    struct wl_listener commit_l;
+    struct wl_listener new_subsurface_l;
+    struct wl_listener destroy_l;
+};
+
+static void surface_mark_opacity_dirty(struct wlr_surface *surface)
+{
+    struct wlr_surface *root      = wlr_surface_get_root_surface(surface);
+    struct cwc_toplevel *toplevel = cwc_toplevel_try_from_wlr_surface(root);
+
+    if (!toplevel) {
+        struct wlr_xdg_popup *popup = wlr_xdg_popup_try_from_wlr_surface(root);
+        if (popup)
+            toplevel = wlr_xdg_popup_get_cwc_toplevel(popup);
+    }
+
+    if (toplevel && toplevel->container) {
+        cwc_container_mark_opacity_dirty(toplevel->container);
+        return;
+    }
+
+    // not owned by container (layer shell, lock screen, etc.) and rarely
+    // changed so just walk the entire scene.
+    server.scene_opacity_dirty = true;
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        wlr_output_schedule_frame(output->wlr_output);
+    }
+}
+
+static void on_tracked_surface_commit(struct wl_listener *listener, void *data)
+{
+    struct opacity_surface_tracker *tracker =
+        wl_container_of(listener, tracker, commit_l);
+
+    const struct wlr_alpha_modifier_surface_v1_state *state =
+        wlr_alpha_modifier_v1_get_surface_state(tracker->surface);
+    double multiplier = state ? state->multiplier : 1.0;
+
+    if (multiplier == tracker->multiplier)
+        return;
+
+    tracker->multiplier = multiplier;
+    surface_mark_opacity_dirty(tracker->surface);
+}
+
+static void on_tracked_surface_new_subsurface(struct wl_listener *listener,
+                                              void *data)
+{
+    struct opacity_surface_tracker *tracker =
+        wl_container_of(listener, tracker, new_subsurface_l);
+
+    surface_mark_opacity_dirty(tracker->surface);
+}
+
+static void on_tracked_surface_destroy(struct wl_listener *listener,
+                                       void *data)
+{
+    struct opacity_surface_tracker *tracker =
+        wl_container_of(listener, tracker, destroy_l);
+
+    wl_list_remove(&tracker->commit_l.link);
+    wl_list_remove(&tracker->new_subsurface_l.link);
+    wl_list_remove(&tracker->destroy_l.link);
+
+    free(tracker);
+}
+
+static void on_new_surface(struct wl_listener *listener, void *data)
+{
+    struct wlr_surface *surface = data;
+
+    struct opacity_surface_tracker *tracker = calloc(1, sizeof(*tracker));
+    tracker->surface                        = surface;
+    tracker->multiplier                     = 1.0;
+
+    tracker->commit_l.notify         = on_tracked_surface_commit;
+    tracker->new_subsurface_l.notify = on_tracked_surface_new_subsurface;
+    tracker->destroy_l.notify        = on_tracked_surface_destroy;
+    wl_signal_add(&surface->events.commit, &tracker->commit_l);
+    wl_signal_add(&surface->events.new_subsurface, &tracker->new_subsurface_l);
+    wl_signal_add(&surface->events.destroy, &tracker->destroy_l);
+}
+
 void setup_output(struct cwc_server *s)
 {
     // wlr output layout
@@ -992,6 +1162,11 @@ void setup_output(struct cwc_server *s)
     wl_signal_add(&s->tearing_manager->events.new_object,
                   &s->new_tearing_object_l);
 
+    // opacity tracking
+    s->scene_opacity_dirty  = true;
+    s->new_surface_l.notify = on_new_surface;
+    wl_signal_add(&s->compositor->events.new_surface, &s->new_surface_l);
+
     // xdg output
     s->xdg_output_manager =
         wlr_xdg_output_manager_v1_create(s->wl_display, s->output_layout);
@@ -1020,6 +1195,8 @@ void cleanup_output(struct cwc_server *s)
 
     wl_list_remove(&s->opm_set_mode_l.link);
 
+    wl_list_remove(&s->new_surface_l.link);
+
     wl_list_remove(&s->new_tearing_object_l.link);
 
     wl_list_remove(&s->ext_workspace_mgr_commit_l.link);
@@ -1194,11 +1371,45 @@ bool cwc_output_is_exist(struct cwc_output *output)
 
 //=========== MACRO ===============
 
+static void output_rects_rebuild()
+{
+    output_rects.rects.size = 0;
+
+    struct wlr_output_layout_output *l_output;
+    wl_list_for_each(l_output, &server.output_layout->outputs, link)
+    {
+        struct output_rect *rect =
+            wl_array_add(&output_rects.rects, sizeof(*rect));
+        if (!rect)
+            return;
+
+        wlr_output_layout_get_box(server.output_layout, l_output->output,
+                                  &rect->box);
+        rect->output = l_output->output->data;
+    }
+
+    output_rects.dirty = false;
+}
+
 struct cwc_output *
 cwc_output_at(struct wlr_output_layout *ol, double x, double y)
 {
-    struct wlr_output *o = wlr_output_layout_output_at(ol, x, y);
-    return o ? o->data : NULL;
+    if (ol != server.output_layout) {
+        struct wlr_output *o = wlr_output_layout_output_at(ol, x, y);
+        return o ? o->data : NULL;
+    }
+
+    if (output_rects.dirty)
+        output_rects_rebuild();
+
+    struct output_rect *rect;
+    wl_array_for_each(rect, &output_rects.rects)
+    {
+        if (wlr_box_contains_point(&rect->box, x, y))
+            return rect->output;
+    }
+
+    return NULL;
 }
 
 struct cwc_toplevel **
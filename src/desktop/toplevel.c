@@ -42,9 +42,11 @@
 #endif /* ifdef CWC_XWAYLAND */
 
 #include "cwc/config.h"
+#include "cwc/desktop/hit_index.h"
 #include "cwc/desktop/layer_shell.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/toplevel.h"
+#include "cwc/desktop/transaction.h"
 #include "cwc/input/cursor.h"
 #include "cwc/input/keyboard.h"
 #include "cwc/input/seat.h"
@@ -148,6 +150,7 @@ static inline void _init_mapped_managed_toplevel(struct cwc_toplevel *toplevel)
 
     wl_list_insert(&server.focused_output->state->toplevels,
                    &toplevel->link_output_toplevels);
+    server.list_generation.toplevels++;
     if (!cwc_toplevel_is_floating(toplevel))
         cwc_toplevel_set_tiled(toplevel, WLR_EDGE_TOP | WLR_EDGE_BOTTOM
                                              | WLR_EDGE_LEFT | WLR_EDGE_RIGHT);
@@ -203,6 +206,7 @@ static inline void _fini_unmap_managed_toplevel(struct cwc_toplevel *toplevel)
         return;
 
     wl_list_remove(&toplevel->link_output_toplevels);
+    server.list_generation.toplevels++;
 
     if (toplevel->wlr_foreign_handle) {
         wlr_foreign_toplevel_handle_v1_destroy(toplevel->wlr_foreign_handle);
@@ -249,6 +253,7 @@ static void on_unmanaged_set_geometry(struct wl_listener *listener, void *data)
 
     wlr_scene_node_set_position(&toplevel->container->tree->node,
                                 toplevel->xwsurface->x, toplevel->xwsurface->y);
+    cwc_hit_index_update_container(toplevel->container);
 }
 
 static void _init_mapped_unmanaged_toplevel(struct cwc_toplevel *toplevel)
@@ -330,6 +335,7 @@ static void on_surface_unmap(struct wl_listener *listener, void *data)
     if (cursor->grabbed_toplevel == toplevel)
         stop_interactive(cursor);
 
+    transaction_remove_toplevel(toplevel);
     _fini_unmap_managed_toplevel(toplevel);
     _fini_unmap_unmanaged_toplevel(toplevel);
 
@@ -365,12 +371,7 @@ static void on_surface_commit(struct wl_listener *listener, void *data)
         return;
     }
 
-    if (toplevel->resize_serial
-        && toplevel->resize_serial
-               <= toplevel->xdg_toplevel->base->current.configure_serial) {
-        server.resize_count--;
-        toplevel->resize_serial = 0;
-    }
+    transaction_toplevel_commit(toplevel);
 
     /* nothing to do when geometry is unchanged */
     struct wlr_box geom = cwc_toplevel_get_geometry(toplevel);
@@ -482,6 +483,7 @@ static void on_toplevel_destroy(struct wl_listener *listener, void *data)
     cwc_object_emit_signal_simple("client::destroy", L, toplevel);
 
     wl_list_remove(&toplevel->link);
+    server.list_generation.toplevels++;
     wl_list_remove(&toplevel->destroy_l.link);
     wl_list_remove(&toplevel->request_minimize_l.link);
     wl_list_remove(&toplevel->request_maximize_l.link);
@@ -611,6 +613,7 @@ static void cwc_toplevel_init_common_stuff(struct cwc_toplevel *toplevel)
     }
 
     wl_list_insert(&server.toplevels, &toplevel->link);
+    server.list_generation.toplevels++;
 
     lua_State *L = g_config_get_lua_State();
     luaC_object_client_register(L, toplevel);
@@ -651,6 +654,9 @@ static void on_popup_destroy(struct wl_listener *listener, void *data)
     wl_list_remove(&popup->popup_commit_l.link);
     wl_list_remove(&popup->popup_destroy_l.link);
 
+    // the container may no longer have a popup
+    cwc_hit_index_mark_dirty();
+
     free(popup);
 }
 
@@ -722,6 +728,12 @@ create_popup:
 
     wlr_scene_node_raise_to_top(&popup->scene_tree->node);
     wlr_xdg_surface_schedule_configure(xdg_popup->base);
+    cwc_hit_index_mark_dirty();
+
+    // popup inherit the container opacity
+    toplevel = wlr_xdg_popup_get_cwc_toplevel(xdg_popup);
+    if (toplevel && toplevel->container)
+        cwc_container_mark_opacity_dirty(toplevel->container);
 }
 
 void on_new_xdg_popup(struct wl_listener *listener, void *data)
@@ -879,9 +891,11 @@ void cwc_toplevel_focus(struct cwc_toplevel *toplevel, bool raise)
     struct wlr_surface *wlr_surface  = cwc_toplevel_get_wlr_surface(toplevel);
     struct wlr_surface *prev_surface = seat->keyboard_state.focused_surface;
 
-    if (!cwc_toplevel_is_unmanaged(toplevel))
+    if (!cwc_toplevel_is_unmanaged(toplevel)) {
         wl_list_reattach(&toplevel->container->output->state->focus_stack,
                          &toplevel->container->link_output_fstack);
+        server.list_generation.focus_stack++;
+    }
 
     if (wlr_surface == prev_surface)
         return;
@@ -898,8 +912,10 @@ void cwc_toplevel_focus(struct cwc_toplevel *toplevel, bool raise)
     keyboard_focus_surface(seat->data, wlr_surface);
     cwc_toplevel_set_urgent(toplevel, false);
 
-    if (raise)
+    if (raise) {
         wlr_scene_node_raise_to_top(&toplevel->container->tree->node);
+        cwc_hit_index_raise_container(toplevel->container);
+    }
 }
 
 void cwc_toplevel_jump_to(struct cwc_toplevel *toplevel, bool merge)
@@ -991,8 +1007,7 @@ struct wlr_box cwc_toplevel_get_box(struct cwc_toplevel *toplevel)
 struct wlr_surface *
 scene_surface_at(double lx, double ly, double *sx, double *sy)
 {
-    struct wlr_scene_node *node_under =
-        wlr_scene_node_at(&server.scene->tree.node, lx, ly, sx, sy);
+    struct wlr_scene_node *node_under = cwc_scene_node_at(lx, ly, sx, sy);
 
     if (node_under == NULL || node_under->type != WLR_SCENE_NODE_BUFFER)
         return NULL;
@@ -1233,6 +1248,7 @@ void cwc_toplevel_swap(struct cwc_toplevel *source, struct cwc_toplevel *target)
     wl_list_swap(&source->link_output_toplevels,
                  &target->link_output_toplevels);
     wl_list_swap(&source->link, &target->link);
+    server.list_generation.toplevels++;
 
     cwc_container_refresh(c_src);
     cwc_container_refresh(d_src);
@@ -1369,10 +1385,15 @@ cwc_toplevel_at(double lx, double ly, double *sx, double *sy)
 struct cwc_toplevel *
 cwc_toplevel_at_with_deep_check(double lx, double ly, double *sx, double *sy)
 {
-    struct wlr_scene_node *under =
-        wlr_scene_node_at(&server.scene->tree.node, lx, ly, NULL, NULL);
+    struct wlr_scene_node *under = cwc_scene_node_at(lx, ly, NULL, NULL);
+
+    if (!under)
+        return NULL;
 
-    if (!under || under->type != WLR_SCENE_NODE_BUFFER)
+    // solid border is drawn using rect instead of buffer
+    cwc_data_interface_t *under_data = under->data;
+    if (under->type != WLR_SCENE_NODE_BUFFER
+        && !(under_data && under_data->type == DATA_TYPE_BORDER))
         return NULL;
 
     // search for container node
@@ -1422,20 +1443,10 @@ cwc_toplevel_at_with_deep_check(double lx, double ly, double *sx, double *sy)
 
 struct cwc_toplevel *cwc_toplevel_at_tiled(double lx, double ly)
 {
-    struct cwc_container *container;
-    wl_list_for_each(container, &server.containers, link)
-    {
-        if (cwc_container_is_floating(container)
-            || !cwc_container_is_visible(container))
-            continue;
-
-        struct wlr_box box = cwc_container_get_box(container);
-
-        if (wlr_box_contains_point(&box, lx, ly))
-            return cwc_container_get_front_toplevel(container);
-    }
+    struct cwc_container *container =
+        cwc_hit_index_tiled_container_at(lx, ly);
 
-    return NULL;
+    return container ? cwc_container_get_front_toplevel(container) : NULL;
 }
 
 inline bool cwc_toplevel_is_visible(struct cwc_toplevel *toplevel)
@@ -1500,6 +1511,8 @@ bool cwc_toplevel_is_ontop(struct cwc_toplevel *toplevel)
 
 void cwc_toplevel_set_ontop(struct cwc_toplevel *toplevel, bool set)
 {
+    cwc_hit_index_mark_dirty();
+
     if (set) {
         wlr_scene_node_reparent(&toplevel->container->tree->node,
                                 server.root.top);
@@ -1520,6 +1533,8 @@ bool cwc_toplevel_is_above(struct cwc_toplevel *toplevel)
 
 void cwc_toplevel_set_above(struct cwc_toplevel *toplevel, bool set)
 {
+    cwc_hit_index_mark_dirty();
+
     if (set) {
         wlr_scene_node_reparent(&toplevel->container->tree->node,
                                 server.root.above);
@@ -1540,6 +1555,8 @@ bool cwc_toplevel_is_below(struct cwc_toplevel *toplevel)
 
 void cwc_toplevel_set_below(struct cwc_toplevel *toplevel, bool set)
 {
+    cwc_hit_index_mark_dirty();
+
     if (set) {
         wlr_scene_node_reparent(&toplevel->container->tree->node,
                                 server.root.below);
@@ -1,4 +1,4 @@
-/* transaction.c - actually just a simple scheduler
+/* transaction.c - layout scheduler and configure synchronization
  *
  * Copyright (C) 2025 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
  *
@@ -16,18 +16,41 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+/* Layout changes are scheduled and applied in an idle callback so a batch of
+ * changes only relayout a tag once and the result is shown in a single frame.
+ *
+ * Every toplevel resized by the relayout is added to the transaction of its
+ * output with the configure serial. The output doesn't render until all of
+ * them commit the configure so the new layout appear at once instead of
+ * showing the fast clients in the intermediate state. A client is only waited
+ * until its own deadline, a slow client can delay its output but never the
+ * other outputs.
+ */
+
 #include <stdio.h>
 #include <wayland-server-core.h>
 #include <wayland-util.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_xdg_shell.h>
 
 #include "cwc/desktop/layer_shell.h"
+#include "cwc/desktop/toplevel.h"
 #include "cwc/desktop/transaction.h"
+#include "cwc/input/cursor.h"
+#include "cwc/input/seat.h"
+#include "cwc/layout/container.h"
 #include "cwc/server.h"
+#include "cwc/util.h"
+
+/* how long a toplevel configure is waited before rendering without it */
+#define CONFIGURE_TIMEOUT_MSEC 500
+
+CWC_VEC_DEFINE(tag_vec, struct cwc_tag_info *, 16)
 
 static struct transaction {
     struct wl_event_source *idle_source;
 
-    struct wl_array tags; // struct cwc_tag_info*
+    struct tag_vec tags;
 
     bool output_pending;
     bool paused;
@@ -56,6 +79,8 @@ static inline void _process_pending_tag(struct cwc_tag_info *tag)
     if (!cwc_output_is_exist(output))
         return;
 
+    // the resized toplevels are added to the output transaction so the whole
+    // relayout is shown in one frame
     cwc_output_tiling_layout_update(output, tag->index);
     tag->pending_transaction = false;
 }
@@ -75,15 +100,12 @@ static void process_pending(void *data)
         T.output_pending = false;
     }
 
-    if (T.tags.size) {
-        struct cwc_tag_info **tag;
-        wl_array_for_each(tag, &T.tags)
-        {
-            _process_pending_tag(*tag);
-        }
-        wl_array_release(&T.tags);
-        wl_array_init(&T.tags);
+    struct cwc_tag_info **tag;
+    cwc_vec_for_each(tag, &T.tags)
+    {
+        _process_pending_tag(*tag);
     }
+    tag_vec_clear(&T.tags);
 
     T.idle_source = NULL;
     T.processing  = false;
@@ -128,14 +150,189 @@ void transaction_schedule_tag(struct cwc_tag_info *tag)
     if (tag->pending_transaction || T.processing)
         return;
 
-    struct cwc_tag_info **elem = wl_array_add(&T.tags, sizeof(&tag));
-    *elem                      = tag;
-    tag->pending_transaction   = true;
+    if (!tag_vec_push(&T.tags, tag))
+        return;
+    tag->pending_transaction = true;
 
     transaction_start();
 }
 
+/* resizing is already synchronized by the resize scheduling in cursor.c,
+ * waiting for the clients too make it sluggish.
+ */
+static bool output_is_interactive_resizing(struct cwc_output *output)
+{
+    struct cwc_cursor *cursor = server.seat->cursor;
+
+    switch (cursor->state) {
+    case CWC_CURSOR_STATE_RESIZE:
+    case CWC_CURSOR_STATE_RESIZE_BSP:
+    case CWC_CURSOR_STATE_RESIZE_MASTER:
+        return cursor->grabbed_toplevel
+               && cursor->grabbed_toplevel->container->output == output;
+    default:
+        return false;
+    }
+}
+
+static void configure_remove(struct cwc_toplevel *toplevel)
+{
+    wl_list_remove(&toplevel->pending_configure.link);
+    wl_list_init(&toplevel->pending_configure.link);
+    toplevel->pending_configure.output = NULL;
+    toplevel->pending_configure.serial = 0;
+}
+
+/* the list is ordered by deadline since a waited toplevel keep its position */
+static void configure_timer_update(struct cwc_output *output, uint64_t now)
+{
+    if (wl_list_empty(&output->pending_configures)) {
+        wl_event_source_timer_update(output->configure_timer, 0);
+        return;
+    }
+
+    struct cwc_toplevel *first = wl_container_of(
+        output->pending_configures.next, first, pending_configure.link);
+    uint64_t deadline = first->pending_configure.deadline_msec;
+
+    // 0 would disarm the timer
+    wl_event_source_timer_update(output->configure_timer,
+                                 deadline > now ? deadline - now : 1);
+}
+
+static void configure_expire(struct cwc_output *output, uint64_t now)
+{
+    struct cwc_toplevel *toplevel, *tmp;
+    wl_list_for_each_safe(toplevel, tmp, &output->pending_configures,
+                          pending_configure.link)
+    {
+        if (toplevel->pending_configure.deadline_msec > now)
+            break;
+
+        cwc_log(CWC_DEBUG,
+                "toplevel %p didn't commit configure %u in time on %s",
+                toplevel, toplevel->pending_configure.serial,
+                output->wlr_output->name);
+        configure_remove(toplevel);
+    }
+}
+
+static void configure_clear(struct cwc_output *output)
+{
+    struct cwc_toplevel *toplevel, *tmp;
+    wl_list_for_each_safe(toplevel, tmp, &output->pending_configures,
+                          pending_configure.link)
+    {
+        configure_remove(toplevel);
+    }
+}
+
+/* the output may not have any damage left when the last configure arrive so
+ * request the frame to show the finished layout
+ */
+static void configure_done(struct cwc_toplevel *toplevel)
+{
+    struct cwc_output *output = toplevel->pending_configure.output;
+    configure_remove(toplevel);
+
+    if (!wl_list_empty(&output->pending_configures))
+        return;
+
+    wl_event_source_timer_update(output->configure_timer, 0);
+    wlr_output_schedule_frame(output->wlr_output);
+}
+
+static int on_configure_timeout(void *data)
+{
+    struct cwc_output *output = data;
+    uint64_t now              = get_current_time_msec();
+
+    configure_expire(output, now);
+    configure_timer_update(output, now);
+
+    if (wl_list_empty(&output->pending_configures))
+        wlr_output_schedule_frame(output->wlr_output);
+
+    return 0;
+}
+
+void transaction_add_configure(struct cwc_toplevel *toplevel, uint32_t serial)
+{
+    struct cwc_output *output = toplevel->container->output;
+    if (!serial || !cwc_output_is_exist(output)
+        || output_is_interactive_resizing(output))
+        return;
+
+    // keep the first deadline so a client that keep being relayout can't hold
+    // the output forever
+    if (toplevel->pending_configure.output == output) {
+        toplevel->pending_configure.serial = serial;
+        return;
+    }
+
+    if (toplevel->pending_configure.output)
+        configure_done(toplevel);
+
+    uint64_t now                              = get_current_time_msec();
+    toplevel->pending_configure.output        = output;
+    toplevel->pending_configure.serial        = serial;
+    toplevel->pending_configure.deadline_msec = now + CONFIGURE_TIMEOUT_MSEC;
+
+    bool was_empty = wl_list_empty(&output->pending_configures);
+    wl_list_insert(output->pending_configures.prev,
+                   &toplevel->pending_configure.link);
+
+    if (was_empty)
+        configure_timer_update(output, now);
+}
+
+void transaction_toplevel_commit(struct cwc_toplevel *toplevel)
+{
+    if (!toplevel->pending_configure.output)
+        return;
+
+    if (toplevel->pending_configure.serial
+        <= toplevel->xdg_toplevel->base->current.configure_serial)
+        configure_done(toplevel);
+}
+
+void transaction_remove_toplevel(struct cwc_toplevel *toplevel)
+{
+    if (toplevel->pending_configure.output)
+        configure_done(toplevel);
+}
+
+bool transaction_output_ready(struct cwc_output *output)
+{
+    if (wl_list_empty(&output->pending_configures))
+        return true;
+
+    if (output_is_interactive_resizing(output)) {
+        configure_clear(output);
+    } else {
+        uint64_t now = get_current_time_msec();
+        configure_expire(output, now);
+        configure_timer_update(output, now);
+    }
+
+    return wl_list_empty(&output->pending_configures);
+}
+
+void transaction_output_init(struct cwc_output *output)
+{
+    wl_list_init(&output->pending_configures);
+    output->configure_timer = wl_event_loop_add_timer(
+        server.wl_event_loop, on_configure_timeout, output);
+}
+
+void transaction_output_fini(struct cwc_output *output)
+{
+    configure_clear(output);
+    wl_event_source_remove(output->configure_timer);
+    output->configure_timer = NULL;
+}
+
 void setup_transaction(struct cwc_server *s)
 {
-    wl_array_init(&T.tags);
+    tag_vec_init(&T.tags);
 }
@@ -169,8 +169,8 @@ static inline void schedule_resize(struct cwc_toplevel *toplevel,
             cwc_container_set_box_global(toplevel->container, new_box);
             clock_gettime(CLOCK_MONOTONIC, &now);
         } else {
-            transaction_schedule_tag(
-                cwc_output_get_current_tag_info(toplevel->container->output));
+            bsp_update_dirty(toplevel->container->output,
+                             toplevel->container->workspace);
         }
 
         cursor->last_resize_time_msec = timespec_to_msec(&now);
@@ -239,11 +239,13 @@ static void process_cursor_resize_bsp(struct cwc_cursor *cursor)
         double newfact =
             grab_bsp->wfact_horizontal + diff_x / horizontal->width;
         horizontal->left_wfact = CLAMP(newfact, 0.05, 0.95);
+        bsp_node_mark_dirty(horizontal);
     }
 
     if (vertical) {
         double newfact = grab_bsp->wfact_vertical + diff_y / vertical->height;
         vertical->left_wfact = CLAMP(newfact, 0.05, 0.95);
+        bsp_node_mark_dirty(vertical);
     }
 
     schedule_resize(toplevel, cursor, NULL);
@@ -269,13 +271,51 @@ static void cwc_cursor_unhide(struct cwc_cursor *cursor)
     }
 }
 
-static inline void _send_pointer_move_signal(struct cwc_cursor *cursor,
-                                             uint32_t time_msec,
-                                             struct wlr_input_device *device,
-                                             double dx,
-                                             double dy,
-                                             double dx_unaccel,
-                                             double dy_unaccel)
+/* resolved once in cwc_cursor_create since these are emitted very often */
+static struct {
+    cwc_signal_handle_t move;
+    cwc_signal_handle_t axis;
+    cwc_signal_handle_t button;
+    cwc_signal_handle_t swipe_begin;
+    cwc_signal_handle_t swipe_update;
+    cwc_signal_handle_t swipe_end;
+    cwc_signal_handle_t pinch_begin;
+    cwc_signal_handle_t pinch_update;
+    cwc_signal_handle_t pinch_end;
+    cwc_signal_handle_t hold_begin;
+    cwc_signal_handle_t hold_end;
+    cwc_signal_handle_t screen_mouse_enter;
+    cwc_signal_handle_t screen_mouse_leave;
+    cwc_signal_handle_t client_mouse_enter;
+    cwc_signal_handle_t client_mouse_leave;
+} signals;
+
+static void cursor_signals_intern()
+{
+    signals.move               = cwc_signal_intern("pointer::move");
+    signals.axis               = cwc_signal_intern("pointer::axis");
+    signals.button             = cwc_signal_intern("pointer::button");
+    signals.swipe_begin        = cwc_signal_intern("pointer::swipe::begin");
+    signals.swipe_update       = cwc_signal_intern("pointer::swipe::update");
+    signals.swipe_end          = cwc_signal_intern("pointer::swipe::end");
+    signals.pinch_begin        = cwc_signal_intern("pointer::pinch::begin");
+    signals.pinch_update       = cwc_signal_intern("pointer::pinch::update");
+    signals.pinch_end          = cwc_signal_intern("pointer::pinch::end");
+    signals.hold_begin         = cwc_signal_intern("pointer::hold::begin");
+    signals.hold_end           = cwc_signal_intern("pointer::hold::end");
+    signals.screen_mouse_enter = cwc_signal_intern("screen::mouse_enter");
+    signals.screen_mouse_leave = cwc_signal_intern("screen::mouse_leave");
+    signals.client_mouse_enter = cwc_signal_intern("client::mouse_enter");
+    signals.client_mouse_leave = cwc_signal_intern("client::mouse_leave");
+}
+
+static void _emit_pointer_move_signal(struct cwc_cursor *cursor,
+                                      uint32_t time_msec,
+                                      double dx,
+                                      double dy,
+                                      double dx_unaccel,
+                                      double dy_unaccel,
+                                      uint32_t samples)
 {
     struct cwc_pointer_move_event event = {
         .cursor     = cursor,
@@ -283,6 +323,7 @@ static inline void _send_pointer_move_signal(struct cwc_cursor *cursor,
         .dy         = dy,
         .dx_unaccel = dx_unaccel,
         .dy_unaccel = dy_unaccel,
+        .samples    = samples,
     };
     lua_State *L = g_config_get_lua_State();
     lua_settop(L, 0);
@@ -292,7 +333,64 @@ static inline void _send_pointer_move_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, dy);
     lua_pushnumber(L, dx_unaccel);
     lua_pushnumber(L, dy_unaccel);
-    cwc_signal_emit("pointer::move", &event, L, 6);
+    lua_pushnumber(L, samples);
+    cwc_signal_emit_handle(signals.move, &event, L, 7);
+}
+
+static inline void _send_pointer_move_signal(struct cwc_cursor *cursor,
+                                             uint32_t time_msec,
+                                             struct wlr_input_device *device,
+                                             double dx,
+                                             double dy,
+                                             double dx_unaccel,
+                                             double dy_unaccel)
+{
+    if (!cwc_signal_has_listeners(signals.move))
+        return;
+
+    struct cwc_output *output = cursor->last_output;
+    if (!g_config.cursor_coalesce_motion || !output) {
+        _emit_pointer_move_signal(cursor, time_msec, dx, dy, dx_unaccel,
+                                  dy_unaccel, 1);
+        return;
+    }
+
+    // the cursor moved to another output, don't wait for the old one
+    if (cursor->pending_move.output && cursor->pending_move.output != output)
+        cwc_cursor_flush_pending_move(cursor->pending_move.output);
+
+    // hardware cursor movement doesn't trigger a frame
+    if (!cursor->pending_move.output) {
+        cursor->pending_move.output = output;
+        wlr_output_schedule_frame(output->wlr_output);
+    }
+
+    cursor->pending_move.time_msec = time_msec;
+    cursor->pending_move.samples++;
+    cursor->pending_move.dx += dx;
+    cursor->pending_move.dy += dy;
+    cursor->pending_move.dx_unaccel += dx_unaccel;
+    cursor->pending_move.dy_unaccel += dy_unaccel;
+}
+
+void cwc_cursor_flush_pending_move(struct cwc_output *output)
+{
+    struct cwc_seat *seat;
+    wl_list_for_each(seat, &server.input->seats, link)
+    {
+        struct cwc_cursor *cursor = seat->cursor;
+        if (cursor->pending_move.output != output)
+            continue;
+
+        // reset first in case the lua callback moves the pointer
+        typeof(cursor->pending_move) pending = cursor->pending_move;
+        memset(&cursor->pending_move, 0, sizeof(cursor->pending_move));
+
+        if (cwc_signal_has_listeners(signals.move))
+            _emit_pointer_move_signal(cursor, pending.time_msec, pending.dx,
+                                      pending.dy, pending.dx_unaccel,
+                                      pending.dy_unaccel, pending.samples);
+    }
 }
 
 void cwc_cursor_notify_activity(struct cwc_cursor *cursor)
@@ -322,18 +420,14 @@ static bool cwc_cursor_check_interactive(struct cwc_cursor *cursor,
         process_cursor_move(cursor);
         return true;
     case CWC_CURSOR_STATE_RESIZE:
-        // skip synchronization otherwise it'll make resizing sluggish
-        server.resize_count = -1e6;
         wlr_cursor_move(wlr_cursor, device, dx, dy);
         process_cursor_resize(cursor);
         return true;
     case CWC_CURSOR_STATE_RESIZE_BSP:
-        server.resize_count = -1e6;
         wlr_cursor_move(wlr_cursor, device, dx, dy);
         process_cursor_resize_bsp(cursor);
         return true;
     case CWC_CURSOR_STATE_RESIZE_MASTER:
-        server.resize_count = -1e6;
         wlr_cursor_move(wlr_cursor, device, dx, dy);
         process_cursor_resize_master(cursor);
         return true;
@@ -367,11 +461,12 @@ void process_cursor_motion(struct cwc_cursor *cursor,
 
     if (cursor->last_output != output) {
         lua_State *L = g_config_get_lua_State();
-        cwc_object_emit_signal_simple("screen::mouse_enter", L, output);
+        cwc_object_emit_signal_handle_simple(signals.screen_mouse_enter, L,
+                                             output);
 
         if (cursor->last_output)
-            cwc_object_emit_signal_simple("screen::mouse_leave", L,
-                                          cursor->last_output);
+            cwc_object_emit_signal_handle_simple(signals.screen_mouse_leave, L,
+                                                 cursor->last_output);
 
         cursor->last_output = output;
     }
@@ -473,11 +568,13 @@ static void _notify_mouse_signal(struct wlr_surface *old_surface,
 
     lua_State *L = g_config_get_lua_State();
     if (old && cwc_toplevel_is_mapped(old) && !cwc_toplevel_is_unmanaged(old)) {
-        cwc_object_emit_signal_simple("client::mouse_leave", L, old);
+        cwc_object_emit_signal_handle_simple(signals.client_mouse_leave, L,
+                                             old);
     }
 
     if (new && cwc_toplevel_is_mapped(new) && !cwc_toplevel_is_unmanaged(new)) {
-        cwc_object_emit_signal_simple("client::mouse_enter", L, new);
+        cwc_object_emit_signal_handle_simple(signals.client_mouse_enter, L,
+                                             new);
     }
 }
 
@@ -535,6 +632,9 @@ static inline void
 _send_pointer_axis_signal(struct cwc_cursor *cursor,
                           struct wlr_pointer_axis_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.axis))
+        return;
+
     struct cwc_pointer_axis_event cwc_event = {
         .cursor = cursor,
         .event  = event,
@@ -547,7 +647,7 @@ _send_pointer_axis_signal(struct cwc_cursor *cursor,
     lua_pushboolean(L, event->orientation);
     lua_pushnumber(L, event->delta);
     lua_pushnumber(L, event->delta_discrete);
-    cwc_signal_emit("pointer::axis", &cwc_event, L, 5);
+    cwc_signal_emit_handle(signals.axis, &cwc_event, L, 5);
 }
 
 /* true means client shouldn't get notified */
@@ -844,6 +944,7 @@ static void end_interactive_move_master(struct cwc_cursor *cursor)
         wl_list_swap(&toplevel_under_cursor->container->link_output_container,
                      &grabbed->link_output_container);
         wl_list_swap(&toplevel_under_cursor->container->link, &grabbed->link);
+        server.list_generation.containers++;
     }
 
     transaction_schedule_tag(cwc_output_get_current_tag_info(grabbed->output));
@@ -885,6 +986,10 @@ static void end_interactive_move_bsp(struct cwc_cursor *cursor)
 
 static void end_interactive_resize_bsp(struct cwc_cursor *cursor)
 {
+    struct cwc_container *container = cursor->grabbed_toplevel->container;
+
+    // apply the last factor that may be skipped by the resize scheduling
+    bsp_update_dirty(container->output, container->workspace);
     cursor->grab_bsp = (struct bsp_grab){0};
 }
 
@@ -945,6 +1050,9 @@ _send_pointer_button_signal(struct cwc_cursor *cursor,
                             struct wlr_pointer_button_event *event,
                             bool press)
 {
+    if (!cwc_signal_has_listeners(signals.button))
+        return;
+
     struct cwc_pointer_button_event cwc_event = {
         .cursor = cursor,
         .event  = event,
@@ -955,7 +1063,7 @@ _send_pointer_button_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushnumber(L, event->button);
     lua_pushboolean(L, event->state);
-    cwc_signal_emit("pointer::button", &cwc_event, L, 4);
+    cwc_signal_emit_handle(signals.button, &cwc_event, L, 4);
 }
 
 void process_cursor_button(struct cwc_cursor *cursor,
@@ -1043,6 +1151,9 @@ static inline void
 _send_pointer_swipe_begin_signal(struct cwc_cursor *cursor,
                                  struct wlr_pointer_swipe_begin_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.swipe_begin))
+        return;
+
     struct cwc_pointer_swipe_begin_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1053,7 +1164,7 @@ _send_pointer_swipe_begin_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushnumber(L, event->fingers);
 
-    cwc_signal_emit("pointer::swipe::begin", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.swipe_begin, &signal_data, L, 3);
 }
 
 static void on_swipe_begin(struct wl_listener *listener, void *data)
@@ -1074,6 +1185,9 @@ static inline void
 _send_pointer_swipe_update_signal(struct cwc_cursor *cursor,
                                   struct wlr_pointer_swipe_update_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.swipe_update))
+        return;
+
     struct cwc_pointer_swipe_update_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1086,7 +1200,7 @@ _send_pointer_swipe_update_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->dx);
     lua_pushnumber(L, event->dy);
 
-    cwc_signal_emit("pointer::swipe::update", &signal_data, L, 5);
+    cwc_signal_emit_handle(signals.swipe_update, &signal_data, L, 5);
 }
 
 static void on_swipe_update(struct wl_listener *listener, void *data)
@@ -1107,6 +1221,9 @@ static inline void
 _send_pointer_swipe_end_signal(struct cwc_cursor *cursor,
                                struct wlr_pointer_swipe_end_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.swipe_end))
+        return;
+
     struct cwc_pointer_swipe_end_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1117,7 +1234,7 @@ _send_pointer_swipe_end_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushboolean(L, event->cancelled);
 
-    cwc_signal_emit("pointer::swipe::end", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.swipe_end, &signal_data, L, 3);
 }
 
 static void on_swipe_end(struct wl_listener *listener, void *data)
@@ -1137,6 +1254,9 @@ static inline void
 _send_pointer_pinch_begin_signal(struct cwc_cursor *cursor,
                                  struct wlr_pointer_pinch_begin_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.pinch_begin))
+        return;
+
     struct cwc_pointer_pinch_begin_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1147,7 +1267,7 @@ _send_pointer_pinch_begin_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushnumber(L, event->fingers);
 
-    cwc_signal_emit("pointer::pinch::begin", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.pinch_begin, &signal_data, L, 3);
 }
 
 static void on_pinch_begin(struct wl_listener *listener, void *data)
@@ -1168,6 +1288,9 @@ static inline void
 _send_pointer_pinch_update_signal(struct cwc_cursor *cursor,
                                   struct wlr_pointer_pinch_update_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.pinch_update))
+        return;
+
     struct cwc_pointer_pinch_update_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1182,7 +1305,7 @@ _send_pointer_pinch_update_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->scale);
     lua_pushnumber(L, event->rotation);
 
-    cwc_signal_emit("pointer::pinch::update", &signal_data, L, 7);
+    cwc_signal_emit_handle(signals.pinch_update, &signal_data, L, 7);
 }
 
 static void on_pinch_update(struct wl_listener *listener, void *data)
@@ -1203,6 +1326,9 @@ static inline void
 _send_pointer_pinch_end_signal(struct cwc_cursor *cursor,
                                struct wlr_pointer_pinch_end_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.pinch_end))
+        return;
+
     struct cwc_pointer_pinch_end_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1213,7 +1339,7 @@ _send_pointer_pinch_end_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushboolean(L, event->cancelled);
 
-    cwc_signal_emit("pointer::pinch::end", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.pinch_end, &signal_data, L, 3);
 }
 
 static void on_pinch_end(struct wl_listener *listener, void *data)
@@ -1233,6 +1359,9 @@ static inline void
 _send_pointer_hold_begin_signal(struct cwc_cursor *cursor,
                                 struct wlr_pointer_hold_begin_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.hold_begin))
+        return;
+
     struct cwc_pointer_hold_begin_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1243,7 +1372,7 @@ _send_pointer_hold_begin_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushnumber(L, event->fingers);
 
-    cwc_signal_emit("pointer::hold::begin", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.hold_begin, &signal_data, L, 3);
 }
 
 static void on_hold_begin(struct wl_listener *listener, void *data)
@@ -1263,6 +1392,9 @@ static inline void
 _send_pointer_hold_end_signal(struct cwc_cursor *cursor,
                               struct wlr_pointer_hold_end_event *event)
 {
+    if (!cwc_signal_has_listeners(signals.hold_end))
+        return;
+
     struct cwc_pointer_hold_end_event signal_data = {
         .cursor = cursor,
         .event  = event,
@@ -1273,7 +1405,7 @@ _send_pointer_hold_end_signal(struct cwc_cursor *cursor,
     lua_pushnumber(L, event->time_msec);
     lua_pushboolean(L, event->cancelled);
 
-    cwc_signal_emit("pointer::hold::end", &signal_data, L, 3);
+    cwc_signal_emit_handle(signals.hold_end, &signal_data, L, 3);
 }
 
 static void on_hold_end(struct wl_listener *listener, void *data)
@@ -1421,22 +1553,25 @@ static const struct wlr_buffer_impl cairo_buffer_impl = {
 /* hyprcursor cursor animation (pre-independent hyprland) */
 static int animation_loop(void *data)
 {
-    struct cwc_cursor *cursor = data;
+    struct cwc_cursor *cursor     = data;
+    struct hyprcursor_shape *shape = cursor->shape;
+    if (!shape)
+        return 1;
 
     size_t i = ++cursor->frame_index;
-    if (i >= cursor->images_count) {
+    if (i >= shape->images_count) {
         i = cursor->frame_index = 0;
     }
 
-    struct hyprcursor_buffer **buffer_array = cursor->cursor_buffers.data;
+    struct hyprcursor_buffer **buffer_array = shape->buffers.data;
 
     wlr_cursor_set_buffer(cursor->wlr_cursor, &buffer_array[i]->base,
-                          cursor->images[i]->hotspotX / cursor->scale,
-                          cursor->images[i]->hotspotY / cursor->scale,
+                          shape->images[i]->hotspotX / cursor->scale,
+                          shape->images[i]->hotspotY / cursor->scale,
                           cursor->scale);
 
     wl_event_source_timer_update(cursor->animation_timer,
-                                 cursor->images[i]->delay);
+                                 shape->images[i]->delay);
     return 1;
 }
 
@@ -1505,6 +1640,8 @@ struct cwc_cursor *cwc_cursor_create(struct wlr_seat *seat)
         return NULL;
     }
 
+    cursor_signals_intern();
+
     // bases
     cursor->seat             = seat;
     cursor->wlr_cursor       = wlr_cursor_create();
@@ -1515,6 +1652,7 @@ struct cwc_cursor *cwc_cursor_create(struct wlr_seat *seat)
     cursor->scale       = 1.0f;
     cursor->state       = CWC_CURSOR_STATE_NORMAL;
     cursor->send_events = true;
+    wl_list_init(&cursor->shape_cache);
 
     // set_xcursor must after creating manager to load the theme
     cursor->xcursor_mgr = wlr_xcursor_manager_create(NULL, cursor->info.size);
@@ -1612,7 +1750,7 @@ struct cwc_cursor *cwc_cursor_create(struct wlr_seat *seat)
     return cursor;
 }
 
-static void hyprcursor_buffer_fini(struct cwc_cursor *cursor);
+static void hyprcursor_shape_cache_clear(struct cwc_cursor *cursor);
 
 void cwc_cursor_destroy(struct cwc_cursor *cursor)
 {
@@ -1620,9 +1758,7 @@ void cwc_cursor_destroy(struct cwc_cursor *cursor)
     luaC_object_unregister(L, cursor);
 
     // clean hyprcursor leftover
-    if (cursor->images != NULL)
-        hyprcursor_cursor_image_data_free(cursor->images, cursor->images_count);
-    hyprcursor_buffer_fini(cursor);
+    hyprcursor_shape_cache_clear(cursor);
 
     hyprcursor_style_done(cursor->hyprcursor_mgr, cursor->info);
     hyprcursor_manager_free(cursor->hyprcursor_mgr);
@@ -1664,41 +1800,138 @@ void cwc_cursor_destroy(struct cwc_cursor *cursor)
     free(cursor);
 }
 
-/* load hyprcursor buffer */
-static void hyprcursor_buffer_init(struct cwc_cursor *cursor)
+/* shape cache capacity, enough to hold all the common shapes */
+#define SHAPE_CACHE_MAX 24
+
+static void hyprcursor_shape_destroy(struct hyprcursor_shape *shape)
+{
+    struct hyprcursor_buffer **buffer;
+    wl_array_for_each(buffer, &shape->buffers)
+    {
+        wlr_buffer_drop(&(*buffer)->base);
+    }
+    wl_array_release(&shape->buffers);
+
+    if (shape->images != NULL)
+        hyprcursor_cursor_image_data_free(shape->images, shape->images_count);
+
+    wl_list_remove(&shape->link);
+    free(shape->name);
+    free(shape);
+}
+
+static void hyprcursor_shape_cache_clear(struct cwc_cursor *cursor)
+{
+    struct hyprcursor_shape *shape, *tmp;
+    wl_list_for_each_safe(shape, tmp, &cursor->shape_cache, link)
+    {
+        hyprcursor_shape_destroy(shape);
+    }
+
+    cursor->shape           = NULL;
+    cursor->shape_cache_len = 0;
+    wl_event_source_timer_update(cursor->animation_timer, 0);
+}
+
+/* drop the least recently used shape that is not currently shown */
+static void hyprcursor_shape_cache_evict(struct cwc_cursor *cursor)
+{
+    struct hyprcursor_shape *shape;
+    wl_list_for_each_reverse(shape, &cursor->shape_cache, link)
+    {
+        if (shape == cursor->shape)
+            continue;
+
+        hyprcursor_shape_destroy(shape);
+        cursor->shape_cache_len--;
+        return;
+    }
+}
+
+/* decode the shape and load the frames to wlr_buffer. Shape that doesn't exist
+ * in the theme is also cached with zero image count so the xcursor fallback
+ * doesn't query the theme again.
+ */
+static struct hyprcursor_shape *hyprcursor_shape_load(struct cwc_cursor *cursor,
+                                                      const char *name)
 {
-    wl_array_init(&cursor->cursor_buffers);
-    for (int i = 0; i < cursor->images_count; ++i) {
-        hyprcursor_cursor_image_data *image_data = cursor->images[i];
+    struct hyprcursor_shape *shape = calloc(1, sizeof(*shape));
+    if (shape == NULL) {
+        cwc_log(CWC_ERROR, "failed to allocate hyprcursor_shape");
+        return NULL;
+    }
+
+    shape->name  = strdup(name);
+    shape->size  = cursor->info.size;
+    shape->scale = cursor->scale;
+    wl_array_init(&shape->buffers);
+    wl_list_insert(&cursor->shape_cache, &shape->link);
+
+    shape->images = hyprcursor_get_cursor_image_data(
+        cursor->hyprcursor_mgr, name, cursor->info, &shape->images_count);
+
+    if (!shape->images_count) {
+        hyprcursor_cursor_image_data_free(shape->images, shape->images_count);
+        shape->images = NULL;
+    }
+
+    for (int i = 0; i < shape->images_count; ++i) {
+        hyprcursor_cursor_image_data *image_data = shape->images[i];
         struct hyprcursor_buffer *buffer         = calloc(1, sizeof(*buffer));
         if (buffer == NULL) {
             cwc_log(CWC_ERROR, "failed to allocate hyprcursor_buffer");
-            return;
+            hyprcursor_shape_destroy(shape);
+            return NULL;
         }
         buffer->surface = image_data->surface;
         wlr_buffer_init(&buffer->base, &cairo_buffer_impl, image_data->size,
                         image_data->size);
 
         struct hyprcursor_buffer **buffer_array =
-            wl_array_add(&cursor->cursor_buffers, sizeof(&image_data));
+            wl_array_add(&shape->buffers, sizeof(buffer));
         *buffer_array = buffer;
     }
+
+    if (++cursor->shape_cache_len > SHAPE_CACHE_MAX)
+        hyprcursor_shape_cache_evict(cursor);
+
+    return shape;
+}
+
+static struct hyprcursor_shape *hyprcursor_shape_get(struct cwc_cursor *cursor,
+                                                     const char *name)
+{
+    struct hyprcursor_shape *shape;
+    wl_list_for_each(shape, &cursor->shape_cache, link)
+    {
+        if (shape->size != cursor->info.size || shape->scale != cursor->scale
+            || strcmp(shape->name, name) != 0)
+            continue;
+
+        wl_list_reattach(&cursor->shape_cache, &shape->link);
+        return shape;
+    }
+
+    return hyprcursor_shape_load(cursor, name);
 }
 
-/* free hyprcursor buffer */
-static void hyprcursor_buffer_fini(struct cwc_cursor *cursor)
+static const char *common_shapes[] = {
+    "default",    "text",       "pointer",   "grabbing",
+    "col-resize", "row-resize", "n-resize",  "s-resize",
+    "e-resize",   "w-resize",   "ne-resize", "nw-resize",
+    "se-resize",  "sw-resize",  NULL,
+};
+
+void cwc_cursor_prewarm_shapes(struct cwc_cursor *cursor, const char **names)
 {
-    if (cursor->cursor_buffers.size == 0)
+    if (!hyprcursor_manager_valid(cursor->hyprcursor_mgr))
         return;
 
-    struct hyprcursor_buffer **buffer_array = cursor->cursor_buffers.data;
+    if (names == NULL)
+        names = common_shapes;
 
-    int len = cursor->cursor_buffers.size / sizeof(buffer_array);
-    for (int i = 0; i < len; i++) {
-        wlr_buffer_drop(&buffer_array[i]->base);
-    }
-    wl_array_release(&cursor->cursor_buffers);
-    cursor->cursor_buffers.size = 0;
+    for (; *names; names++)
+        hyprcursor_shape_get(cursor, *names);
 }
 
 void cwc_cursor_set_image_by_name(struct cwc_cursor *cursor, const char *name)
@@ -1723,43 +1956,34 @@ void cwc_cursor_set_image_by_name(struct cwc_cursor *cursor, const char *name)
     cursor->current_name       = name;
     cursor->name_before_hidden = NULL;
 
-    hyprcursor_buffer_fini(cursor);
-
     // xcursor fallback
     if (!hyprcursor_manager_valid(cursor->hyprcursor_mgr)) {
         wlr_cursor_set_xcursor(cursor->wlr_cursor, cursor->xcursor_mgr, name);
         return;
     }
 
-    // free prev images
-    if (cursor->images != NULL)
-        hyprcursor_cursor_image_data_free(cursor->images, cursor->images_count);
-
-    cursor->images = hyprcursor_get_cursor_image_data(
-        cursor->hyprcursor_mgr, name, cursor->info, &cursor->images_count);
+    struct hyprcursor_shape *shape = hyprcursor_shape_get(cursor, name);
 
     // xcursor fallback
-    if (!cursor->images_count) {
-        hyprcursor_cursor_image_data_free(cursor->images, cursor->images_count);
-        cursor->images = NULL;
+    if (!shape || !shape->images_count) {
+        cursor->shape = NULL;
+        wl_event_source_timer_update(cursor->animation_timer, 0);
         wlr_cursor_set_xcursor(cursor->wlr_cursor, cursor->xcursor_mgr, name);
         return;
     }
 
-    // cache buffer
-    hyprcursor_buffer_init(cursor);
-
-    struct hyprcursor_buffer **buffer_array = cursor->cursor_buffers.data;
+    cursor->shape                           = shape;
+    struct hyprcursor_buffer **buffer_array = shape->buffers.data;
 
     wlr_cursor_set_buffer(cursor->wlr_cursor, &buffer_array[0]->base,
-                          cursor->images[0]->hotspotX / cursor->scale,
-                          cursor->images[0]->hotspotY / cursor->scale,
+                          shape->images[0]->hotspotX / cursor->scale,
+                          shape->images[0]->hotspotY / cursor->scale,
                           cursor->scale);
 
-    if (cursor->images_count > 1) {
+    if (shape->images_count > 1) {
         cursor->frame_index = 0;
         wl_event_source_timer_update(cursor->animation_timer,
-                                     cursor->images[0]->delay);
+                                     shape->images[0]->delay);
     } else {
         wl_event_source_timer_update(cursor->animation_timer, 0);
     }
@@ -1803,7 +2027,8 @@ void cwc_cursor_hide_cursor(struct cwc_cursor *cursor)
 
 void cwc_cursor_update_scale(struct cwc_cursor *cursor)
 {
-    cursor->scale = 1.0f;
+    float old_scale = cursor->scale;
+    cursor->scale   = 1.0f;
     struct cwc_output *output;
     wl_list_for_each(output, &server.outputs, link)
     {
@@ -1815,6 +2040,8 @@ void cwc_cursor_update_scale(struct cwc_cursor *cursor)
         struct hyprcursor_cursor_style_info new = {.size = g_config.cursor_size
                                                            * cursor->scale};
         cwc_cursor_hyprcursor_change_style(cursor, new);
+    } else if (old_scale != cursor->scale) {
+        hyprcursor_shape_cache_clear(cursor);
     }
 
     /* reset old buffer and update to new style */
@@ -1832,7 +2059,7 @@ bool cwc_cursor_hyprcursor_change_style(
     // force reset image
     cursor->current_name = NULL;
 
-    hyprcursor_buffer_fini(cursor);
+    hyprcursor_shape_cache_clear(cursor);
     hyprcursor_style_done(cursor->hyprcursor_mgr, cursor->info);
 
     info.size = g_config.cursor_size * cursor->scale;
@@ -1841,6 +2068,7 @@ bool cwc_cursor_hyprcursor_change_style(
         && hyprcursor_load_theme_style(cursor->hyprcursor_mgr, info)) {
         cursor->info      = info;
         cursor->info.size = info.size;
+        cwc_cursor_prewarm_shapes(cursor, NULL);
         return true;
     }
 
@@ -56,15 +56,47 @@ static bool _keybind_execute(struct cwc_keybind_map *kmap,
                              struct cwc_keybind_info *info,
                              bool press);
 
+/* maps with a running repeat timer so that a key release doesn't need to touch
+ * the timer of every map */
+static struct wl_list repeating_kmaps = {&repeating_kmaps, &repeating_kmaps};
+
+/* The default keyboard map and every active map merged into a single hash map
+ * so a key event is one lookup no matter how many maps exist. The bindings are
+ * grouped by key in `binds` with the default map first, the hash map value is
+ * the group start index + 1.
+ */
+struct kbd_index_bind {
+    uint64_t key;
+    int order;
+    struct cwc_keybind_map *kmap;
+    struct cwc_keybind_info *info;
+};
+
+static struct {
+    struct cwc_hhmap *map;
+    struct wl_array binds; // struct kbd_index_bind
+    bool dirty;
+    uint64_t generation; // bumped on every change to detect it in callback
+} kbd_index = {.dirty = true};
+
+void cwc_keybind_index_mark_dirty()
+{
+    kbd_index.dirty = true;
+    kbd_index.generation++;
+}
+
 static int repeat_loop(void *data)
 {
     struct cwc_keybind_map *kmap = data;
+    int rate                     = kmap->repeated_bind->repeat_rate;
 
     _keybind_execute(kmap, kmap->repeated_bind, true);
 
-    int repeat_rate = kmap->repeated_bind->repeat_rate
-                          ? 1000 / kmap->repeated_bind->repeat_rate
-                          : 2000 / g_config.repeat_rate;
+    /* the callback may unbind itself or clear the map */
+    if (!kmap->repeated_bind)
+        return 0;
+
+    int repeat_rate = rate ? 1000 / rate : 2000 / g_config.repeat_rate;
 
     wl_event_source_timer_update(kmap->repeat_timer, repeat_rate);
 
@@ -81,16 +113,19 @@ static void _register_kmap_object(void *data)
 struct cwc_keybind_map *cwc_keybind_map_create(struct wl_list *list)
 {
     struct cwc_keybind_map *kmap = calloc(1, sizeof(*kmap));
-    kmap->map                    = cwc_hhmap_create(0);
+    kmap->map                    = cwc_hhmap_create_keyed(0);
     kmap->active                 = true;
     kmap->repeat_timer =
         wl_event_loop_add_timer(server.wl_event_loop, repeat_loop, kmap);
+    wl_list_init(&kmap->repeat_link);
 
     if (list)
         wl_list_insert(list->prev, &kmap->link);
     else
         wl_list_init(&kmap->link);
 
+    cwc_keybind_index_mark_dirty();
+
     if (g_config_get_lua_State()) {
         _register_kmap_object(kmap);
     } else {
@@ -107,6 +142,7 @@ void cwc_keybind_map_destroy(struct cwc_keybind_map *kmap)
 {
     luaC_object_unregister(g_config_get_lua_State(), kmap);
 
+    cwc_keybind_map_stop_repeat(kmap);
     cwc_keybind_map_clear(kmap);
     cwc_hhmap_destroy(kmap->map);
     wl_event_source_remove(kmap->repeat_timer);
@@ -153,15 +189,33 @@ static void _keybind_clear(struct cwc_hhmap *kmap)
 void cwc_keybind_map_clear(struct cwc_keybind_map *kmap)
 {
     struct cwc_hhmap **map = &kmap->map;
+    cwc_keybind_map_stop_repeat(kmap);
     _keybind_clear(*map);
     cwc_hhmap_destroy(*map);
-    *map = cwc_hhmap_create(8);
+    *map = cwc_hhmap_create_keyed(8);
+
+    cwc_keybind_index_mark_dirty();
 }
 
 void cwc_keybind_map_stop_repeat(struct cwc_keybind_map *kmap)
 {
+    if (!kmap->repeated_bind)
+        return;
+
     wl_event_source_timer_update(kmap->repeat_timer, 0);
     kmap->repeated_bind = NULL;
+    wl_list_remove(&kmap->repeat_link);
+    wl_list_init(&kmap->repeat_link);
+}
+
+void keybind_kbd_stop_repeat()
+{
+    struct cwc_keybind_map *kmap, *tmp;
+    wl_list_for_each_safe(kmap, tmp, &repeating_kmaps, repeat_link)
+    {
+        if (kmap != server.main_mouse_kmap)
+            cwc_keybind_map_stop_repeat(kmap);
+    }
 }
 
 static void _keybind_remove_if_exist(struct cwc_keybind_map *kmap,
@@ -182,6 +236,7 @@ void keybind_register(struct cwc_keybind_map *kmap,
 
     cwc_hhmap_ninsert(kmap->map, &generated_key, GENERATED_KEY_LENGTH,
                       info_dup);
+    cwc_keybind_index_mark_dirty();
 
     luaC_object_kbind_register(g_config_get_lua_State(), info_dup);
 }
@@ -194,8 +249,12 @@ static void _keybind_remove_if_exist(struct cwc_keybind_map *kmap,
     if (!existed)
         return;
 
+    if (kmap->repeated_bind == existed)
+        cwc_keybind_map_stop_repeat(kmap);
+
     cwc_keybind_info_destroy(existed);
     cwc_hhmap_nremove(kmap->map, &generated_key, GENERATED_KEY_LENGTH);
+    cwc_keybind_index_mark_dirty();
 }
 
 void keybind_remove(struct cwc_keybind_map *kmap,
@@ -212,6 +271,14 @@ static bool _keybind_execute(struct cwc_keybind_map *kmap,
 {
     lua_State *L = g_config_get_lua_State();
     int idx;
+
+    /* the callback may free info so keep what's needed after it */
+    uint64_t key        = info->key;
+    bool repeat         = info->repeat;
+    bool pass           = info->pass;
+    bool was_repeating  = kmap->repeated_bind == info;
+    uint64_t generation = kbd_index.generation;
+
     switch (info->type) {
     case CWC_KEYBIND_TYPE_LUA:
         if (press)
@@ -237,17 +304,30 @@ static bool _keybind_execute(struct cwc_keybind_map *kmap,
         break;
     }
 
-    if (press && info->repeat && !kmap->repeated_bind) {
+    /* the bindings changed, only arm the repeat if info is still alive */
+    if (generation != kbd_index.generation
+        && cwc_hhmap_nget(kmap->map, &key, GENERATED_KEY_LENGTH) != info)
+        return !pass;
+
+    if (press && repeat && !was_repeating && !kmap->repeated_bind) {
         kmap->repeated_bind = info;
+        wl_list_insert(&repeating_kmaps, &kmap->repeat_link);
         wl_event_source_timer_update(kmap->repeat_timer, g_config.repeat_delay);
     }
 
-    if (info->pass)
+    if (pass)
         return false;
 
     return true;
 }
 
+static inline bool keybind_allowed(struct cwc_keybind_info *info,
+                                   struct cwc_seat *seat)
+{
+    return info->exclusive
+           || !(server.session_lock->locked || seat->kbd_inhibitor);
+}
+
 bool keybind_kbd_execute(struct cwc_keybind_map *kmap,
                          struct cwc_seat *seat,
                          uint32_t modifiers,
@@ -261,13 +341,116 @@ bool keybind_kbd_execute(struct cwc_keybind_map *kmap,
     if (info == NULL)
         return false;
 
-    if (!info->exclusive
-        && (server.session_lock->locked || seat->kbd_inhibitor))
+    if (!keybind_allowed(info, seat))
         return false;
 
     return _keybind_execute(kmap, info, press);
 }
 
+static void kbd_index_add_map(struct cwc_keybind_map *kmap, int *order)
+{
+    struct cwc_hhmap *map = kmap->map;
+    for (size_t i = 0; i < map->alloc; i++) {
+        struct hhash_entry *elem = &map->table[i];
+        if (!elem->hash)
+            continue;
+
+        struct kbd_index_bind *bind =
+            wl_array_add(&kbd_index.binds, sizeof(*bind));
+        if (!bind)
+            return;
+
+        struct cwc_keybind_info *info = elem->data;
+        bind->key                     = info->key;
+        bind->order                   = (*order)++;
+        bind->kmap                    = kmap;
+        bind->info                    = info;
+    }
+}
+
+static int kbd_index_bind_cmp(const void *a, const void *b)
+{
+    const struct kbd_index_bind *x = a;
+    const struct kbd_index_bind *y = b;
+
+    if (x->key != y->key)
+        return x->key < y->key ? -1 : 1;
+
+    return x->order - y->order;
+}
+
+static void kbd_index_rebuild()
+{
+    if (kbd_index.map)
+        cwc_hhmap_destroy(kbd_index.map);
+
+    kbd_index.binds.size = 0;
+
+    int order = 0;
+    kbd_index_add_map(server.main_kbd_kmap, &order);
+
+    struct cwc_keybind_map *kmap;
+    wl_list_for_each(kmap, &server.kbd_kmaps, link)
+    {
+        if (kmap->active)
+            kbd_index_add_map(kmap, &order);
+    }
+
+    // group the same key together while keeping the map order
+    struct kbd_index_bind *binds = kbd_index.binds.data;
+    size_t count                 = kbd_index.binds.size / sizeof(*binds);
+    qsort(binds, count, sizeof(*binds), kbd_index_bind_cmp);
+
+    kbd_index.map = cwc_hhmap_create(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i && binds[i].key == binds[i - 1].key)
+            continue;
+
+        cwc_hhmap_ninsert(kbd_index.map, &binds[i].key, GENERATED_KEY_LENGTH,
+                          (void *)(uintptr_t)(i + 1));
+    }
+
+    kbd_index.dirty = false;
+    kbd_index.generation++;
+}
+
+bool keybind_kbd_dispatch(struct cwc_seat *seat,
+                          uint32_t modifiers,
+                          xkb_keysym_t key,
+                          bool press)
+{
+    if (kbd_index.dirty)
+        kbd_index_rebuild();
+
+    uint64_t generated_key = keybind_generate_key(modifiers, key);
+    uintptr_t start =
+        (uintptr_t)cwc_hhmap_nget(kbd_index.map, &generated_key,
+                                  GENERATED_KEY_LENGTH);
+    if (!start)
+        return false;
+
+    struct kbd_index_bind *binds = kbd_index.binds.data;
+    size_t count                 = kbd_index.binds.size / sizeof(*binds);
+    uint64_t gen                 = kbd_index.generation;
+    bool handled                 = false;
+
+    for (size_t i = start - 1; i < count; i++) {
+        if (binds[i].key != generated_key)
+            break;
+
+        if (!keybind_allowed(binds[i].info, seat))
+            continue;
+
+        handled |= _keybind_execute(binds[i].kmap, binds[i].info, press);
+
+        // the callback changed the maps, the rest of the group may be freed
+        if (gen != kbd_index.generation)
+            break;
+    }
+
+    return handled;
+}
+
 bool keybind_mouse_execute(struct cwc_keybind_map *kmap,
                            uint32_t modifiers,
                            uint32_t button,
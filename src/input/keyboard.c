@@ -48,6 +48,16 @@
 #include "cwc/util.h"
 #include "lua.h"
 
+/* resolved once in cwc_keyboard_group_create */
+static struct {
+    cwc_signal_handle_t pressed;
+    cwc_signal_handle_t released;
+    cwc_signal_handle_t layout_index;
+} signals;
+
+/* pressed keycodes sent on keyboard enter, at most the wlr_keyboard cap */
+CWC_VEC_DEFINE(keycode_vec, uint32_t, WLR_KEYBOARD_KEYS_CAP)
+
 /**
  * Returns NULL if the keyboard is not grabbed by an input method,
  * or if event is from virtual keyboard of the same client as grab.
@@ -100,8 +110,9 @@ static void on_kbd_group_modifiers(struct wl_listener *listener, void *data)
                                    XKB_STATE_LAYOUT_EFFECTIVE);
 
     if (kbd_group->layout_idx != active_index) {
-        cwc_object_emit_signal_simple("kbd::prop::layout_index",
-                                      g_config_get_lua_State(), kbd_group);
+        cwc_object_emit_signal_handle_simple(signals.layout_index,
+                                             g_config_get_lua_State(),
+                                             kbd_group);
         kbd_group->layout_idx = active_index;
     }
 
@@ -112,6 +123,12 @@ static void _send_kbd_key_signal(struct cwc_keyboard_group *kbd_group,
                                  struct wlr_keyboard_key_event *event,
                                  xkb_keysym_t keysym)
 {
+    cwc_signal_handle_t handle =
+        event->state == WL_KEYBOARD_KEY_STATE_PRESSED ? signals.pressed
+                                                      : signals.released;
+    if (!cwc_signal_has_listeners(handle))
+        return;
+
     lua_State *L = g_config_get_lua_State();
     if (!luaC_object_valid(L, kbd_group))
         return;
@@ -132,10 +149,10 @@ static void _send_kbd_key_signal(struct cwc_keyboard_group *kbd_group,
 
     switch (event->state) {
     case WL_KEYBOARD_KEY_STATE_PRESSED:
-        cwc_signal_emit("kbd::pressed", &cwc_event, L, 3);
+        cwc_signal_emit_handle(signals.pressed, &cwc_event, L, 3);
         break;
     case WL_KEYBOARD_KEY_STATE_RELEASED:
-        cwc_signal_emit("kbd::released", &cwc_event, L, 3);
+        cwc_signal_emit_handle(signals.released, &cwc_event, L, 3);
         break;
     default:
         cwc_log(CWC_ERROR, "TODO: handle repeat");
@@ -143,6 +160,29 @@ static void _send_kbd_key_signal(struct cwc_keyboard_group *kbd_group,
     }
 }
 
+static inline bool handled_key_test(struct cwc_keyboard_group *kbd_group,
+                                    uint32_t keycode)
+{
+    if (keycode >= CWC_HANDLED_KEYCODE_MAX)
+        return false;
+
+    return kbd_group->handled_keys[keycode / 64] & (1ULL << (keycode % 64));
+}
+
+static inline void handled_key_set(struct cwc_keyboard_group *kbd_group,
+                                   uint32_t keycode)
+{
+    if (keycode < CWC_HANDLED_KEYCODE_MAX)
+        kbd_group->handled_keys[keycode / 64] |= 1ULL << (keycode % 64);
+}
+
+static inline void handled_key_clear(struct cwc_keyboard_group *kbd_group,
+                                     uint32_t keycode)
+{
+    if (keycode < CWC_HANDLED_KEYCODE_MAX)
+        kbd_group->handled_keys[keycode / 64] &= ~(1ULL << (keycode % 64));
+}
+
 static void process_key_event(struct cwc_keyboard_group *kbd_group,
                               struct wlr_keyboard_key_event *event)
 {
@@ -155,67 +195,37 @@ static void process_key_event(struct cwc_keyboard_group *kbd_group,
     // translate libinput keycode -> xkbcommon
     int keycode = event->keycode + 8;
 
-    // create an empty state to get untransformed keysym so that for keybinds we
+    // use untransformed keysym of the first layout so that for keybinds we
     // don't need to account keyname change when the modifier is changed.
     // It will also look more readable e.g. MOD + "1" | MOD + SHIFT + "1"
     // while using transformed is MOD + "1" + MOD | SHIFT + "exclam".
-    struct xkb_state *state = xkb_state_new(wlr_kbd->keymap);
-    const xkb_keysym_t *syms;
-    int nsyms = xkb_state_key_get_syms(state, keycode, &syms);
-    xkb_state_unref(state);
-
-    uint32_t keysym = XKB_KEY_NoSymbol;
-    if (nsyms)
-        keysym = syms[0];
+    uint32_t keysym =
+        cwc_keyboard_group_get_base_keysym(kbd_group, keycode, 0);
 
     uint32_t modifiers = wlr_keyboard_get_modifiers(wlr_kbd);
     bool handled       = 0;
 
-    struct cwc_keybind_map *kmap;
-    int vec_idx;
     switch (event->state) {
     case WL_KEYBOARD_KEY_STATE_PRESSED:
-        /* should just check if the keybind exist but I'm gonna pop it
-         * afterward if the key is not a keybind
+        /* mark it before executing since the keybind may change the focus
+         * and the key must not be sent to the new focused surface.
          */
-        vec_idx = cwc_vec_find(kbd_group->handled_tracker,
-                               (void *)(uintptr_t)keycode);
-        if (vec_idx == -1)
-            cwc_vec_push(kbd_group->handled_tracker,
-                         (void *)(uintptr_t)keycode);
-
-        handled |= keybind_kbd_execute(server.main_kbd_kmap, seat, modifiers,
-                                       keysym, true);
-        wl_list_for_each(kmap, &server.kbd_kmaps, link)
-        {
-            if (kmap->active)
-                handled |=
-                    keybind_kbd_execute(kmap, seat, modifiers, keysym, true);
-        }
+        handled_key_set(kbd_group, keycode);
+
+        handled = keybind_kbd_dispatch(seat, modifiers, keysym, true);
 
         if (!handled)
-            cwc_vec_pop(kbd_group->handled_tracker);
+            handled_key_clear(kbd_group, keycode);
 
         break;
     case WL_KEYBOARD_KEY_STATE_RELEASED:
-        vec_idx = cwc_vec_find(kbd_group->handled_tracker,
-                               (void *)(uintptr_t)keycode);
-        if (vec_idx != -1) {
+        if (handled_key_test(kbd_group, keycode)) {
             handled = true;
-            cwc_vec_pop_at(kbd_group->handled_tracker, vec_idx);
+            handled_key_clear(kbd_group, keycode);
         }
 
-        keybind_kbd_execute(server.main_kbd_kmap, seat, modifiers, keysym,
-                            false);
-        cwc_keybind_map_stop_repeat(server.main_kbd_kmap);
-
-        wl_list_for_each(kmap, &server.kbd_kmaps, link)
-        {
-            if (kmap->active)
-                keybind_kbd_execute(kmap, seat, modifiers, keysym, false);
-
-            cwc_keybind_map_stop_repeat(kmap);
-        }
+        keybind_kbd_dispatch(seat, modifiers, keysym, false);
+        keybind_kbd_stop_repeat();
         break;
     default:
         cwc_log(CWC_ERROR, "TODO: HANDLE REPEAT");
@@ -356,6 +366,75 @@ void cwc_keyboard_update_keymap(struct wlr_keyboard *wlr_kbd)
     xkb_context_unref(ctx);
 }
 
+static void keysym_table_build(struct cwc_keyboard_group *kbd_group)
+{
+    struct xkb_keymap *keymap = kbd_group->wlr_kbd_group->keyboard.keymap;
+
+    free(kbd_group->keysym_table.syms);
+    kbd_group->keysym_table.syms          = NULL;
+    kbd_group->keysym_table.keycode_count = 0;
+    kbd_group->keysym_table.num_layouts   = 0;
+
+    if (!keymap)
+        return;
+
+    xkb_keycode_t min_keycode = xkb_keymap_min_keycode(keymap);
+    xkb_keycode_t keycode_count =
+        xkb_keymap_max_keycode(keymap) - min_keycode + 1;
+    xkb_layout_index_t num_layouts = xkb_keymap_num_layouts(keymap);
+
+    // calloc also fill it with XKB_KEY_NoSymbol
+    xkb_keysym_t *table =
+        calloc((size_t)keycode_count * num_layouts, sizeof(*table));
+    if (!table)
+        return;
+
+    for (xkb_layout_index_t layout = 0; layout < num_layouts; layout++) {
+        for (xkb_keycode_t i = 0; i < keycode_count; i++) {
+            xkb_keycode_t keycode = min_keycode + i;
+            xkb_layout_index_t key_layouts =
+                xkb_keymap_num_layouts_for_key(keymap, keycode);
+            if (!key_layouts)
+                continue;
+
+            const xkb_keysym_t *syms;
+            int nsyms = xkb_keymap_key_get_syms_by_level(
+                keymap, keycode, layout % key_layouts, 0, &syms);
+            if (nsyms)
+                table[layout * keycode_count + i] = syms[0];
+        }
+    }
+
+    kbd_group->keysym_table.syms          = table;
+    kbd_group->keysym_table.min_keycode   = min_keycode;
+    kbd_group->keysym_table.keycode_count = keycode_count;
+    kbd_group->keysym_table.num_layouts   = num_layouts;
+}
+
+xkb_keysym_t
+cwc_keyboard_group_get_base_keysym(struct cwc_keyboard_group *kbd_group,
+                                   xkb_keycode_t keycode,
+                                   xkb_layout_index_t layout)
+{
+    xkb_keycode_t idx = keycode - kbd_group->keysym_table.min_keycode;
+
+    if (keycode < kbd_group->keysym_table.min_keycode
+        || idx >= kbd_group->keysym_table.keycode_count
+        || layout >= kbd_group->keysym_table.num_layouts)
+        return XKB_KEY_NoSymbol;
+
+    return kbd_group->keysym_table
+        .syms[layout * kbd_group->keysym_table.keycode_count + idx];
+}
+
+static void on_kbd_group_keymap(struct wl_listener *listener, void *data)
+{
+    struct cwc_keyboard_group *kbd_group =
+        wl_container_of(listener, kbd_group, keymap_l);
+
+    keysym_table_build(kbd_group);
+}
+
 struct cwc_keyboard_group *
 cwc_keyboard_group_create(struct cwc_seat *seat,
                           struct wlr_virtual_keyboard_v1 *virtual)
@@ -366,18 +445,24 @@ cwc_keyboard_group_create(struct cwc_seat *seat,
 
     cwc_log(CWC_DEBUG, "creating keyboard group: %p", kbd_group);
 
+    signals.pressed      = cwc_signal_intern("kbd::pressed");
+    signals.released     = cwc_signal_intern("kbd::released");
+    signals.layout_index = cwc_signal_intern("kbd::prop::layout_index");
+
     kbd_group->wlr_kbd_group                = wlr_keyboard_group_create();
     kbd_group->wlr_kbd_group->keyboard.data = kbd_group;
     kbd_group->seat                         = seat;
     kbd_group->send_events                  = true;
-    kbd_group->handled_tracker = cwc_vec_create(sizeof(uint32_t), 4);
 
     kbd_group->modifiers_l.notify = on_kbd_group_modifiers;
     kbd_group->key_l.notify       = on_kbd_group_key;
+    kbd_group->keymap_l.notify    = on_kbd_group_keymap;
     wl_signal_add(&kbd_group->wlr_kbd_group->keyboard.events.modifiers,
                   &kbd_group->modifiers_l);
     wl_signal_add(&kbd_group->wlr_kbd_group->keyboard.events.key,
                   &kbd_group->key_l);
+    wl_signal_add(&kbd_group->wlr_kbd_group->keyboard.events.keymap,
+                  &kbd_group->keymap_l);
 
     if (virtual) {
         kbd_group->vkbd = virtual;
@@ -408,11 +493,12 @@ void cwc_keyboard_group_destroy(struct cwc_keyboard_group *kbd_group)
 
     wl_list_remove(&kbd_group->modifiers_l.link);
     wl_list_remove(&kbd_group->key_l.link);
+    wl_list_remove(&kbd_group->keymap_l.link);
 
     wl_list_remove(&kbd_group->config_commit_l.link);
 
     wlr_keyboard_group_destroy(kbd_group->wlr_kbd_group);
-    cwc_vec_destroy(kbd_group->handled_tracker);
+    free(kbd_group->keysym_table.syms);
     free(kbd_group);
 }
 
@@ -535,20 +621,18 @@ inline void keyboard_focus_surface(struct cwc_seat *seat,
 
     if (kbd && surface) {
         /* skip keybind key when notifying client */
-        struct cwc_vec *keycode_vec = cwc_vec_create(sizeof(uint32_t), 4);
-        for (int i = 0; i < kbd->num_keycodes; i++) {
-            uintptr_t elem = kbd->keycodes[i];
-            if (cwc_vec_find(seat->kbd_group->handled_tracker,
-                             (void *)(uintptr_t)elem + 8)
-                == -1)
-                cwc_vec_push(keycode_vec, (void *)(uintptr_t)elem);
+        struct keycode_vec keycodes;
+        keycode_vec_init(&keycodes);
+        for (size_t i = 0; i < kbd->num_keycodes; i++) {
+            uint32_t keycode = kbd->keycodes[i];
+            if (!handled_key_test(seat->kbd_group, keycode + 8))
+                keycode_vec_push(&keycodes, keycode);
         }
 
-        wlr_seat_keyboard_notify_enter(seat->wlr_seat, surface,
-                                       keycode_vec->data, keycode_vec->count,
-                                       &kbd->modifiers);
+        wlr_seat_keyboard_notify_enter(seat->wlr_seat, surface, keycodes.data,
+                                       keycodes.count, &kbd->modifiers);
 
-        cwc_vec_destroy(keycode_vec);
+        keycode_vec_fini(&keycodes);
     } else {
         wlr_seat_keyboard_notify_enter(seat->wlr_seat, surface, NULL, 0, NULL);
     }
@@ -20,6 +20,20 @@
 
 #include "cwc/ipc.h"
 
+void ipc_write_header(char *dest, enum cwc_ipc_opcode opcode, uint32_t n)
+{
+    int hlen = sizeof(IPC_HEADER);
+
+    memcpy(dest, IPC_HEADER, hlen - 1);
+    dest[hlen - 1] = '\n';
+    dest[hlen]     = opcode;
+    dest[hlen + 1] = '\n';
+    dest[hlen + 2] = n & 0xff;
+    dest[hlen + 3] = (n >> 8) & 0xff;
+    dest[hlen + 4] = (n >> 16) & 0xff;
+    dest[hlen + 5] = (n >> 24) & 0xff;
+}
+
 int ipc_create_message_n(
     char *dest, int maxlen, enum cwc_ipc_opcode opcode, const char *body, int n)
 {
@@ -28,10 +42,8 @@ int ipc_create_message_n(
     if (num_written > maxlen)
         return -1;
 
-    strcpy(dest, IPC_HEADER);
-    char opcstr[4] = {'\n', opcode, '\n', '\x00'};
-    strcat(dest, opcstr);
-    strncat(dest, body, n);
+    ipc_write_header(dest, opcode, n);
+    memcpy(dest + HEADER_SIZE, body, n);
 
     return num_written;
 }
@@ -67,5 +79,29 @@ const char *ipc_get_body(const char *msg, enum cwc_ipc_opcode *opcode)
         *opcode = msg[hlen];
     }
 
-    return &msg[hlen + 2];
+    return &msg[HEADER_SIZE];
+}
+
+uint32_t ipc_get_body_length(const char *msg)
+{
+    const unsigned char *len =
+        (const unsigned char *)msg + sizeof(IPC_HEADER) + 2;
+
+    return len[0] | len[1] << 8 | len[2] << 16 | (uint32_t)len[3] << 24;
+}
+
+int ipc_message_size(const char *msg, int len)
+{
+    if (len < (int)HEADER_SIZE)
+        return 0;
+
+    if (!check_header(msg))
+        return -1;
+
+    uint32_t body_len = ipc_get_body_length(msg);
+    if (body_len > IPC_MAX_BODY)
+        return -1;
+
+    int size = HEADER_SIZE + body_len;
+    return len >= size ? size : 0;
 }
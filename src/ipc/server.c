@@ -16,6 +16,9 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
+#include <errno.h>
 #include <fcntl.h>
 #include <lauxlib.h>
 #include <lua.h>
@@ -32,16 +35,62 @@
 #include "cwc/config.h"
 #include "cwc/ipc.h"
 #include "cwc/server.h"
+#include "cwc/signal.h"
 #include "cwc/util.h"
 #include "lauxlib.h"
 
-#define BUFFER_SIZE 1e6
+#define READ_CHUNK_SIZE 65536
+
+/* signal is dropped for the client that doesn't read fast enough, the eval
+ * response is always queued since the client is waiting for it.
+ */
+#define SIGNAL_BACKLOG_LIMIT (256 * 1024)
+
+/* the client that doesn't read at all is disconnected */
+#define OUTPUT_HARD_LIMIT (16 * 1024 * 1024)
+
+/* signal entry is never freed so the name that doesn't exist yet is only
+ * interned within these limits, otherwise any client can grow the signal map
+ * without bound.
+ */
+#define SUBSCRIPTION_MAX        256
+#define SUBSCRIPTION_NAME_MAX   128
+#define SUBSCRIPTION_INTERN_MAX 4096
+
+/* compiled eval chunk kept in the lua registry, a script from a file is usually
+ * run once so only small chunk is cached.
+ */
+#define EVAL_CACHE_MAX        64
+#define EVAL_CACHE_MAX_SOURCE (16 * 1024)
+
+struct eval_chunk {
+    struct wl_list link; // eval_cache.lru, most recent first
+    char *source;
+    size_t len;
+    int ref; // compiled function in the lua registry
+};
+
+static struct {
+    struct cwc_hhmap *map; // source -> struct eval_chunk
+    struct wl_list lru;
+    int count;
+    uint64_t hits;
+    uint64_t misses;
+} eval_cache;
 
 struct wl_list client_list;
 struct ipc_client {
     struct wl_list link; // client_list
     int fd;
     struct wl_event_source *event_source;
+
+    struct wl_array in;  // received bytes that doesn't form a full message yet
+    struct wl_array out; // bytes that the socket hasn't accepted yet
+    size_t out_offset;   // sent bytes at the start of out
+    bool writable_armed;
+
+    struct wl_array subscriptions; // cwc_signal_handle_t
+    uint64_t dropped_signals;      // since the last dropped notice
 };
 
 static void ipc_client_close(struct ipc_client *c)
@@ -53,80 +102,473 @@ static void ipc_client_close(struct ipc_client *c)
     wl_list_remove(&c->link);
     wl_event_source_remove(c->event_source);
 
+    cwc_signal_handle_t *handle;
+    wl_array_for_each(handle, &c->subscriptions)
+    {
+        (*handle)->ipc_subscribers--;
+    }
+
+    wl_array_release(&c->subscriptions);
+    wl_array_release(&c->in);
+    wl_array_release(&c->out);
     free(c);
 }
 
-static void handle_eval_msg(int fd, char *msg_buffer)
+static inline size_t ipc_client_pending_output(struct ipc_client *c)
+{
+    return c->out.size - c->out_offset;
+}
+
+static void ipc_client_set_writable(struct ipc_client *c, bool writable)
+{
+    if (c->writable_armed == writable)
+        return;
+
+    uint32_t mask = WL_EVENT_READABLE;
+    if (writable)
+        mask |= WL_EVENT_WRITABLE;
+
+    wl_event_source_fd_update(c->event_source, mask);
+    c->writable_armed = writable;
+}
+
+/* write as much as the socket accept, return false if the client is closed */
+static bool ipc_client_flush(struct ipc_client *c)
+{
+    if (ipc_client_pending_output(c) > OUTPUT_HARD_LIMIT) {
+        cwc_log(CWC_ERROR, "ipc client fd %d is not reading, disconnecting",
+                c->fd);
+        ipc_client_close(c);
+        return false;
+    }
+
+    while (ipc_client_pending_output(c)) {
+        ssize_t sent = send(c->fd, (char *)c->out.data + c->out_offset,
+                            ipc_client_pending_output(c),
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+
+            ipc_client_close(c);
+            return false;
+        }
+
+        c->out_offset += sent;
+    }
+
+    if (!ipc_client_pending_output(c)) {
+        c->out.size   = 0;
+        c->out_offset = 0;
+    } else if (c->out_offset > c->out.size / 2) {
+        // reclaim the sent part so the buffer doesn't grow forever
+        memmove(c->out.data, (char *)c->out.data + c->out_offset,
+                ipc_client_pending_output(c));
+        c->out.size -= c->out_offset;
+        c->out_offset = 0;
+    }
+
+    ipc_client_set_writable(c, ipc_client_pending_output(c) > 0);
+
+    return true;
+}
+
+/* append a message to the output buffer without sending it so the client is
+ * never closed here, the body may be split into two part to avoid copying.
+ */
+static void ipc_client_queue(struct ipc_client *c,
+                             enum cwc_ipc_opcode opcode,
+                             const char *body,
+                             size_t len,
+                             const char *body2,
+                             size_t len2)
+{
+    if (len + len2 > IPC_MAX_BODY) {
+        len  = MIN(len, IPC_MAX_BODY);
+        len2 = IPC_MAX_BODY - len;
+    }
+
+    char *dest = wl_array_add(&c->out, HEADER_SIZE + len + len2);
+    if (!dest)
+        return;
+
+    ipc_write_header(dest, opcode, len + len2);
+    memcpy(dest + HEADER_SIZE, body, len);
+    if (len2)
+        memcpy(dest + HEADER_SIZE + len, body2, len2);
+}
+
+static void eval_chunk_destroy(lua_State *L, struct eval_chunk *chunk)
 {
-    const char *body = ipc_get_body(msg_buffer, NULL);
+    if (L)
+        luaL_unref(L, LUA_REGISTRYINDEX, chunk->ref);
+
+    cwc_hhmap_nremove(eval_cache.map, chunk->source, chunk->len);
+    wl_list_remove(&chunk->link);
+    eval_cache.count--;
+    free(chunk->source);
+    free(chunk);
+}
 
+/* the old lua state is already closed so there's nothing to unref */
+static void eval_cache_clear(void *data)
+{
+    struct eval_chunk *chunk, *tmp;
+    wl_list_for_each_safe(chunk, tmp, &eval_cache.lru, link)
+    {
+        eval_chunk_destroy(NULL, chunk);
+    }
+}
+
+/* push the compiled body, same return value and stack effect as
+ * luaL_loadbuffer.
+ */
+static int eval_chunk_push(lua_State *L, const char *body, size_t len)
+{
+    struct eval_chunk *chunk = cwc_hhmap_nget(eval_cache.map, body, len);
+
+    // the map only compare the hash
+    if (chunk && chunk->len == len && !memcmp(chunk->source, body, len)) {
+        eval_cache.hits++;
+        wl_list_reattach(&eval_cache.lru, &chunk->link);
+        lua_rawgeti(L, LUA_REGISTRYINDEX, chunk->ref);
+        return 0;
+    }
+
+    eval_cache.misses++;
+    int error = luaL_loadbuffer(L, body, len, "ipc");
+    if (error || chunk || len > EVAL_CACHE_MAX_SOURCE)
+        return error;
+
+    if (eval_cache.count >= EVAL_CACHE_MAX) {
+        struct eval_chunk *oldest =
+            wl_container_of(eval_cache.lru.prev, oldest, link);
+        eval_chunk_destroy(L, oldest);
+    }
+
+    chunk         = calloc(1, sizeof(*chunk));
+    chunk->source = malloc(len);
+    chunk->len    = len;
+    memcpy(chunk->source, body, len);
+
+    lua_pushvalue(L, -1);
+    chunk->ref = luaL_ref(L, LUA_REGISTRYINDEX);
+
+    cwc_hhmap_ninsert(eval_cache.map, chunk->source, len, chunk);
+    wl_list_insert(&eval_cache.lru, &chunk->link);
+    eval_cache.count++;
+
+    return 0;
+}
+
+void ipc_eval_cache_stats(uint64_t *hits, uint64_t *misses, int *count)
+{
+    *hits   = eval_cache.hits;
+    *misses = eval_cache.misses;
+    *count  = eval_cache.count;
+}
+
+static bool handle_eval_msg(struct ipc_client *c, const char *body, size_t len)
+{
     lua_State *L        = g_config_get_lua_State();
     size_t returned_len = 0;
+    const char *result  = "";
     int stack_size      = lua_gettop(L);
-    int error           = luaL_dostring(L, body);
+
+    int error =
+        eval_chunk_push(L, body, len) || lua_pcall(L, 0, LUA_MULTRET, 0);
     if (error) {
         cwc_log(CWC_ERROR, "%s", lua_tostring(L, -1));
-        const char *dostring_res = lua_tolstring(L, -1, &returned_len);
-        returned_len =
-            ipc_create_message_n(msg_buffer, BUFFER_SIZE, IPC_EVAL_RESPONSE,
-                                 dostring_res, returned_len);
+        result = lua_tolstring(L, -1, &returned_len);
     } else if (stack_size != lua_gettop(L)) {
         lua_getglobal(L, "tostring");
         lua_pushvalue(L, -2);
         if (lua_pcall(L, 1, 1, 0) != LUA_OK) {
             cwc_log(CWC_ERROR, "%s", lua_tostring(L, -1));
-            goto send_response;
+            returned_len = 0;
+        } else {
+            result = lua_tolstring(L, -1, &returned_len);
         }
+    }
+
+    // the result string is owned by the stack so queue it before popping
+    if (!result)
+        result = "", returned_len = 0;
+    ipc_client_queue(c, IPC_EVAL_RESPONSE, result, returned_len, NULL, 0);
+    lua_settop(L, stack_size);
+
+    return ipc_client_flush(c);
+}
 
-        const char *dostring_res = lua_tolstring(L, -1, &returned_len);
-        returned_len =
-            ipc_create_message_n(msg_buffer, BUFFER_SIZE, IPC_EVAL_RESPONSE,
-                                 dostring_res, returned_len);
-    } else {
-        returned_len = ipc_create_message_n(msg_buffer, BUFFER_SIZE,
-                                            IPC_EVAL_RESPONSE, "", 0);
+static bool ipc_client_is_subscribed(struct ipc_client *c,
+                                     cwc_signal_handle_t handle)
+{
+    cwc_signal_handle_t *h;
+    wl_array_for_each(h, &c->subscriptions)
+    {
+        if (*h == handle)
+            return true;
     }
 
-send_response:
-    send(fd, msg_buffer, returned_len, 0);
+    return false;
 }
 
-static int ipc_handle_client_msg(int fd, uint32_t mask, void *data)
+static void ipc_client_subscribe(struct ipc_client *c,
+                                 cwc_signal_handle_t handle)
 {
-    struct ipc_client *c = data;
-    if (mask & WL_EVENT_ERROR || mask & WL_EVENT_HANGUP) {
-        ipc_client_close(c);
-        return 0;
+    if (ipc_client_is_subscribed(c, handle))
+        return;
+
+    cwc_signal_handle_t *slot = wl_array_add(&c->subscriptions, sizeof(*slot));
+    if (!slot)
+        return;
+
+    *slot = handle;
+    handle->ipc_subscribers++;
+}
+
+static void ipc_client_unsubscribe(struct ipc_client *c,
+                                   cwc_signal_handle_t handle)
+{
+    cwc_signal_handle_t *subs = c->subscriptions.data;
+    size_t len                = c->subscriptions.size / sizeof(*subs);
+
+    for (size_t i = 0; i < len; i++) {
+        if (subs[i] != handle)
+            continue;
+
+        subs[i] = subs[len - 1];
+        c->subscriptions.size -= sizeof(*subs);
+        handle->ipc_subscribers--;
+        return;
     }
+}
 
-    char *msg_buffer     = malloc(BUFFER_SIZE + 1);
-    int read_len         = read(fd, msg_buffer, BUFFER_SIZE);
-    msg_buffer[read_len] = 0;
+/* signal entry created by the ipc subscription across all the clients */
+static uint32_t interned_count;
 
-    enum cwc_ipc_opcode opcode;
-    const char *body = ipc_get_body(msg_buffer, &opcode);
-    if (!body) {
-        cwc_log(CWC_ERROR, "ipc message error: %s", msg_buffer);
-        goto free_and_exit;
+static void handle_subscribe_msg(struct ipc_client *c,
+                                 const char *body,
+                                 size_t len,
+                                 bool subscribe)
+{
+    char *names = strndup(body, len);
+    char *saveptr;
+
+    for (char *name = strtok_r(names, " \t\n", &saveptr); name;
+         name       = strtok_r(NULL, " \t\n", &saveptr)) {
+        cwc_signal_handle_t handle = cwc_signal_lookup(name);
+
+        if (!subscribe) {
+            if (handle)
+                ipc_client_unsubscribe(c, handle);
+            continue;
+        }
+
+        if (handle && ipc_client_is_subscribed(c, handle))
+            continue;
+
+        if (c->subscriptions.size / sizeof(handle) >= SUBSCRIPTION_MAX) {
+            cwc_log(CWC_ERROR, "ipc client fd %d reached subscription limit",
+                    c->fd);
+            break;
+        }
+
+        if (!handle) {
+            if (strlen(name) > SUBSCRIPTION_NAME_MAX
+                || interned_count >= SUBSCRIPTION_INTERN_MAX) {
+                cwc_log(CWC_ERROR,
+                        "ipc client fd %d subscription rejected: %.*s", c->fd,
+                        SUBSCRIPTION_NAME_MAX, name);
+                continue;
+            }
+
+            handle = cwc_signal_intern(name);
+            interned_count++;
+        }
+
+        ipc_client_subscribe(c, handle);
     }
 
+    free(names);
+}
+
+/* return false if the client is closed */
+static bool ipc_handle_message(struct ipc_client *c, const char *msg)
+{
+    enum cwc_ipc_opcode opcode;
+    const char *body = ipc_get_body(msg, &opcode);
+    size_t len       = ipc_get_body_length(msg);
+
     switch (opcode) {
     case IPC_EVAL:
-        handle_eval_msg(fd, msg_buffer);
+        return handle_eval_msg(c, body, len);
+    case IPC_SUBSCRIBE:
+        handle_subscribe_msg(c, body, len, true);
+        break;
+    case IPC_UNSUBSCRIBE:
+        handle_subscribe_msg(c, body, len, false);
         break;
     default:
         break;
     }
 
-free_and_exit:
-    free(msg_buffer);
-    return 0;
+    return true;
+}
+
+/* handle all the complete message in the input buffer, return false if the
+ * client is closed.
+ */
+static bool ipc_client_process_input(struct ipc_client *c)
+{
+    size_t consumed = 0;
+    int size;
+    while ((size = ipc_message_size((char *)c->in.data + consumed,
+                                    c->in.size - consumed))
+           > 0) {
+        if (!ipc_handle_message(c, (char *)c->in.data + consumed))
+            return false;
+
+        consumed += size;
+    }
+
+    if (size < 0) {
+        cwc_log(CWC_ERROR, "invalid ipc message from fd %d", c->fd);
+        ipc_client_close(c);
+        return false;
+    }
+
+    if (consumed) {
+        memmove(c->in.data, (char *)c->in.data + consumed,
+                c->in.size - consumed);
+        c->in.size -= consumed;
+    }
+
+    return true;
+}
+
+static int ipc_handle_client_event(int fd, uint32_t mask, void *data)
+{
+    struct ipc_client *c = data;
+    if (mask & WL_EVENT_ERROR) {
+        ipc_client_close(c);
+        return 0;
+    }
+
+    if (mask & WL_EVENT_WRITABLE && !ipc_client_flush(c))
+        return 0;
+
+    if (!(mask & (WL_EVENT_READABLE | WL_EVENT_HANGUP)))
+        return 0;
+
+    // read until the socket is drained, the message is handled per chunk so
+    // the input buffer only need to hold one message
+    while (true) {
+        char *dest = wl_array_add(&c->in, READ_CHUNK_SIZE);
+        if (!dest) {
+            ipc_client_close(c);
+            return 0;
+        }
+
+        ssize_t read_len = read(fd, dest, READ_CHUNK_SIZE);
+        c->in.size -= READ_CHUNK_SIZE - MAX(read_len, 0);
+
+        if (read_len < 0 && errno == EINTR)
+            continue;
+
+        if (read_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+
+        if (read_len <= 0) {
+            // eof, try to deliver what's left before closing
+            if (ipc_client_flush(c))
+                ipc_client_close(c);
+            return 0;
+        }
+
+        if (!ipc_client_process_input(c))
+            return 0;
+    }
+}
+
+void ipc_broadcast_signal(struct cwc_signal_entry *entry,
+                          lua_State *L,
+                          int nargs)
+{
+    size_t len       = 0;
+    const char *body = NULL;
+    int top          = 0;
+
+    // body: name\narg1\targ2...
+    if (L) {
+        top = lua_gettop(L);
+        lua_pushstring(L, entry->name);
+        lua_pushliteral(L, "\n");
+        int parts = 2;
+
+        for (int i = 0; i < nargs; i++) {
+            lua_getglobal(L, "tostring");
+            lua_pushvalue(L, top - nargs + 1 + i);
+            if (lua_pcall(L, 1, 1, 0) != LUA_OK || !lua_isstring(L, -1)) {
+                lua_pop(L, 1);
+                continue;
+            }
+
+            if (parts > 2) {
+                lua_pushliteral(L, "\t");
+                lua_insert(L, -2);
+                parts++;
+            }
+            parts++;
+        }
+
+        lua_concat(L, parts);
+        body = lua_tolstring(L, -1, &len);
+    }
+
+    struct ipc_client *c;
+    wl_list_for_each(c, &client_list, link)
+    {
+        if (!ipc_client_is_subscribed(c, entry))
+            continue;
+
+        if (ipc_client_pending_output(c) > SIGNAL_BACKLOG_LIMIT) {
+            c->dropped_signals++;
+            continue;
+        }
+
+        // tell the client that it missed some signal
+        if (c->dropped_signals) {
+            char notice[64];
+            int n = snprintf(notice, sizeof(notice), "ipc::dropped\n%lu",
+                             (unsigned long)c->dropped_signals);
+            ipc_client_queue(c, IPC_SIGNAL, notice, n, NULL, 0);
+            c->dropped_signals = 0;
+        }
+
+        if (body)
+            ipc_client_queue(c, IPC_SIGNAL, body, len, NULL, 0);
+        else
+            ipc_client_queue(c, IPC_SIGNAL, entry->name, strlen(entry->name),
+                             "\n", 1);
+
+        // sent from the event loop, the emitter may be in the middle of
+        // handling this client message
+        ipc_client_set_writable(c, true);
+    }
+
+    if (L)
+        lua_settop(L, top);
 }
 
 static int ipc_handle_new_conn(int fd, uint32_t mask, void *data)
 {
     struct cwc_server *s = data;
-    int client_fd        = accept(fd, NULL, NULL);
+    int client_fd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
     if (client_fd < 0)
         return 0;
@@ -140,9 +582,12 @@ static int ipc_handle_new_conn(int fd, uint32_t mask, void *data)
     cwc_log(CWC_DEBUG, "new ipc connection with fd: %d", client_fd);
 
     c->fd = client_fd;
+    wl_array_init(&c->in);
+    wl_array_init(&c->out);
+    wl_array_init(&c->subscriptions);
     c->event_source =
         wl_event_loop_add_fd(s->wl_event_loop, client_fd, WL_EVENT_READABLE,
-                             ipc_handle_client_msg, c);
+                             ipc_handle_client_event, c);
 
     wl_list_insert(&client_list, &c->link);
 
@@ -157,6 +602,9 @@ void setup_ipc(struct cwc_server *s)
                               getenv("XDG_RUNTIME_DIR"), getuid(), getpid());
 
     wl_list_init(&client_list);
+    wl_list_init(&eval_cache.lru);
+    eval_cache.map = cwc_hhmap_create(EVAL_CACHE_MAX);
+    cwc_signal_connect("lua::reload", eval_cache_clear);
 
     if (result_len >= path_len) {
         cwc_log(CWC_ERROR, "socket path to long");
@@ -203,12 +651,16 @@ void setup_ipc(struct cwc_server *s)
 
 void cleanup_ipc(struct cwc_server *s)
 {
-    struct ipc_client *c;
-    wl_list_for_each(c, &client_list, link)
+    struct ipc_client *c, *tmp;
+    wl_list_for_each_safe(c, tmp, &client_list, link)
     {
         ipc_client_close(c);
     }
 
+    eval_cache_clear(NULL);
+    cwc_hhmap_destroy(eval_cache.map);
+    cwc_signal_disconnect("lua::reload", eval_cache_clear);
+
     if (!s->socket_fd)
         return;
 
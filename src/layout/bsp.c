@@ -28,6 +28,9 @@
 #include "cwc/util.h"
 #include "wlr/util/edges.h"
 
+/* configure sent by the running relayout */
+static uint32_t configure_count = 0;
+
 static inline struct bsp_node *
 bsp_node_get_sibling(struct bsp_node *parent_node, struct bsp_node *me)
 {
@@ -95,23 +98,60 @@ static inline void bsp_node_set_size(struct bsp_node *node, int w, int h)
     node->height = h;
 }
 
-static inline void bsp_node_leaf_configure(
-    struct bsp_node *node, int x, int y, int width, int height)
+void bsp_node_mark_dirty(struct bsp_node *node)
+{
+    while (node && !node->dirty) {
+        node->dirty = true;
+        node        = node->parent;
+    }
+
+    // ancestor of a dirty node is already dirty
+}
+
+/* configure the container to the node box */
+static inline void bsp_node_leaf_configure(struct bsp_node *node)
 {
     struct cwc_container *container = node->container;
 
+    node->dirty            = false;
+    node->configured_width = 0;
+
     if (!cwc_container_is_configure_allowed(container))
         return;
 
     if (!cwc_container_is_floating(container)
         && cwc_output_get_current_tag_info(container->output)->layout_mode
                == CWC_LAYOUT_BSP) {
-        struct wlr_box box = {x, y, width, height};
+        struct wlr_box box = {node->x, node->y, node->width, node->height};
         cwc_container_set_box_gap(container, &box);
+
+        node->configured_width  = container->width;
+        node->configured_height = container->height;
+        node->configured_bw     = cwc_border_get_thickness(&container->border);
+        configure_count++;
     }
+}
 
-    bsp_node_set_position(node, x, y);
-    bsp_node_set_size(node, width, height);
+/* check if the container still has the geometry from the last configure since
+ * it can be moved or resized outside of the layout (e.g. floating, fullscreen,
+ * gaps changed).
+ */
+static bool bsp_node_leaf_is_configured(struct bsp_node *node)
+{
+    struct cwc_container *container = node->container;
+    if (!node->configured_width)
+        return false;
+
+    int gaps = cwc_output_get_current_tag_info(container->output)->useless_gaps;
+    struct wlr_box *layout_box = &container->output->output_layout_box;
+    struct wlr_box current     = cwc_container_get_box(container);
+
+    return current.x == layout_box->x + node->x + gaps
+           && current.y == layout_box->y + node->y + gaps
+           && current.width == node->configured_width
+           && current.height == node->configured_height
+           && cwc_border_get_thickness(&container->border)
+                  == node->configured_bw;
 }
 
 static struct bsp_node *_bsp_node_leaf_get(struct bsp_node *node, bool to_left)
@@ -134,73 +174,91 @@ static inline struct bsp_node *find_closes_leaf_sibling(struct bsp_node *me)
     return _bsp_node_leaf_get(parent->right, true);
 }
 
-static void bsp_update_node(struct bsp_node *parent)
+static void bsp_update_node(struct bsp_node *parent, bool force);
+
+/* apply the box computed by the parent and only go deeper when the box changed
+ * or something in the subtree is marked dirty, unless forced.
+ */
+static void
+bsp_update_child(struct bsp_node *node, struct wlr_box *box, bool force)
+{
+    bool changed = node->x != box->x || node->y != box->y
+                   || node->width != box->width || node->height != box->height;
+
+    bsp_node_set_position(node, box->x, box->y);
+    bsp_node_set_size(node, box->width, box->height);
+
+    if (!node->enabled || !(changed || force || node->dirty))
+        return;
+
+    if (node->type == BSP_NODE_INTERNAL)
+        bsp_update_node(node, force);
+    else if (changed || !bsp_node_leaf_is_configured(node))
+        bsp_node_leaf_configure(node);
+    else
+        node->dirty = false;
+}
+
+static void bsp_update_node(struct bsp_node *parent, bool force)
 {
     struct bsp_node *left  = parent->left;
     struct bsp_node *right = parent->right;
 
-    left->x = parent->x;
-    left->y = parent->y;
+    struct wlr_box parent_box = {
+        .x      = parent->x,
+        .y      = parent->y,
+        .width  = parent->width,
+        .height = parent->height,
+    };
+    struct wlr_box left_box  = parent_box;
+    struct wlr_box right_box = parent_box;
 
     // calculate width and height for left and right according to left width
     // factor
     switch (parent->split_type) {
     case BSP_SPLIT_HORIZONTAL:
-        left->width  = parent->width * parent->left_wfact;
-        left->height = parent->height;
-
-        right->width  = parent->width - left->width;
-        right->height = parent->height;
-        right->x      = left->x + left->width;
-        right->y      = left->y;
+        left_box.width  = parent->width * parent->left_wfact;
+        right_box.width = parent->width - left_box.width;
+        right_box.x     = left_box.x + left_box.width;
         break;
     case BSP_SPLIT_VERTICAL:
-        left->width  = parent->width;
-        left->height = parent->height * parent->left_wfact;
-
-        right->width  = parent->width;
-        right->height = parent->height - left->height;
-        right->x      = left->x;
-        right->y      = left->y + left->height;
+        left_box.height  = parent->height * parent->left_wfact;
+        right_box.height = parent->height - left_box.height;
+        right_box.y      = left_box.y + left_box.height;
         break;
     case BSP_SPLIT_AUTO:
         unreachable_();
         break;
     }
 
-    if (!right->enabled) {
-        left->width  = parent->width;
-        left->height = parent->height;
-    }
+    if (!right->enabled)
+        left_box = parent_box;
 
-    if (left->enabled) {
-        // update position/size for left
-        if (left->type == BSP_NODE_LEAF) {
-            bsp_node_leaf_configure(left, parent->x, parent->y, left->width,
-                                    left->height);
-        } else {
-            bsp_node_set_position(left, parent->x, parent->y);
-            bsp_update_node(left);
-        }
-    } else {
-        right->x      = parent->x;
-        right->y      = parent->y;
-        right->width  = parent->width;
-        right->height = parent->height;
-    }
+    if (!left->enabled)
+        right_box = parent_box;
 
-    if (right->enabled) {
-        // update position/size for right
-        if (right->type == BSP_NODE_LEAF) {
-            bsp_node_leaf_configure(right, right->x, right->y, right->width,
-                                    right->height);
-        } else {
-            bsp_update_node(right);
-        }
-    }
+    bsp_update_child(left, &left_box, force);
+    bsp_update_child(right, &right_box, force);
+
+    parent->dirty = false;
 }
 
-void bsp_update_root(struct cwc_output *output, int workspace)
+/* recompute the children of the node and record the configure count */
+static void bsp_relayout(struct bsp_node *node, bool force)
+{
+    configure_count = 0;
+    bsp_update_node(node, force);
+
+    struct cwc_container *container =
+        _bsp_node_leaf_get(node, true)->container;
+    struct bsp_root_entry *entry =
+        bsp_entry_get(container->output, container->workspace);
+    if (entry)
+        entry->configure_count = configure_count;
+}
+
+static void
+_bsp_update_root(struct cwc_output *output, int workspace, bool force)
 {
     struct bsp_root_entry *entry = bsp_entry_get(output, workspace);
     enum cwc_layout_mode current_layout =
@@ -210,23 +268,39 @@ void bsp_update_root(struct cwc_output *output, int workspace)
 
     struct bsp_node *root      = entry->root;
     struct wlr_box usable_area = output->usable_area;
+    struct wlr_box root_box    = {root->x, root->y, root->width, root->height};
+
+    if (!force && !root->dirty && wlr_box_equal(&usable_area, &root_box))
+        return;
 
     if (root->type == BSP_NODE_LEAF) {
-        bsp_node_leaf_configure(root, usable_area.x, usable_area.y,
-                                usable_area.width, usable_area.height);
+        configure_count = 0;
+        bsp_update_child(root, &usable_area, force);
+        entry->configure_count = configure_count;
         return;
     }
 
     bsp_node_set_size(root, usable_area.width, usable_area.height);
     bsp_node_set_position(root, usable_area.x, usable_area.y);
 
-    bsp_update_node(root);
+    bsp_relayout(root, force);
+}
+
+void bsp_update_root(struct cwc_output *output, int workspace)
+{
+    _bsp_update_root(output, workspace, true);
+}
+
+void bsp_update_dirty(struct cwc_output *output, int workspace)
+{
+    _bsp_update_root(output, workspace, false);
 }
 
 /* enable all the node until root */
 static struct bsp_node *_bsp_node_enable(struct bsp_node *node)
 {
     node->enabled = true;
+    node->dirty   = true;
 
     if (!node->parent)
         return node;
@@ -239,7 +313,7 @@ void bsp_node_enable(struct bsp_node *node)
     struct bsp_node *root = _bsp_node_enable(node);
 
     if (root->type == BSP_NODE_INTERNAL)
-        bsp_update_node(root);
+        bsp_relayout(root, false);
     else
         transaction_schedule_tag(cwc_output_get_tag(
             root->container->output, root->container->workspace));
@@ -266,7 +340,7 @@ void bsp_node_disable(struct bsp_node *node)
     struct bsp_node *last_updated = _bsp_node_disable(node);
 
     if (last_updated->type == BSP_NODE_INTERNAL && last_updated->parent)
-        bsp_update_node(last_updated->parent);
+        bsp_relayout(last_updated->parent, false);
     else if (last_updated->type == BSP_NODE_LEAF)
         transaction_schedule_tag(
             cwc_output_get_tag(last_updated->container->output,
@@ -296,6 +370,7 @@ static struct bsp_node *bsp_node_internal_create(struct bsp_node *parent,
     struct bsp_node *node_data = calloc(1, sizeof(*node_data));
     node_data->type            = BSP_NODE_INTERNAL;
     node_data->enabled         = true;
+    node_data->dirty           = true;
     node_data->split_type      = split;
 
     bsp_node_reparent(parent, node_data, pos);
@@ -317,6 +392,7 @@ static struct bsp_node *bsp_node_leaf_create(struct bsp_node *parent,
     node_data->type            = BSP_NODE_LEAF;
     node_data->container       = container;
     node_data->enabled         = true;
+    node_data->dirty           = true;
     node_data->parent          = parent;
 
     bsp_node_reparent(parent, node_data, pos);
@@ -476,7 +552,7 @@ destroy_node:
 
     if (update) {
         if (grandparent_node)
-            bsp_update_node(grandparent_node);
+            bsp_relayout(grandparent_node, false);
         else
             transaction_schedule_tag(
                 cwc_output_get_tag(container->output, container->workspace));
@@ -499,7 +575,7 @@ void bsp_toggle_split(struct bsp_node *node)
     else
         node->split_type = BSP_SPLIT_HORIZONTAL;
 
-    bsp_update_node(node);
+    bsp_relayout(node, false);
 }
 
 struct bsp_root_entry *
@@ -529,8 +605,9 @@ void bsp_entry_fini(struct cwc_output *output, int workspace)
     if (entry->root)
         bsp_node_destroy(entry->root);
 
-    entry->root         = NULL;
-    entry->last_focused = NULL;
+    entry->root            = NULL;
+    entry->last_focused    = NULL;
+    entry->configure_count = 0;
 }
 
 enum Position
@@ -28,6 +28,7 @@
 #include <wlr/util/edges.h>
 
 #include "cwc/config.h"
+#include "cwc/desktop/hit_index.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/toplevel.h"
 #include "cwc/desktop/transaction.h"
@@ -45,11 +46,41 @@
 #include "cwc/util.h"
 #include "wlr/util/box.h"
 
+/* the middle part of the tile that will be stretched */
+#define BORDER_TILE_MIDDLE_SIZE 64
+
+/* unused tile kept around so that flipping between focus and normal color
+ * doesn't rasterize the pattern again
+ */
+#define BORDER_TILE_UNUSED_MAX 32
+
+struct border_tile_key {
+    cairo_pattern_t *pattern;
+    int rotation;
+    int thickness;
+};
+
+struct border_tile {
+    struct wlr_buffer base;
+    cairo_surface_t *surface;
+    struct border_tile_key key;
+    int size; // width and height of the tile
+
+    int users;
+    struct wl_list link; // unused_tiles
+};
+
+static struct cwc_hhmap *tile_cache; // struct border_tile
+static struct wl_list unused_tiles;  // border_tile.link
+static int unused_tiles_count;
+
 static void cairo_buffer_destroy(struct wlr_buffer *wlr_buffer)
 {
-    struct border_buffer *border = wl_container_of(wlr_buffer, border, base);
-    wlr_buffer_finish(&border->base);
-    cairo_surface_destroy(border->surface);
+    struct border_tile *tile = wl_container_of(wlr_buffer, tile, base);
+    wlr_buffer_finish(&tile->base);
+    cairo_surface_destroy(tile->surface);
+    cairo_pattern_destroy(tile->key.pattern);
+    free(tile);
 }
 
 static bool cairo_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
@@ -58,14 +89,14 @@ static bool cairo_buffer_begin_data_ptr_access(struct wlr_buffer *wlr_buffer,
                                                uint32_t *format,
                                                size_t *stride)
 {
-    struct border_buffer *buffer = wl_container_of(wlr_buffer, buffer, base);
+    struct border_tile *tile = wl_container_of(wlr_buffer, tile, base);
 
     if (flags & WLR_BUFFER_DATA_PTR_ACCESS_WRITE)
         return false;
 
     *format = DRM_FORMAT_ARGB8888;
-    *data   = cairo_image_surface_get_data(buffer->surface);
-    *stride = cairo_image_surface_get_stride(buffer->surface);
+    *data   = cairo_image_surface_get_data(tile->surface);
+    *stride = cairo_image_surface_get_stride(tile->surface);
     return true;
 }
 
@@ -196,33 +227,25 @@ static cairo_pattern_t *process_pattern(cairo_pattern_t *reference_pattern,
     return pattern;
 }
 
+/* draw the whole border ring with rounded outer corner */
 static inline void _draw_border(cairo_surface_t *cr_surf,
                                 cairo_pattern_t *pattern,
-                                int bw,
-                                int bh,
-                                enum wlr_direction dir)
+                                int size,
+                                int bw)
 {
     cairo_t *cr   = cairo_create(cr_surf);
-    double radius = MIN(bw, bh);
+    double radius = bw;
 
-    // border radius
-    switch (dir) {
-    case WLR_DIRECTION_UP:
-        cairo_new_sub_path(cr);
-        cairo_arc(cr, bh, bh, radius, M_PI, M_PI + M_PI / 2);
-        cairo_arc(cr, bw - bh, bh, radius, -M_PI / 2, 0);
-        cairo_close_path(cr);
-        break;
-    case WLR_DIRECTION_DOWN:
-        cairo_new_sub_path(cr);
-        cairo_arc(cr, bh, 0, radius, M_PI / 2, M_PI);
-        cairo_arc(cr, bw - bh, 0, radius, 0, M_PI / 2);
-        cairo_close_path(cr);
-        break;
-    default:
-        cairo_rectangle(cr, 0, 0, bw, bh);
-        break;
-    }
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD);
+
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, bw, bw, radius, M_PI, M_PI + M_PI / 2);
+    cairo_arc(cr, size - bw, bw, radius, -M_PI / 2, 0);
+    cairo_arc(cr, size - bw, size - bw, radius, 0, M_PI / 2);
+    cairo_arc(cr, bw, size - bw, radius, M_PI / 2, M_PI);
+    cairo_close_path(cr);
+
+    cairo_rectangle(cr, bw, bw, size - bw * 2, size - bw * 2);
 
     cairo_set_source(cr, pattern);
     cairo_fill(cr);
@@ -230,79 +253,215 @@ static inline void _draw_border(cairo_surface_t *cr_surf,
     cairo_destroy(cr);
 }
 
-static void draw_border(struct border_buffer **border,
-                        cairo_pattern_t *pattern,
-                        int rotation,
-                        int bw,
-                        int bh,
-                        int full_w,
-                        int full_h,
-                        enum wlr_direction dir)
+/* The pattern is drawn in a square then scaled to the border rectangle, so a
+ * small square tile can be rasterized once and sliced/stretched to any size.
+ */
+static struct border_tile *
+border_tile_create(cairo_pattern_t *pattern, int rotation, int thickness)
 {
-    struct border_buffer *bb = *border = calloc(1, sizeof(**border));
+    struct border_tile *tile = calloc(1, sizeof(*tile));
+    int size                 = thickness * 2 + BORDER_TILE_MIDDLE_SIZE;
 
-    wlr_buffer_init(&bb->base, &cairo_border_impl, bw, bh);
-    bb->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, bw, bh);
+    tile->key.pattern   = cairo_pattern_reference(pattern);
+    tile->key.rotation  = rotation;
+    tile->key.thickness = thickness;
+    tile->size          = size;
 
-    if (cairo_surface_status(bb->surface) != CAIRO_STATUS_SUCCESS)
-        return;
+    wlr_buffer_init(&tile->base, &cairo_border_impl, size, size);
+    tile->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
 
-    cairo_pattern_t *processed_pattern =
-        process_pattern(pattern, rotation, bw, bh, full_w, full_h, dir);
-    _draw_border(bb->surface, processed_pattern, bw, bh, dir);
+    if (cairo_surface_status(tile->surface) != CAIRO_STATUS_SUCCESS)
+        return tile;
+
+    cairo_pattern_t *processed_pattern = process_pattern(
+        pattern, rotation, size, thickness, size, size, WLR_DIRECTION_UP);
+    _draw_border(tile->surface, processed_pattern, size, thickness);
     cairo_pattern_destroy(processed_pattern);
+
+    return tile;
 }
 
-static void border_buffer_init(struct cwc_border *border,
-                               cairo_pattern_t *pattern,
-                               int w,
-                               int h,
-                               int thickness)
+static struct border_tile *
+border_tile_get(cairo_pattern_t *pattern, int rotation, int thickness)
 {
-    // clockwise top to left
-    draw_border(&border->buffer[0], pattern, border->pattern_rotation, w,
-                thickness, w, h, WLR_DIRECTION_UP);
-    draw_border(&border->buffer[1], pattern, border->pattern_rotation,
-                thickness, h - thickness * 2, w, h, WLR_DIRECTION_RIGHT);
-    draw_border(&border->buffer[2], pattern, border->pattern_rotation, w,
-                thickness, w, h, WLR_DIRECTION_DOWN);
-    draw_border(&border->buffer[3], pattern, border->pattern_rotation,
-                thickness, h - thickness * 2, w, h, WLR_DIRECTION_LEFT);
+    if (!tile_cache) {
+        tile_cache = cwc_hhmap_create_keyed(16);
+        wl_list_init(&unused_tiles);
+    }
+
+    struct border_tile_key key = {
+        .pattern   = pattern,
+        .rotation  = rotation,
+        .thickness = thickness,
+    };
+
+    struct border_tile *tile = cwc_hhmap_nget(tile_cache, &key, sizeof(key));
+    if (tile) {
+        if (tile->users++ == 0) {
+            wl_list_remove(&tile->link);
+            unused_tiles_count--;
+        }
+
+        return tile;
+    }
+
+    tile        = border_tile_create(pattern, rotation, thickness);
+    tile->users = 1;
+    cwc_hhmap_ninsert(tile_cache, &tile->key, sizeof(tile->key), tile);
+
+    return tile;
+}
+
+static void border_tile_release(struct border_tile *tile)
+{
+    if (--tile->users)
+        return;
+
+    wl_list_insert(&unused_tiles, &tile->link);
+    if (++unused_tiles_count <= BORDER_TILE_UNUSED_MAX)
+        return;
+
+    // evict the least recently used
+    struct border_tile *oldest =
+        wl_container_of(unused_tiles.prev, oldest, link);
+    wl_list_remove(&oldest->link);
+    unused_tiles_count--;
+
+    cwc_hhmap_nremove(tile_cache, &oldest->key, sizeof(oldest->key));
+    wlr_buffer_drop(&oldest->base);
+}
+
+static void border_update_color(struct cwc_border *border)
+{
+    double r, g, b, a;
+    border->solid = border->pattern
+                    && cairo_pattern_get_rgba(border->pattern, &r, &g, &b, &a)
+                           == CAIRO_STATUS_SUCCESS;
+
+    if (!border->solid)
+        return;
+
+    border->color[0] = r * a;
+    border->color[1] = g * a;
+    border->color[2] = b * a;
+    border->color[3] = a;
 }
 
 static bool is_border_valid(struct cwc_border *border)
 {
-    for (int i = 0; i < 4; ++i) {
-        if (border->buffer[i] == NULL)
-            return false;
-    }
+    return border->tile != NULL;
+}
 
-    return true;
+/* update position and size of the border parts, no allocation happen here */
+static void border_update_geometry(struct cwc_border *border)
+{
+    if (!border->tree)
+        return;
+
+    int bw   = border->thickness;
+    int w    = border->width;
+    int h    = border->height;
+    int mid  = border->tile->size - bw * 2;
+    int midw = MAX(w - bw * 2, 1);
+    int midh = MAX(h - bw * 2, 1);
+
+    // clockwise from top left
+    struct wlr_box corner_src[4] = {
+        {0,        0,        bw, bw},
+        {bw + mid, 0,        bw, bw},
+        {bw + mid, bw + mid, bw, bw},
+        {0,        bw + mid, bw, bw},
+    };
+    struct wlr_box corner_dst[4] = {
+        {0,      0,      bw, bw},
+        {w - bw, 0,      bw, bw},
+        {w - bw, h - bw, bw, bw},
+        {0,      h - bw, bw, bw},
+    };
+
+    // clockwise from top
+    struct wlr_box edge_src[4] = {
+        {bw,       0,        mid, bw },
+        {bw + mid, bw,       bw,  mid},
+        {bw,       bw + mid, mid, bw },
+        {0,        bw,       bw,  mid},
+    };
+    struct wlr_box edge_dst[4] = {
+        {bw,     0,      midw, bw  },
+        {w - bw, bw,     bw,   midh},
+        {bw,     h - bw, midw, bw  },
+        {0,      bw,     bw,   midh},
+    };
+
+    for (int i = 0; i < 4; i++) {
+        struct wlr_fbox src = {
+            .x      = corner_src[i].x,
+            .y      = corner_src[i].y,
+            .width  = corner_src[i].width,
+            .height = corner_src[i].height,
+        };
+        wlr_scene_buffer_set_source_box(border->corner[i], &src);
+        wlr_scene_buffer_set_dest_size(border->corner[i], corner_dst[i].width,
+                                       corner_dst[i].height);
+        wlr_scene_node_set_position(&border->corner[i]->node, corner_dst[i].x,
+                                    corner_dst[i].y);
+
+        wlr_scene_node_set_position(border->edge[i], edge_dst[i].x,
+                                    edge_dst[i].y);
+
+        if (border->solid) {
+            wlr_scene_rect_set_size(wlr_scene_rect_from_node(border->edge[i]),
+                                    edge_dst[i].width, edge_dst[i].height);
+            continue;
+        }
+
+        struct wlr_scene_buffer *edge =
+            wlr_scene_buffer_from_node(border->edge[i]);
+        src = (struct wlr_fbox){
+            .x      = edge_src[i].x,
+            .y      = edge_src[i].y,
+            .width  = edge_src[i].width,
+            .height = edge_src[i].height,
+        };
+        wlr_scene_buffer_set_source_box(edge, &src);
+        wlr_scene_buffer_set_dest_size(edge, edge_dst[i].width,
+                                       edge_dst[i].height);
+    }
 }
 
-static void border_buffer_fini(struct cwc_border *border)
+static void border_scene_fini(struct cwc_border *border)
 {
-    if (!is_border_valid(border))
+    if (!border->tree)
         return;
 
+    wlr_scene_node_destroy(&border->tree->node);
+    border->tree = NULL;
     for (int i = 0; i < 4; i++) {
-        wlr_scene_node_destroy(&border->buffer[i]->scene->node);
-        wlr_buffer_drop(&border->buffer[i]->base);
-        free(border->buffer[i]);
-        border->buffer[i] = NULL;
+        border->corner[i] = NULL;
+        border->edge[i]   = NULL;
     }
 }
 
+/* called when pattern, rotation, or thickness changed */
 static void border_buffer_redraw(struct cwc_border *border)
 {
-    border_buffer_fini(border);
-    border_buffer_init(border, border->pattern, border->width, border->height,
-                       border->thickness);
+    border_scene_fini(border);
+
+    struct border_tile *old = border->tile;
+    border->tile = border_tile_get(border->pattern, border->pattern_rotation,
+                                   border->thickness);
+    border_tile_release(old);
+    border_update_color(border);
 
     if (border->attached_tree)
         cwc_border_attach_to_scene(border, border->attached_tree);
 
     cwc_border_set_enabled(border, border->enabled);
+
+    // the new scene nodes has default opacity
+    struct cwc_container *container =
+        wl_container_of(border, container, border);
+    cwc_container_mark_opacity_dirty(container);
 }
 
 void cwc_border_init(struct cwc_border *border,
@@ -324,7 +483,8 @@ void cwc_border_init(struct cwc_border *border,
     border->enabled          = true;
     border->attached_tree    = NULL;
 
-    border_buffer_init(border, pattern, rect_w, rect_h, thickness);
+    border->tile = border_tile_get(pattern, pattern_rotation, thickness);
+    border_update_color(border);
 }
 
 void cwc_border_destroy(struct cwc_border *border)
@@ -332,7 +492,8 @@ void cwc_border_destroy(struct cwc_border *border)
     if (!is_border_valid(border))
         return;
 
-    border_buffer_fini(border);
+    border_scene_fini(border);
+    border_tile_release(border->tile);
     cairo_pattern_destroy(border->pattern);
 
     *border = (struct cwc_border){0};
@@ -345,19 +506,30 @@ void cwc_border_attach_to_scene(struct cwc_border *border,
         return;
 
     border->attached_tree = scene_tree;
+    if (!border->thickness)
+        return;
+
+    border->tree            = wlr_scene_tree_create(scene_tree);
+    border->tree->node.data = border;
+    wlr_scene_node_lower_to_bottom(&border->tree->node);
+
     for (int i = 0; i < 4; i++) {
-        border->buffer[i]->scene =
-            wlr_scene_buffer_create(scene_tree, &border->buffer[i]->base);
-        wlr_scene_node_lower_to_bottom(&border->buffer[i]->scene->node);
-        border->buffer[i]->scene->node.data = border;
+        border->corner[i] =
+            wlr_scene_buffer_create(border->tree, &border->tile->base);
+        border->corner[i]->node.data = border;
+
+        if (border->solid) {
+            border->edge[i] =
+                &wlr_scene_rect_create(border->tree, 0, 0, border->color)->node;
+        } else {
+            border->edge[i] =
+                &wlr_scene_buffer_create(border->tree, &border->tile->base)
+                     ->node;
+        }
+        border->edge[i]->data = border;
     }
 
-    int bw = border->thickness;
-    wlr_scene_node_set_position(&border->buffer[1]->scene->node,
-                                border->width - bw, bw);
-    wlr_scene_node_set_position(&border->buffer[2]->scene->node, 0,
-                                border->height - bw);
-    wlr_scene_node_set_position(&border->buffer[3]->scene->node, 0, bw);
+    border_update_geometry(border);
 }
 
 static void all_toplevel_reposition_tree(struct cwc_toplevel *toplevel,
@@ -385,8 +557,8 @@ void cwc_border_set_enabled(struct cwc_border *border, bool enabled)
     if (!is_border_valid(border))
         return;
 
-    for (int i = 0; i < 4; i++)
-        wlr_scene_node_set_enabled(&border->buffer[i]->scene->node, enabled);
+    if (border->tree)
+        wlr_scene_node_set_enabled(&border->tree->node, enabled);
     border->enabled = enabled;
 
     struct cwc_container *container =
@@ -460,7 +632,24 @@ void cwc_border_resize(struct cwc_border *border, int rect_w, int rect_h)
 
     border->width  = rect_w;
     border->height = rect_h;
-    border_buffer_redraw(border);
+    border_update_geometry(border);
+}
+
+void cwc_border_set_opacity(struct cwc_border *border, float opacity)
+{
+    if (!is_border_valid(border) || !border->tree || !border->solid)
+        return;
+
+    float color[4] = {
+        border->color[0] * opacity,
+        border->color[1] * opacity,
+        border->color[2] * opacity,
+        border->color[3] * opacity,
+    };
+
+    for (int i = 0; i < 4; i++)
+        wlr_scene_rect_set_color(wlr_scene_rect_from_node(border->edge[i]),
+                                 color);
 }
 
 //===================== CONTAINER ==========================
@@ -477,6 +666,7 @@ static void init_surf_tree(struct cwc_toplevel *toplevel,
         wlr_scene_node_set_position(&container->tree->node,
                                     toplevel->xwsurface->x,
                                     toplevel->xwsurface->y);
+        cwc_hit_index_mark_dirty();
 
         goto assign_common;
     }
@@ -573,9 +763,11 @@ void cwc_container_init(struct cwc_output *output,
     cont->workspace = cont->workspace ? cont->workspace : 1;
 
     wl_list_init(&cont->toplevels);
+    wl_list_init(&cont->link_opacity_dirty);
     wl_list_insert(&server.containers, &cont->link);
 
     wlr_scene_node_raise_to_top(&cont->popup_tree->node);
+    cwc_hit_index_mark_dirty();
 
     cairo_pattern_t *pattern = NULL;
     lua_State *L             = g_config_get_lua_State();
@@ -593,9 +785,11 @@ void cwc_container_init(struct cwc_output *output,
 
     toplevel->container = cont;
     wl_list_insert(&cont->toplevels, &toplevel->link_container);
+    server.list_generation.toplevels++;
 
     init_surf_tree(toplevel, cont);
     cwc_container_reposition_client_tree(cont);
+    cwc_container_mark_opacity_dirty(cont);
 
     if (cwc_toplevel_is_unmanaged(toplevel))
         goto emit_signal;
@@ -604,6 +798,8 @@ void cwc_container_init(struct cwc_output *output,
                    &cont->link_output_container);
     wl_list_insert(&cont->output->state->focus_stack,
                    &cont->link_output_fstack);
+    server.list_generation.containers++;
+    server.list_generation.focus_stack++;
 
     _decide_should_tiled_part1(toplevel, cont);
 
@@ -629,6 +825,9 @@ static void _cwc_container_insert_toplevel(struct cwc_container *c,
 
     toplevel->container = c;
     wl_list_insert(&c->toplevels, &toplevel->link_container);
+    server.list_generation.toplevels++;
+    server.list_generation.focus_stack++;
+    server.list_generation.minimized++;
 
     if (!toplevel->surf_tree)
         init_surf_tree(toplevel, c);
@@ -642,6 +841,7 @@ static void _cwc_container_insert_toplevel(struct cwc_container *c,
     wlr_scene_node_set_position(&toplevel->surf_tree->node, bw, bw);
 
     cwc_container_set_size(c, c->width, c->height);
+    cwc_container_mark_opacity_dirty(c);
 
     if (emit_signal)
         cwc_object_emit_signal_varr("container::insert",
@@ -671,6 +871,8 @@ static void cwc_container_fini(struct cwc_container *container)
     if (!cwc_container_is_unmanaged(container)) {
         wl_list_remove(&container->link_output_container);
         wl_list_remove(&container->link_output_fstack);
+        server.list_generation.containers++;
+        server.list_generation.focus_stack++;
     }
 
     if (container->bsp_node)
@@ -683,16 +885,20 @@ static void cwc_container_fini(struct cwc_container *container)
     }
 
     if (container->link_output_minimized.next
-        && container->link_output_minimized.prev)
+        && container->link_output_minimized.prev) {
         wl_list_remove(&container->link_output_minimized);
+        server.list_generation.minimized++;
+    }
 
     cwc_output_tiling_layout_update_container(container, true);
 
     luaC_object_unregister(L, container);
 
+    wl_list_remove(&container->link_opacity_dirty);
     cwc_border_destroy(&container->border);
     wlr_scene_node_destroy(&container->popup_tree->node);
     wlr_scene_node_destroy(&container->tree->node);
+    cwc_hit_index_mark_dirty();
 
     wl_list_remove(&container->link);
     free(container);
@@ -711,6 +917,9 @@ static void _clear_container_stuff_in_toplevel(struct cwc_toplevel *toplevel)
 
     wl_list_remove(&toplevel->link_container);
     toplevel->container = NULL;
+    server.list_generation.toplevels++;
+    server.list_generation.focus_stack++;
+    server.list_generation.minimized++;
 }
 
 void cwc_container_remove_toplevel(struct cwc_toplevel *toplevel)
@@ -756,6 +965,7 @@ static void all_toplevel_leave_output(struct cwc_toplevel *toplevel, void *data)
     struct cwc_output *output = data;
 
     wl_list_remove(&toplevel->link_output_toplevels);
+    server.list_generation.toplevels++;
 
     if (toplevel->wlr_foreign_handle) {
         wlr_foreign_toplevel_handle_v1_output_leave(
@@ -769,6 +979,7 @@ static void all_toplevel_enter_output(struct cwc_toplevel *toplevel, void *data)
 
     wl_list_insert(output->state->toplevels.prev,
                    &toplevel->link_output_toplevels);
+    server.list_generation.toplevels++;
 
     if (toplevel->wlr_foreign_handle) {
         wlr_foreign_toplevel_handle_v1_output_enter(
@@ -838,6 +1049,10 @@ static void __cwc_container_move_to_output(struct cwc_container *container,
         wl_list_reattach(output->state->minimized.prev,
                          &container->link_output_minimized);
 
+    server.list_generation.containers++;
+    server.list_generation.focus_stack++;
+    server.list_generation.minimized++;
+
     cwc_container_for_each_toplevel(container, all_toplevel_leave_output, old);
     cwc_container_for_each_toplevel(container, all_toplevel_enter_output,
                                     output);
@@ -978,6 +1193,8 @@ void cwc_container_set_front_toplevel(struct cwc_toplevel *toplevel)
     cwc_container_set_size(container, container->width, container->height);
     wlr_scene_node_place_below(&toplevel->surf_tree->node,
                                &container->popup_tree->node);
+    server.list_generation.focus_stack++;
+    server.list_generation.minimized++;
 
     struct cwc_toplevel *t;
     wl_list_for_each(t, &toplevel->container->toplevels, link_container)
@@ -1103,6 +1320,7 @@ static void all_toplevel_set_suspended(struct cwc_toplevel *toplevel,
 void cwc_container_set_enabled(struct cwc_container *container, bool set)
 {
     wlr_scene_node_set_enabled(&container->tree->node, set);
+    cwc_hit_index_mark_dirty();
     if (set) {
         cwc_container_refresh(container);
     } else {
@@ -1305,10 +1523,12 @@ static void all_toplevel_set_minimized(struct cwc_toplevel *toplevel,
 void cwc_container_set_minimized(struct cwc_container *container, bool set)
 {
     wlr_scene_node_set_enabled(&container->tree->node, !set);
+    cwc_hit_index_mark_dirty();
     struct bsp_node *bsp_node = container->bsp_node;
     if (set) {
         struct cwc_output *o = container->output;
         wl_list_insert(&o->state->minimized, &container->link_output_minimized);
+        server.list_generation.minimized++;
 
         if (bsp_node)
             bsp_node_disable(bsp_node);
@@ -1318,8 +1538,10 @@ void cwc_container_set_minimized(struct cwc_container *container, bool set)
     } else {
         container->state &= ~CONTAINER_STATE_MINIMIZED;
 
-        if (container->link_output_minimized.next)
+        if (container->link_output_minimized.next) {
             wl_list_remove(&container->link_output_minimized);
+            server.list_generation.minimized++;
+        }
 
         if (bsp_node)
             bsp_node_enable(bsp_node);
@@ -1373,14 +1595,12 @@ static void all_toplevel_set_size(struct cwc_toplevel *toplevel, void *data)
 
         clip.x = geom.x;
         clip.y = geom.y;
-
-        if (visible && !toplevel->resize_serial)
-            server.resize_count = MAX(1, server.resize_count + 1);
     }
 
-    uint32_t resize_serial = cwc_toplevel_set_size(toplevel, surf_w, surf_h);
-    if (visible)
-        toplevel->resize_serial = resize_serial;
+    // x11 has no serial to wait for
+    uint32_t serial = cwc_toplevel_set_size(toplevel, surf_w, surf_h);
+    if (visible && !cwc_toplevel_is_x11(toplevel))
+        transaction_add_configure(toplevel, serial);
 
     wlr_scene_subsurface_tree_set_clip(&toplevel->surf_tree->node, &clip);
     box->width  = surf_w;
@@ -1416,6 +1636,8 @@ save_floating_box_size(struct cwc_container *container, int w, int h)
 
 static inline void update_container_output(struct cwc_container *container)
 {
+    cwc_hit_index_update_container(container);
+
     struct wlr_box box        = cwc_container_get_box(container);
     int x                     = box.x + (box.width / 2);
     int y                     = box.y + (box.height / 2);
@@ -1452,6 +1674,7 @@ void cwc_container_set_size(struct cwc_container *container, int w, int h)
 
     container->width  = cont_w;
     container->height = cont_h;
+    cwc_hit_index_update_container(container);
 }
 
 #ifdef CWC_XWAYLAND
@@ -1653,6 +1876,7 @@ void cwc_container_to_center(struct cwc_container *container)
 void cwc_container_raise(struct cwc_container *container)
 {
     wlr_scene_node_raise_to_top(&container->tree->node);
+    cwc_hit_index_raise_container(container);
 
     cwc_object_emit_signal_simple("client::raised", g_config_get_lua_State(),
                                   cwc_container_get_front_toplevel(container));
@@ -1661,6 +1885,7 @@ void cwc_container_raise(struct cwc_container *container)
 void cwc_container_lower(struct cwc_container *container)
 {
     wlr_scene_node_lower_to_bottom(&container->tree->node);
+    cwc_hit_index_lower_container(container);
 
     cwc_object_emit_signal_simple("client::lowered", g_config_get_lua_State(),
                                   cwc_container_get_front_toplevel(container));
@@ -1668,8 +1893,16 @@ void cwc_container_lower(struct cwc_container *container)
 
 void cwc_container_set_opacity(struct cwc_container *container, float opacity)
 {
-    opacity            = CLAMP(opacity, 0.0, 1.0);
+    opacity = CLAMP(opacity, 0.0, 1.0);
+    if (opacity == container->opacity)
+        return;
+
     container->opacity = opacity;
+    cwc_container_mark_opacity_dirty(container);
+}
 
+void cwc_container_mark_opacity_dirty(struct cwc_container *container)
+{
+    wl_list_reattach(&server.opacity_dirty, &container->link_opacity_dirty);
     wlr_output_schedule_frame(container->output->wlr_output);
 }
@@ -27,6 +27,7 @@
 #include "cwc/layout/bsp.h"
 #include "cwc/layout/container.h"
 #include "cwc/layout/master.h"
+#include "cwc/server.h"
 #include "cwc/types.h"
 #include "cwc/util.h"
 
@@ -260,27 +261,37 @@ struct layout_interface *get_default_master_layout()
     return layout_list;
 }
 
-static int get_tiled_toplevel_array(struct cwc_output *output,
-                                    struct cwc_toplevel **toplevels,
-                                    int array_len)
+/* collect the tiled toplevels to the output state array, the array is only
+ * valid until the next call.
+ */
+static struct cwc_toplevel **get_tiled_toplevel_array(struct cwc_output *output,
+                                                      int *len)
 {
-    int i = 0;
+    struct wl_array *tiled = &output->state->tiled;
+    struct cwc_toplevel **elem;
+    tiled->size = 0;
+
     struct cwc_container *container;
     wl_list_for_each(container, &output->state->containers,
                      link_output_container)
     {
         struct cwc_toplevel *front =
             cwc_container_get_front_toplevel(container);
-        if (cwc_toplevel_is_tileable(front))
-            toplevels[i++] = front;
+        if (!cwc_toplevel_is_tileable(front))
+            continue;
 
-        // sanity check
-        if (i >= array_len - 1)
-            break;
+        elem  = wl_array_add(tiled, sizeof(*elem));
+        *elem = front;
     }
 
-    toplevels[i] = NULL;
-    return i;
+    *len = tiled->size / sizeof(*elem);
+
+    // NULL terminator without counting it as an element
+    elem  = wl_array_add(tiled, sizeof(*elem));
+    *elem = NULL;
+    tiled->size -= sizeof(*elem);
+
+    return tiled->data;
 }
 
 void master_arrange_update(struct cwc_output *output)
@@ -291,11 +302,12 @@ void master_arrange_update(struct cwc_output *output)
 
     struct master_state *state = &info->master_state;
 
-    struct cwc_toplevel *tiled_visible[50];
-    int i = get_tiled_toplevel_array(output, tiled_visible, 50);
+    int len;
+    struct cwc_toplevel **tiled_visible =
+        get_tiled_toplevel_array(output, &len);
 
-    if (i >= 1)
-        state->current_layout->arrange(tiled_visible, i, output, state);
+    if (len >= 1)
+        state->current_layout->arrange(tiled_visible, len, output, state);
 }
 
 static void _master_resize(struct cwc_output *output,
@@ -306,15 +318,16 @@ static void _master_resize(struct cwc_output *output,
         &cwc_output_get_current_tag_info(output)->master_state;
     struct layout_interface *layout = state->current_layout;
 
-    struct cwc_toplevel *tiled_visible[50];
-    int i = get_tiled_toplevel_array(output, tiled_visible, 50);
+    int len;
+    struct cwc_toplevel **tiled_visible =
+        get_tiled_toplevel_array(output, &len);
 
     if (layout->resize_update && stage == UPDATE)
-        layout->resize_update(tiled_visible, i, cursor, state);
+        layout->resize_update(tiled_visible, len, cursor, state);
     else if (layout->resize_start && stage == START)
-        layout->resize_start(tiled_visible, i, cursor, state);
+        layout->resize_start(tiled_visible, len, cursor, state);
     else if (layout->resize_end && stage == END)
-        layout->resize_end(tiled_visible, i, cursor, state);
+        layout->resize_end(tiled_visible, len, cursor, state);
 
     transaction_schedule_tag(cwc_output_get_current_tag_info(output));
 }
@@ -355,6 +368,7 @@ void master_set_master(struct cwc_toplevel *toplevel)
 
     wl_list_swap(&toplevel->link_output_toplevels,
                  &master->link_output_toplevels);
+    server.list_generation.toplevels++;
 
     transaction_schedule_tag(
         cwc_output_get_current_tag_info(toplevel->container->output));
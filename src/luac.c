@@ -44,6 +44,7 @@
 
 #include "cwc-luagen.h"
 #include "cwc/config.h"
+#include "cwc/desktop/frame_callback.h"
 #include "cwc/desktop/layer_shell.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/session_lock.h"
@@ -53,8 +54,10 @@
 #include "cwc/input/manager.h"
 #include "cwc/input/seat.h"
 #include "cwc/input/tablet.h"
+#include "cwc/ipc.h"
 #include "cwc/luac.h"
 #include "cwc/luaclass.h"
+#include "cwc/luaobject.h"
 #include "cwc/plugin.h"
 #include "cwc/process.h"
 #include "cwc/server.h"
@@ -149,6 +152,8 @@ static void reregister_lua_object()
  * - keyboard binding
  * - mouse binding
  * - lua signal
+ * - timer
+ * - screen frame callback
  */
 static void cwc_restart_lua(void *data)
 {
@@ -169,6 +174,13 @@ static void cwc_restart_lua(void *data)
         cwc_timer_destroy(timer);
     }
 
+    struct cwc_output *output;
+    wl_list_for_each(output, &server.outputs, link)
+    {
+        cwc_frame_callback_clear(output);
+    }
+    cwc_frame_callback_clear(server.fallback_output);
+
     cwc_lua_signal_clear(server.signal_map);
     luaC_fini();
 
@@ -202,13 +214,83 @@ static int luaC_commit(lua_State *L)
     return 0;
 }
 
+/* io_cb is either the callback or a table with the callback and the output
+ * buffering options.
+ */
+static void spawn_parse_io_options(lua_State *L,
+                                   struct cwc_process_callback_info *info)
+{
+    lua_getfield(L, 2, "callback");
+    if (lua_isfunction(L, -1))
+        info->luaref_ioready = luaL_ref(L, LUA_REGISTRYINDEX);
+    else
+        lua_pop(L, 1);
+
+    lua_getfield(L, 2, "mode");
+    const char *mode = lua_tostring(L, -1);
+    if (mode && strcmp(mode, "line") == 0)
+        info->mode = CWC_PROCESS_OUTPUT_LINE;
+    else if (mode && strcmp(mode, "exit") == 0)
+        info->mode = CWC_PROCESS_OUTPUT_EXIT;
+
+    lua_getfield(L, 2, "overflow");
+    const char *overflow = lua_tostring(L, -1);
+    if (overflow && strcmp(overflow, "drop_newest") == 0)
+        info->overflow = CWC_PROCESS_OVERFLOW_DROP_NEWEST;
+
+    lua_getfield(L, 2, "max_size");
+    if (lua_isnumber(L, -1) && lua_tonumber(L, -1) >= 1)
+        info->max_buffer = lua_tonumber(L, -1);
+
+    lua_pop(L, 3);
+}
+
+/* parse io_cb, exited_cb, and data, return false when there is no callback */
+static bool spawn_parse_callback_info(lua_State *L,
+                                      struct cwc_process_callback_info *info)
+{
+    if (lua_type(L, 2) != LUA_TFUNCTION && lua_type(L, 2) != LUA_TTABLE
+        && lua_type(L, 3) != LUA_TFUNCTION)
+        return false;
+
+    int data_idx = 3;
+    if (lua_type(L, 2) == LUA_TFUNCTION) {
+        lua_pushvalue(L, 2);
+        info->luaref_ioready = luaL_ref(L, LUA_REGISTRYINDEX);
+    } else if (lua_type(L, 2) == LUA_TTABLE) {
+        spawn_parse_io_options(L, info);
+    }
+    if (lua_type(L, 3) == LUA_TFUNCTION) {
+        lua_pushvalue(L, 3);
+        info->luaref_exited = luaL_ref(L, LUA_REGISTRYINDEX);
+        data_idx++;
+    }
+
+    if (!lua_isnoneornil(L, data_idx)) {
+        lua_pushvalue(L, data_idx);
+        info->luaref_data = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+
+    return true;
+}
+
 /** Spawn program.
  * @staticfct spawn
  * @tparam string[] vargs Array of argument list
- * @tparam[opt] function io_cb Callback function when output of stdout or
- * stderrs ready.
- * @tparam[opt] string|nil io_cb.stdout Output from stdout of the process.
- * @tparam[opt] string|nil io_cb.stderr Output from stderr of the process.
+ * @tparam[opt] function|table io_cb Callback function when output of stdout or
+ * stderrs ready, or a table to configure how the output is buffered.
+ * @tparam[opt] function io_cb.callback The callback when io_cb is a table.
+ * @tparam[opt="raw"] string io_cb.mode `"raw"` pass the output as it arrive,
+ * `"line"` pass a table of complete lines, `"exit"` pass the whole output once
+ * before the process exited.
+ * @tparam[opt] integer io_cb.max_size Maximum buffered bytes per stream,
+ * default to 64 KiB or 1 MiB in exit mode.
+ * @tparam[opt="drop_oldest"] string io_cb.overflow What to discard when the
+ * output in exit mode exceed max_size, `"drop_oldest"` or `"drop_newest"`.
+ * @tparam[opt] string|string[]|nil io_cb.stdout Output from stdout of the
+ * process.
+ * @tparam[opt] string|string[]|nil io_cb.stderr Output from stderr of the
+ * process.
  * @tparam[opt] integer io_cb.pid The process id.
  * @tparam[opt] any io_cb.data Userdata.
  * @tparam[opt] function exited_cb Callback when the process exited.
@@ -235,29 +317,12 @@ static int luaC_spawn(lua_State *L)
         lua_pop(L, 1);
     }
 
-    if (lua_type(L, 2) != LUA_TFUNCTION && lua_type(L, 3) != LUA_TFUNCTION) {
+    struct cwc_process_callback_info info = {0};
+    if (!spawn_parse_callback_info(L, &info)) {
         spawn(argv);
         goto cleanup;
     }
 
-    struct cwc_process_callback_info info = {0};
-
-    int data_idx = 3;
-    if (lua_type(L, 2) == LUA_TFUNCTION) {
-        lua_pushvalue(L, 2);
-        info.luaref_ioready = luaL_ref(L, LUA_REGISTRYINDEX);
-    }
-    if (lua_type(L, 3) == LUA_TFUNCTION) {
-        lua_pushvalue(L, 3);
-        info.luaref_exited = luaL_ref(L, LUA_REGISTRYINDEX);
-        data_idx++;
-    }
-
-    if (!lua_isnoneornil(L, data_idx)) {
-        lua_pushvalue(L, data_idx);
-        info.luaref_data = luaL_ref(L, LUA_REGISTRYINDEX);
-    }
-
     spawn_easy_async(argv, info);
 
 cleanup:
@@ -274,10 +339,20 @@ cleanup:
  * @staticfct spawn_with_shell
  * @tparam string cmd Shell command
  * @tparam[opt] string cmd Shell command
- * @tparam[opt] function io_cb Callback function when output of stdout or
- * stderrs ready.
- * @tparam[opt] string|nil io_cb.stdout Output from stdout of the process.
- * @tparam[opt] string|nil io_cb.stderr Output from stderr of the process.
+ * @tparam[opt] function|table io_cb Callback function when output of stdout or
+ * stderrs ready, or a table to configure how the output is buffered.
+ * @tparam[opt] function io_cb.callback The callback when io_cb is a table.
+ * @tparam[opt="raw"] string io_cb.mode `"raw"` pass the output as it arrive,
+ * `"line"` pass a table of complete lines, `"exit"` pass the whole output once
+ * before the process exited.
+ * @tparam[opt] integer io_cb.max_size Maximum buffered bytes per stream,
+ * default to 64 KiB or 1 MiB in exit mode.
+ * @tparam[opt="drop_oldest"] string io_cb.overflow What to discard when the
+ * output in exit mode exceed max_size, `"drop_oldest"` or `"drop_newest"`.
+ * @tparam[opt] string|string[]|nil io_cb.stdout Output from stdout of the
+ * process.
+ * @tparam[opt] string|string[]|nil io_cb.stderr Output from stderr of the
+ * process.
  * @tparam[opt] integer io_cb.pid The process id.
  * @tparam[opt] any io_cb.data Userdata.
  * @tparam[opt] function exited_cb Callback when the process exited.
@@ -290,31 +365,12 @@ static int luaC_spawn_with_shell(lua_State *L)
 {
     const char *cmd = luaL_checkstring(L, 1);
 
-    if (lua_gettop(L) == 1
-        || (lua_type(L, 2) != LUA_TFUNCTION
-            && lua_type(L, 3) != LUA_TFUNCTION)) {
+    struct cwc_process_callback_info info = {0};
+    if (!spawn_parse_callback_info(L, &info)) {
         spawn_with_shell(cmd);
         return 0;
     }
 
-    struct cwc_process_callback_info info = {0};
-
-    int data_idx = 3;
-    if (lua_type(L, 2) == LUA_TFUNCTION) {
-        lua_pushvalue(L, 2);
-        info.luaref_ioready = luaL_ref(L, LUA_REGISTRYINDEX);
-    }
-    if (lua_type(L, 3) == LUA_TFUNCTION) {
-        lua_pushvalue(L, 3);
-        info.luaref_exited = luaL_ref(L, LUA_REGISTRYINDEX);
-        data_idx++;
-    }
-
-    if (!lua_isnoneornil(L, data_idx)) {
-        lua_pushvalue(L, data_idx);
-        info.luaref_data = luaL_ref(L, LUA_REGISTRYINDEX);
-    }
-
     spawn_with_shell_easy_async(cmd, info);
 
     return 0;
@@ -361,6 +417,55 @@ static int luaC_is_startup(lua_State *L)
     return 1;
 }
 
+/** Get the hit and miss count of the cached object list.
+ *
+ * Functions that return an unfiltered object list such as `cwc.client.get` and
+ * `cwc_screen:get_clients` reuse the previously built list until the list
+ * changed.
+ *
+ * @staticfct snapshot_stats
+ * @treturn table Table with `hits` and `misses` field.
+ */
+static int luaC_snapshot_stats(lua_State *L)
+{
+    uint64_t hits, misses;
+    luaC_snapshot_stats(&hits, &misses);
+
+    lua_createtable(L, 0, 2);
+    lua_pushnumber(L, hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushnumber(L, misses);
+    lua_setfield(L, -2, "misses");
+
+    return 1;
+}
+
+/** Get the statistic of the ipc eval cache.
+ *
+ * The lua code received from the ipc (e.g. `cwctl -c`) is compiled once and
+ * reused when the same code is received again, the cache is cleared on reload.
+ *
+ * @staticfct ipc_cache_stats
+ * @treturn table Table with `hits`, `misses`, and `size` (cached chunk count)
+ * field.
+ */
+static int luaC_ipc_cache_stats(lua_State *L)
+{
+    uint64_t hits, misses;
+    int count;
+    ipc_eval_cache_stats(&hits, &misses, &count);
+
+    lua_createtable(L, 0, 3);
+    lua_pushnumber(L, hits);
+    lua_setfield(L, -2, "hits");
+    lua_pushnumber(L, misses);
+    lua_setfield(L, -2, "misses");
+    lua_pushinteger(L, count);
+    lua_setfield(L, -2, "size");
+
+    return 1;
+}
+
 /** Get cwc datadir location, it will search through `$XDG_DATA_DIRS/share/cwc`.
  * @tfield string datadir
  * @readonly
@@ -682,6 +787,8 @@ int luaC_init()
 
         {"is_nested",         luaC_is_nested        },
         {"is_startup",        luaC_is_startup       },
+        {"snapshot_stats",    luaC_snapshot_stats   },
+        {"ipc_cache_stats",   luaC_ipc_cache_stats  },
         TABLE_RO(datadir),
         TABLE_RO(version),
 
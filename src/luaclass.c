@@ -19,6 +19,7 @@
 #include "cwc/luac.h"
 #include <lauxlib.h>
 #include <lua.h>
+#include <string.h>
 
 const char *const client_classname      = "cwc_client";
 const char *const container_classname   = "cwc_container";
@@ -43,12 +44,12 @@ const char *const tablet_classname      = "cwc_tablet";
  */
 
 /* equivalent lua code:
- * function(t, k)
+ * local getters = {...} -- upvalue 1, `get_` methods with the prefix stripped
+ * local index = {...}   -- upvalue 2, the class methods
  *
- *   local mt = getmetatable(t)
- *   local index = mt.__cwcindex
+ * function(t, k)
  *
- *   if index["get_" .. k] then return index["get_" .. k]() end
+ *   if getters[k] then return getters[k](t) end
  *
  *   return index[k]
  *
@@ -56,16 +57,8 @@ const char *const tablet_classname      = "cwc_tablet";
  */
 static int luaC_getter(lua_State *L)
 {
-    if (!lua_getmetatable(L, 1))
-        return 0;
-
-    lua_getfield(L, -1, "__cwcindex");
-
-    lua_pushstring(L, "get_");
     lua_pushvalue(L, 2);
-    lua_concat(L, 2);
-
-    lua_rawget(L, -2);
+    lua_rawget(L, lua_upvalueindex(1));
 
     if (lua_isfunction(L, -1)) {
         lua_pushvalue(L, 1);
@@ -75,35 +68,26 @@ static int luaC_getter(lua_State *L)
 
     lua_pop(L, 1);
     lua_pushvalue(L, 2);
-    lua_gettable(L, -2);
+    lua_rawget(L, lua_upvalueindex(2));
 
     return 1;
 }
 
 /* equivalent lua code:
- * function(t, k, v)
+ * local setters = {...} -- upvalue 1, `set_` methods with the prefix stripped
  *
- *   local mt = getmetatable(t)
- *   local index = mt.__cwcindex
+ * function(t, k, v)
  *
- *   if not index["set_" .. k] then return end
+ *   if not setters[k] then return end
  *
- *   mt.[k](t, v)
+ *   setters[k](t, v)
  *
  * end
  */
 static int luaC_setter(lua_State *L)
 {
-    if (!lua_getmetatable(L, 1))
-        return 0;
-
-    lua_getfield(L, -1, "__cwcindex");
-
-    lua_pushstring(L, "set_");
     lua_pushvalue(L, 2);
-    lua_concat(L, 2);
-
-    lua_rawget(L, -2);
+    lua_rawget(L, lua_upvalueindex(1));
 
     if (lua_isnil(L, -1))
         return 0;
@@ -116,6 +100,27 @@ static int luaC_setter(lua_State *L)
     return 1;
 }
 
+/* push a table of methods that start with prefix keyed by the name without
+ * the prefix so the property lookup is a single rawget.
+ *
+ * [-0, +1, m]
+ */
+static void push_accessor_table(lua_State *L,
+                                luaL_Reg methods[],
+                                const char *prefix)
+{
+    size_t prefix_len = strlen(prefix);
+
+    lua_newtable(L);
+    for (luaL_Reg *reg = methods; reg->name; reg++) {
+        if (strncmp(reg->name, prefix, prefix_len) != 0)
+            continue;
+
+        lua_pushcfunction(L, reg->func);
+        lua_setfield(L, -2, reg->name + prefix_len);
+    }
+}
+
 /* methods that start with `get_` can be accessed without the prefix,
  * for example c:get_fullscreen() is the same as c.fullscreen
  *
@@ -133,16 +138,22 @@ void luaC_register_class(lua_State *L,
 
     lua_newtable(L);
     luaL_register(L, NULL, methods);
-    lua_setfield(L, -2, "__cwcindex");
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -3, "__cwcindex");
 
-    lua_pushcfunction(L, luaC_getter);
-    lua_setfield(L, -2, "__index");
+    // the getter and setter table is built once here instead of creating
+    // `get_<name>` string on every property access
+    push_accessor_table(L, methods, "get_");
+    lua_pushvalue(L, -2);
+    lua_pushcclosure(L, luaC_getter, 2);
+    lua_setfield(L, -3, "__index");
 
-    lua_pushcfunction(L, luaC_setter);
-    lua_setfield(L, -2, "__newindex");
+    push_accessor_table(L, methods, "set_");
+    lua_pushcclosure(L, luaC_setter, 1);
+    lua_setfield(L, -3, "__newindex");
 
-    // pop metatable
-    lua_pop(L, 1);
+    // pop method table and metatable
+    lua_pop(L, 2);
 }
 
 /* equivalent lua code:
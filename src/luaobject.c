@@ -24,16 +24,91 @@
 const char *const LUAC_OBJECT_REGISTRY_KEY       = "cwc.object.registry";
 const char *const LUAC_OBJECT_UDATA_REGISTRY_KEY = "cwc.object.data.registry";
 
+int luaC_object_registry_ref       = LUA_NOREF;
+int luaC_object_udata_registry_ref = LUA_NOREF;
+
+static struct {
+    uint64_t epoch; // incremented for every new lua state
+    uint64_t hits;
+    uint64_t misses;
+} snapshot_state = {0};
+
+/* create a table in the registry that can be accessed by key and by ref */
+static int registry_table_create(lua_State *L, const char *key)
+{
+    lua_newtable(L);
+
+    lua_pushstring(L, key);
+    lua_pushvalue(L, -2);
+    lua_rawset(L, LUA_REGISTRYINDEX);
+
+    return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
 /** Setup the object system at startup.
  * \param L The Lua VM state.
  */
 void luaC_object_setup(lua_State *L)
 {
-    lua_pushstring(L, LUAC_OBJECT_REGISTRY_KEY);
-    lua_newtable(L);
-    lua_rawset(L, LUA_REGISTRYINDEX);
+    luaC_object_registry_ref =
+        registry_table_create(L, LUAC_OBJECT_REGISTRY_KEY);
+    luaC_object_udata_registry_ref =
+        registry_table_create(L, LUAC_OBJECT_UDATA_REGISTRY_KEY);
 
-    lua_pushstring(L, LUAC_OBJECT_UDATA_REGISTRY_KEY);
-    lua_newtable(L);
-    lua_rawset(L, LUA_REGISTRYINDEX);
+    // the old snapshot table is gone with the old lua state
+    snapshot_state.epoch++;
+}
+
+/* copy the array at idx to the top of the stack */
+static void array_copy(lua_State *L, int idx)
+{
+    int len = lua_objlen(L, idx);
+    lua_createtable(L, len, 0);
+
+    // idx is shifted by the new table if it's relative
+    if (idx < 0 && idx > LUA_REGISTRYINDEX)
+        idx--;
+
+    for (int i = 1; i <= len; i++) {
+        lua_rawgeti(L, idx, i);
+        lua_rawseti(L, -2, i);
+    }
+}
+
+bool luaC_snapshot_push(lua_State *L,
+                        struct luaC_snapshot *snapshot,
+                        uint64_t generation)
+{
+    if (snapshot->ref <= 0 || snapshot->epoch != snapshot_state.epoch
+        || snapshot->generation != generation) {
+        snapshot_state.misses++;
+        return false;
+    }
+
+    lua_rawgeti(L, LUA_REGISTRYINDEX, snapshot->ref);
+    array_copy(L, -1);
+    lua_remove(L, -2);
+
+    snapshot_state.hits++;
+    return true;
+}
+
+void luaC_snapshot_save(lua_State *L,
+                        struct luaC_snapshot *snapshot,
+                        uint64_t generation)
+{
+    if (snapshot->ref > 0 && snapshot->epoch == snapshot_state.epoch)
+        luaL_unref(L, LUA_REGISTRYINDEX, snapshot->ref);
+
+    // the caller may modify the returned table so keep our own copy
+    array_copy(L, -1);
+    snapshot->ref        = luaL_ref(L, LUA_REGISTRYINDEX);
+    snapshot->epoch      = snapshot_state.epoch;
+    snapshot->generation = generation;
+}
+
+void luaC_snapshot_stats(uint64_t *hits, uint64_t *misses)
+{
+    *hits   = snapshot_state.hits;
+    *misses = snapshot_state.misses;
 }
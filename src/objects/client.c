@@ -293,6 +293,15 @@ static int luaC_client_get(lua_State *L)
 
     int skip_unmanaged = lua_toboolean(L, 2);
 
+    // only the list of every screen is cached
+    static struct luaC_snapshot snapshots[2];
+    struct luaC_snapshot *snapshot =
+        screen ? NULL : &snapshots[!!skip_unmanaged];
+    uint64_t generation = server.list_generation.toplevels;
+
+    if (snapshot && luaC_snapshot_push(L, snapshot, generation))
+        return 1;
+
     lua_newtable(L);
 
     struct cwc_toplevel *toplevel;
@@ -312,6 +321,9 @@ static int luaC_client_get(lua_State *L)
         lua_rawseti(L, -2, i++);
     }
 
+    if (snapshot)
+        luaC_snapshot_save(L, snapshot, generation);
+
     return 1;
 }
 
@@ -896,6 +908,7 @@ static int luaC_client_set_bspfact(lua_State *L)
 
     double newfact           = CLAMP(luaL_checknumber(L, 2), 0.05, 0.95);
     node->parent->left_wfact = newfact;
+    bsp_node_mark_dirty(node->parent);
 
     transaction_schedule_tag(
         cwc_output_get_current_tag_info(toplevel->container->output));
@@ -56,6 +56,7 @@ static int luaC_kbindmap_set_active(lua_State *L)
     struct cwc_keybind_map *kmap = luaC_kbindmap_checkudata(L, 1);
 
     kmap->active = lua_toboolean(L, 2);
+    cwc_keybind_index_mark_dirty();
 
     return 0;
 }
@@ -136,6 +137,7 @@ static int luaC_kbindmap_active_only(lua_State *L)
     }
 
     kmap->active = true;
+    cwc_keybind_index_mark_dirty();
 
     return 0;
 }
@@ -53,6 +53,8 @@
  * @tparam number dy The y vectork.
  * @tparam number dx_unaccel The x vector unaccelerated.
  * @tparam number dy_unaccel The y vector unaccelerated.
+ * @tparam integer samples Number of motion event merged, always 1 unless
+ * `cursor_coalesce_motion` is enabled.
  */
 
 /** Emitted when a mouse button is pressed/released.
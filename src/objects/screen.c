@@ -36,6 +36,8 @@
 #include <wlr/types/wlr_ext_workspace_v1.h>
 
 #include "cwc/config.h"
+#include "cwc/desktop/frame_callback.h"
+#include "cwc/desktop/frame_stats.h"
 #include "cwc/desktop/layer_shell.h"
 #include "cwc/desktop/output.h"
 #include "cwc/desktop/toplevel.h"
@@ -158,6 +160,25 @@ static int luaC_screen_at(lua_State *L)
     return 1;
 }
 
+/** Write the frame records of every screen as Chrome trace event JSON.
+ *
+ * Each screen is its own track, the file can be loaded into Perfetto or
+ * chrome://tracing.
+ *
+ * @staticfct export_frame_trace
+ * @tparam string path Output file path.
+ * @treturn boolean false if the file can't be written.
+ * @see cwc_screen:frame_stats
+ */
+static int luaC_screen_export_frame_trace(lua_State *L)
+{
+    const char *path = luaL_checkstring(L, 1);
+
+    lua_pushboolean(L, cwc_frame_stats_export_trace(path));
+
+    return 1;
+}
+
 /** Maximum workspace the compositor can handle.
  *
  * @tfield number max_workspace
@@ -362,6 +383,25 @@ static int luaC_screen_get_restored(lua_State *L)
     return 1;
 }
 
+/** Amount of scene node visited to update the opacity in the last frame.
+ *
+ * Only the subtree that has changed is visited so it should stay at zero when
+ * nothing change in the screen.
+ *
+ * @property opacity_nodes_visited
+ * @tparam[opt=0] integer opacity_nodes_visited
+ * @readonly
+ * @negativeallowed false
+ */
+static int luaC_screen_get_opacity_nodes_visited(lua_State *L)
+{
+    struct cwc_output *output = luaC_screen_checkudata(L, 1);
+
+    lua_pushinteger(L, output->opacity_nodes_visited);
+
+    return 1;
+}
+
 /** The current selected tag of the screen.
  *
  * If there are 2 or more activated tags, the compositor will use this tag to
@@ -640,6 +680,13 @@ static int luaC_screen_get_containers(lua_State *L)
 {
     struct cwc_output *output = luaC_screen_checkudata(L, 1);
     bool visible_only         = lua_toboolean(L, 2);
+    uint64_t generation       = server.list_generation.containers;
+
+    // the filtered list is not cached
+    struct luaC_snapshot *snapshot =
+        visible_only ? NULL : &output->state->containers_snapshot;
+    if (snapshot && luaC_snapshot_push(L, snapshot, generation))
+        return 1;
 
     lua_newtable(L);
 
@@ -662,6 +709,9 @@ static int luaC_screen_get_containers(lua_State *L)
         lua_rawseti(L, -2, i++);
     }
 
+    if (snapshot)
+        luaC_snapshot_save(L, snapshot, generation);
+
     return 1;
 }
 
@@ -677,6 +727,13 @@ static int luaC_screen_get_clients(lua_State *L)
 {
     struct cwc_output *output = luaC_screen_checkudata(L, 1);
     bool visible_only         = lua_toboolean(L, 2);
+    uint64_t generation       = server.list_generation.toplevels;
+
+    // the filtered list is not cached
+    struct luaC_snapshot *snapshot =
+        visible_only ? NULL : &output->state->toplevels_snapshot;
+    if (snapshot && luaC_snapshot_push(L, snapshot, generation))
+        return 1;
 
     lua_newtable(L);
 
@@ -698,6 +755,9 @@ static int luaC_screen_get_clients(lua_State *L)
         lua_rawseti(L, -2, i++);
     }
 
+    if (snapshot)
+        luaC_snapshot_save(L, snapshot, generation);
+
     return 1;
 }
 
@@ -711,6 +771,13 @@ static int luaC_screen_get_focus_stack(lua_State *L)
 {
     struct cwc_output *output = luaC_screen_checkudata(L, 1);
     bool visible_only         = lua_toboolean(L, 2);
+    uint64_t generation       = server.list_generation.focus_stack;
+
+    // the filtered list is not cached
+    struct luaC_snapshot *snapshot =
+        visible_only ? NULL : &output->state->focus_stack_snapshot;
+    if (snapshot && luaC_snapshot_push(L, snapshot, generation))
+        return 1;
 
     lua_newtable(L);
 
@@ -732,6 +799,9 @@ static int luaC_screen_get_focus_stack(lua_State *L)
         lua_rawseti(L, -2, i++);
     }
 
+    if (snapshot)
+        luaC_snapshot_save(L, snapshot, generation);
+
     return 1;
 }
 
@@ -747,6 +817,13 @@ static int luaC_screen_get_minimized(lua_State *L)
 {
     struct cwc_output *output = luaC_screen_checkudata(L, 1);
     bool visible_only         = lua_toboolean(L, 2);
+    uint64_t generation       = server.list_generation.minimized;
+
+    // the filtered list is not cached
+    struct luaC_snapshot *snapshot =
+        visible_only ? NULL : &output->state->minimized_snapshot;
+    if (snapshot && luaC_snapshot_push(L, snapshot, generation))
+        return 1;
 
     lua_newtable(L);
 
@@ -769,6 +846,9 @@ static int luaC_screen_get_minimized(lua_State *L)
         lua_rawseti(L, -2, i++);
     }
 
+    if (snapshot)
+        luaC_snapshot_save(L, snapshot, generation);
+
     return 1;
 }
 
@@ -1043,6 +1123,148 @@ static int luaC_screen_focus(lua_State *L)
     return 0;
 }
 
+/** Register a function to call right before this screen renders a frame.
+ *
+ * The function doesn't run until it's requested with `request_frame` and it's
+ * called at most once per frame no matter how many times it's requested. Use it
+ * to redraw instead of a short interval timer so nothing runs when idle.
+ *
+ * @method add_frame_callback
+ * @tparam function callback Called with the screen and the data as argument.
+ * @tparam[opt=nil] any data Second argument of the callback.
+ * @treturn integer Id of the callback.
+ * @see request_frame
+ * @see remove_frame_callback
+ */
+static int luaC_screen_add_frame_callback(lua_State *L)
+{
+    struct cwc_output *output = luaC_screen_checkudata(L, 1);
+    luaL_checktype(L, 2, LUA_TFUNCTION);
+    int data_idx = lua_isnoneornil(L, 3) ? 0 : 3;
+
+    lua_pushinteger(L, cwc_frame_callback_add(L, output, 2, data_idx));
+
+    return 1;
+}
+
+/** Mark the frame callback dirty so it's called in the next frame.
+ *
+ * @method request_frame
+ * @tparam integer id Id of the callback.
+ * @treturn boolean false if the callback doesn't exist.
+ * @see add_frame_callback
+ */
+static int luaC_screen_request_frame(lua_State *L)
+{
+    struct cwc_output *output = luaC_screen_checkudata(L, 1);
+    int id                    = luaL_checkint(L, 2);
+
+    lua_pushboolean(L, cwc_frame_callback_request(output, id));
+
+    return 1;
+}
+
+/** Unregister the frame callback.
+ *
+ * @method remove_frame_callback
+ * @tparam integer id Id of the callback.
+ * @treturn boolean false if the callback doesn't exist.
+ * @see add_frame_callback
+ */
+static int luaC_screen_remove_frame_callback(lua_State *L)
+{
+    struct cwc_output *output = luaC_screen_checkudata(L, 1);
+    int id                    = luaL_checkint(L, 2);
+
+    lua_pushboolean(L, cwc_frame_callback_remove(output, id));
+
+    return 1;
+}
+
+/** Get the frame timing statistics of the screen.
+ *
+ * Every output frame event is recorded into a ring of the last 256 frames.
+ * Durations are in microseconds, `frame_time` only covers the rendered frames
+ * still in the ring while the counters cover the screen lifetime.
+ *
+ * Each record has `start` (monotonic milliseconds), `total`, `result`,
+ * `tearing`, `tearing_rejected` and the phase durations `cursor`, `lua`,
+ * `opacity`, `build`, `commit` and `frame_done`. Result is one of `rendered`,
+ * `skipped` (no damage), `held` (waiting for resizing clients), `build_failed`
+ * or `commit_failed`.
+ *
+ * @method frame_stats
+ * @tparam[opt=false] boolean records Include the records, oldest first.
+ * @treturn table Table with `frames`, a count for each result, `tearing`,
+ * `frame_time` (`count`, `mean`, `p50`, `p99`, `max`) and `records`.
+ * @see cwc.screen.export_frame_trace
+ */
+static int luaC_screen_frame_stats(lua_State *L)
+{
+    struct cwc_output *output       = luaC_screen_checkudata(L, 1);
+    bool with_records               = lua_toboolean(L, 2);
+    const struct cwc_frame_stats *s = &output->frame_stats;
+
+    lua_newtable(L);
+
+    lua_pushnumber(L, s->frames);
+    lua_setfield(L, -2, "frames");
+    for (int i = 0; i < CWC_FRAME_RESULT_LENGTH; i++) {
+        lua_pushnumber(L, s->results[i]);
+        lua_setfield(L, -2, cwc_frame_result_name(i));
+    }
+    lua_pushnumber(L, s->tearing);
+    lua_setfield(L, -2, "tearing");
+
+    struct cwc_frame_summary summary;
+    cwc_frame_stats_summarize(s, &summary);
+
+    lua_createtable(L, 0, 5);
+    lua_pushinteger(L, summary.count);
+    lua_setfield(L, -2, "count");
+    lua_pushnumber(L, summary.mean / 1e3);
+    lua_setfield(L, -2, "mean");
+    lua_pushnumber(L, summary.p50 / 1e3);
+    lua_setfield(L, -2, "p50");
+    lua_pushnumber(L, summary.p99 / 1e3);
+    lua_setfield(L, -2, "p99");
+    lua_pushnumber(L, summary.max / 1e3);
+    lua_setfield(L, -2, "max");
+    lua_setfield(L, -2, "frame_time");
+
+    if (!with_records)
+        return 1;
+
+    uint32_t count = cwc_frame_stats_record_count(s);
+    lua_createtable(L, count, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct cwc_frame_record *record =
+            cwc_frame_stats_record_at(s, i);
+
+        lua_createtable(L, 0, 5 + CWC_FRAME_PHASE_LENGTH);
+        lua_pushnumber(L, record->start_ns / 1e6);
+        lua_setfield(L, -2, "start");
+        lua_pushnumber(L, cwc_frame_record_duration(record) / 1e3);
+        lua_setfield(L, -2, "total");
+        lua_pushstring(L, cwc_frame_result_name(record->result));
+        lua_setfield(L, -2, "result");
+        lua_pushboolean(L, record->tearing);
+        lua_setfield(L, -2, "tearing");
+        lua_pushboolean(L, record->tearing_rejected);
+        lua_setfield(L, -2, "tearing_rejected");
+
+        for (int phase = 0; phase < CWC_FRAME_PHASE_LENGTH; phase++) {
+            lua_pushnumber(L, record->phase_ns[phase] / 1e3);
+            lua_setfield(L, -2, cwc_frame_phase_name(phase));
+        }
+
+        lua_rawseti(L, -2, i + 1);
+    }
+    lua_setfield(L, -2, "records");
+
+    return 1;
+}
+
 /** Destroy this screen.
  *
  * used for debugging.
@@ -1080,6 +1302,10 @@ void luaC_screen_setup(lua_State *L)
 
     luaL_Reg screen_methods[] = {
         REG_METHOD(focus),
+        REG_METHOD(add_frame_callback),
+        REG_METHOD(request_frame),
+        REG_METHOD(remove_frame_callback),
+        REG_METHOD(frame_stats),
         REG_METHOD(get_tag),
         REG_METHOD(get_nearest),
         REG_METHOD(set_position),
@@ -1119,6 +1345,7 @@ void luaC_screen_setup(lua_State *L)
         REG_READ_ONLY(phys_height),
         REG_READ_ONLY(scale),
         REG_READ_ONLY(restored),
+        REG_READ_ONLY(opacity_nodes_visited),
         REG_READ_ONLY(selected_tag),
         REG_READ_ONLY(adaptive_sync_supported),
         REG_READ_ONLY(adaptive_sync_status),
@@ -1138,14 +1365,15 @@ void luaC_screen_setup(lua_State *L)
                         screen_metamethods);
 
     luaL_Reg screen_staticlibs[] = {
-        {"get",     luaC_screen_get    },
-        {"focused", luaC_screen_focused},
-        {"at",      luaC_screen_at     },
+        {"get",                luaC_screen_get               },
+        {"focused",            luaC_screen_focused           },
+        {"at",                 luaC_screen_at                },
+        {"export_frame_trace", luaC_screen_export_frame_trace},
 
         FIELD_RO(max_workspace),
         FIELD(useless_gaps),
 
-        {NULL,      NULL               },
+        {NULL,                 NULL                          },
     };
 
     luaC_register_table(L, "cwc.screen", screen_staticlibs, NULL);
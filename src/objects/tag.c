@@ -82,6 +82,23 @@ static int luaC_tag_get_index(lua_State *L)
     return 1;
 }
 
+/** Number of client configured by the last bsp relayout of this tag.
+ *
+ * Client which geometry doesn't change is not configured again.
+ *
+ * @property bsp_configure_count
+ * @tparam integer bsp_configure_count
+ * @readonly
+ * @propertydefault 0
+ */
+static int luaC_tag_get_bsp_configure_count(lua_State *L)
+{
+    struct cwc_tag_info *tag = luaC_tag_checkudata(L, 1);
+    lua_pushinteger(L, tag->bsp_root_entry.configure_count);
+
+    return 1;
+}
+
 /** The screen where this tag belongs.
  *
  * @property screen
@@ -384,6 +401,7 @@ void luaC_tag_setup(lua_State *L)
         REG_READ_ONLY(data),
         REG_READ_ONLY(index),
         REG_READ_ONLY(screen),
+        REG_READ_ONLY(bsp_configure_count),
 
         // properties
         REG_PROPERTY(label),
@@ -42,15 +42,24 @@ const char *const LUAC_TIMER_REGISTRY_KEY = "cwc.timer.registry";
 
 static inline void luaC_timer_registry_push(lua_State *L)
 {
-    lua_pushstring(L, LUAC_OBJECT_REGISTRY_KEY);
-    lua_rawget(L, LUA_REGISTRYINDEX);
+    luaC_object_registry_push(L);
+}
+
+/* timeout below one millisecond never fire, same as wl_event_source timer */
+static void timer_arm(struct cwc_timer *timer)
+{
+    if (timer->timeout_ms < 1)
+        cwc_timer_entry_cancel(&timer->entry);
+    else
+        cwc_timer_entry_schedule(&timer->entry, timer->timeout_ms,
+                                 timer->slack_ms);
 }
 
 void cwc_timer_destroy(struct cwc_timer *timer)
 {
     lua_State *L = g_config_get_lua_State();
     wl_list_remove(&timer->link);
-    wl_event_source_remove(timer->timer);
+    cwc_timer_entry_cancel(&timer->entry);
     luaC_object_unregister(L, timer);
     luaC_timer_registry_push(L);
     luaL_unref(L, -1, timer->cb_ref);
@@ -58,10 +67,8 @@ void cwc_timer_destroy(struct cwc_timer *timer)
     free(timer);
 }
 
-static int timer_timed_out(void *data)
+static void timer_timed_out(struct cwc_timer *timer)
 {
-    struct cwc_timer *timer = data;
-
     lua_State *L = g_config_get_lua_State();
     luaC_timer_registry_push(L);
     lua_rawgeti(L, -1, timer->cb_ref);
@@ -78,11 +85,17 @@ static int timer_timed_out(void *data)
         cwc_timer_destroy(timer);
     } else if (timer->single_shot) {
         timer->started = false;
-    } else {
-        wl_event_source_timer_update(timer->timer, timer->timeout_ms);
+    } else if (timer->started
+               && !cwc_timer_entry_is_scheduled(&timer->entry)) {
+        // the callback may have restarted or stopped it
+        timer_arm(timer);
     }
+}
 
-    return 0;
+static void on_timer_entry_expired(struct cwc_timer_entry *entry)
+{
+    struct cwc_timer *timer = wl_container_of(entry, timer, entry);
+    timer_timed_out(timer);
 }
 
 /** Create a new timer.
@@ -97,6 +110,9 @@ static int timer_timed_out(void *data)
  * function
  * @tparam[opt=false] boolean options.single_shot Run only once then stop
  * @tparam[opt=false] boolean options.one_shot Run only once then destroy
+ * @tparam[opt=0] number options.slack Allowed delay in seconds so the timer
+ * fire together with the other timers that has the same slack, useful for
+ * timer that doesn't need to be precise such as battery or network poll
  * @tparam[opt=nil] any data Userdata callback argument.
  * @noreturn
  */
@@ -128,13 +144,15 @@ static int luaC_timer_new(lua_State *L)
         if (lua_isboolean(L, -1))
             timer->one_shot = lua_toboolean(L, -1);
 
-        lua_pop(L, 4);
+        lua_getfield(L, 3, "slack");
+        if (lua_isnumber(L, -1) && lua_tonumber(L, -1) > 0)
+            timer->slack_ms = lua_tonumber(L, -1) * 1000;
+
+        lua_pop(L, 5);
     }
 
     wl_list_insert(&server.timers, &timer->link);
-
-    timer->timer =
-        wl_event_loop_add_timer(server.wl_event_loop, timer_timed_out, timer);
+    cwc_timer_entry_init(&timer->entry, on_timer_entry_expired);
 
     luaC_timer_registry_push(L);
     lua_pushvalue(L, 2);
@@ -149,7 +167,7 @@ static int luaC_timer_new(lua_State *L)
 
     if (autostart) {
         timer->started = true;
-        wl_event_source_timer_update(timer->timer, timer->timeout_ms);
+        timer_arm(timer);
     }
 
     if (call_now)
@@ -220,6 +238,34 @@ static int luaC_timer_delayed_call(lua_State *L)
     return 0;
 }
 
+/** Get the timer statistic.
+ *
+ * All timers share one event loop timer, timers that expire at the same
+ * millisecond only wake up the compositor once.
+ *
+ * @staticfct stats
+ * @treturn table Table with `active` (scheduled timer count), `wakeups`
+ * (total wakeup), `fired` (total expired timer), and `wakeups_per_second`
+ * field.
+ */
+static int luaC_timer_stats(lua_State *L)
+{
+    struct cwc_timer_wheel_stats stats;
+    cwc_timer_wheel_get_stats(&stats);
+
+    lua_createtable(L, 0, 4);
+    lua_pushinteger(L, stats.active);
+    lua_setfield(L, -2, "active");
+    lua_pushnumber(L, stats.wakeups);
+    lua_setfield(L, -2, "wakeups");
+    lua_pushnumber(L, stats.fired);
+    lua_setfield(L, -2, "fired");
+    lua_pushnumber(L, stats.wakeups_per_second);
+    lua_setfield(L, -2, "wakeups_per_second");
+
+    return 1;
+}
+
 /** Whether the timer is currently running or not.
  *
  * @property started
@@ -239,9 +285,9 @@ static int luaC_timer_set_started(lua_State *L)
     bool started            = lua_toboolean(L, 2);
 
     if (!timer->started && started) {
-        wl_event_source_timer_update(timer->timer, timer->timeout_ms);
+        timer_arm(timer);
     } else if (!started) {
-        wl_event_source_timer_update(timer->timer, 0);
+        cwc_timer_entry_cancel(&timer->entry);
     }
 
     timer->started = started;
@@ -271,7 +317,32 @@ static int luaC_timer_set_timeout(lua_State *L)
     timer->timeout_ms       = timeout * 1000;
 
     if (timer->started)
-        wl_event_source_timer_update(timer->timer, timer->timeout_ms);
+        timer_arm(timer);
+
+    return 0;
+}
+
+/** Allowed delay in seconds to fire together with other timers.
+ *
+ * The deadline is rounded up to the multiple of the slack so the timers with
+ * the same slack and close deadline wake up the compositor once.
+ *
+ * @property slack
+ * @tparam[opt=0] number slack
+ */
+static int luaC_timer_get_slack(lua_State *L)
+{
+    struct cwc_timer *timer = luaC_timer_checkudata(L, 1);
+
+    lua_pushnumber(L, timer->slack_ms / 1000.0);
+
+    return 1;
+}
+static int luaC_timer_set_slack(lua_State *L)
+{
+    struct cwc_timer *timer = luaC_timer_checkudata(L, 1);
+    double slack            = luaL_checknumber(L, 2);
+    timer->slack_ms         = slack > 0 ? slack * 1000 : 0;
 
     return 0;
 }
@@ -286,7 +357,9 @@ static int luaC_timer_start(lua_State *L)
     struct cwc_timer *timer = luaC_timer_checkudata(L, 1);
 
     if (!timer->started)
-        wl_event_source_timer_update(timer->timer, timer->timeout_ms);
+        timer_arm(timer);
+
+    timer->started = true;
 
     return 0;
 }
@@ -300,7 +373,7 @@ static int luaC_timer_stop(lua_State *L)
 {
     struct cwc_timer *timer = luaC_timer_checkudata(L, 1);
 
-    wl_event_source_timer_update(timer->timer, 0);
+    cwc_timer_entry_cancel(&timer->entry);
     timer->started = false;
 
     return 0;
@@ -355,6 +428,7 @@ void luaC_timer_setup(lua_State *L)
         REG_READ_ONLY(data),
 
         REG_PROPERTY(started), REG_PROPERTY(timeout),
+        REG_PROPERTY(slack),
 
         {NULL, NULL},
     };
@@ -364,6 +438,7 @@ void luaC_timer_setup(lua_State *L)
     luaL_Reg timer_staticlibs[] = {
         {"new",          luaC_timer_new         },
         {"delayed_call", luaC_timer_delayed_call},
+        {"stats",        luaC_timer_stats       },
 
         {NULL,           NULL                   },
     };
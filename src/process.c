@@ -16,13 +16,16 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
@@ -43,6 +46,13 @@ enum sigpfd_byte {
 static int sigpfd[2]                  = {0};
 static struct wl_list monitored_child = {0}; // struct spawn_obj.link
 
+extern char **environ;
+
+static void stream_finish(struct spawn_obj *obj,
+                          struct cwc_process_stream *s,
+                          bool is_stdout);
+static void stream_close(struct cwc_process_stream *s);
+
 static void graceful_handler(int signum)
 {
     char value[1] = {CWC_GRACEFUL};
@@ -88,6 +98,11 @@ static void free_spawn_obj(struct spawn_obj *obj)
         luaL_unref(L, LUA_REGISTRYINDEX, info->luaref_data);
     }
 
+    stream_close(&obj->out);
+    stream_close(&obj->err);
+    free(obj->out.buf);
+    free(obj->err.buf);
+
     wl_list_remove(&obj->link);
     free(info);
     free(obj);
@@ -95,18 +110,26 @@ static void free_spawn_obj(struct spawn_obj *obj)
 
 static void process_dead_child()
 {
-    int exit_code;
-    pid_t waited_pid = waitpid(-1, &exit_code, WNOHANG);
-    exit_code        = WEXITSTATUS(exit_code);
+    int status;
+    pid_t waited_pid;
 
-    struct spawn_obj *obj, *obj_temp;
-    wl_list_for_each_safe(obj, obj_temp, &monitored_child, link)
-    {
-        if (waited_pid != obj->pid)
-            continue;
+    // signals are coalesced and detached spawns are our direct children now,
+    // reap everything that has exited
+    while ((waited_pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        int exit_code = WEXITSTATUS(status);
 
-        _spawn_exit_callback_call(obj, exit_code);
-        free_spawn_obj(obj);
+        struct spawn_obj *obj, *obj_temp;
+        wl_list_for_each_safe(obj, obj_temp, &monitored_child, link)
+        {
+            if (waited_pid != obj->pid)
+                continue;
+
+            // flush the output first so the exit callback is the last
+            stream_finish(obj, &obj->out, true);
+            stream_finish(obj, &obj->err, false);
+            _spawn_exit_callback_call(obj, exit_code);
+            free_spawn_obj(obj);
+        }
     }
 }
 
@@ -132,7 +155,7 @@ static int on_sigpfd_ready(int fd, uint32_t mask, void *data)
 void setup_process(struct cwc_server *s)
 {
     /* prepare self pipe */
-    pipe(sigpfd);
+    pipe2(sigpfd, O_CLOEXEC);
     wl_list_init(&monitored_child);
 
     int flags = fcntl(sigpfd[0], F_GETFL);
@@ -165,22 +188,64 @@ void cleanup_process(struct cwc_server *s)
     close(sigpfd[1]);
 }
 
+/* start a process without forking the compositor. glibc posix_spawn uses
+ * clone(CLONE_VM | CLONE_VFORK) so the page tables of the compositor and the
+ * lua heap are never copied, the main loop only stalls until the child exec.
+ * The child gets its own session, default signal disposition, and an empty
+ * signal mask since the compositor install handlers for SIGCHLD and friends.
+ *
+ * When out_fd/err_fd is not -1 it's duplicated to the child stdout/stderr.
+ * Return the pid or -1 with errno set.
+ */
+static pid_t spawn_process(const char *file, char *const argv[], int out_fd,
+                           int err_fd)
+{
+    posix_spawnattr_t attr;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_init(&attr);
+    posix_spawn_file_actions_init(&actions);
+
+    sigset_t sigmask, sigdefault;
+    sigemptyset(&sigmask);
+    sigfillset(&sigdefault);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK
+                                        | POSIX_SPAWN_SETSIGDEF);
+
+    if (out_fd >= 0)
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    if (err_fd >= 0)
+        posix_spawn_file_actions_adddup2(&actions, err_fd, STDERR_FILENO);
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, file, &actions, &attr, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (err) {
+        errno = err;
+        return -1;
+    }
+
+    return pid;
+}
+
+static pid_t spawn_shell_process(char *command, int out_fd, int err_fd)
+{
+    char *argv[] = {"/bin/sh", "-c", command, NULL};
+    return spawn_process(argv[0], argv, out_fd, err_fd);
+}
+
 void _spawn(void *data)
 {
     struct wl_array *argvarr = data;
     char **argv              = argvarr->data;
     cwc_log(CWC_DEBUG, "spawning : %s", argv[0]);
-    if (fork() == 0) {
-        setsid();
 
-        // fork again so that it reparent to init when the first fork exited
-        if (fork() == 0) {
-            execvp(argv[0], argv);
-            cwc_log(CWC_ERROR, "spawn failed [%d]: %s", errno, argv[0]);
-        }
-
-        _exit(0);
-    }
+    if (spawn_process(argv[0], argv, -1, -1) == -1)
+        cwc_log(CWC_ERROR, "spawn failed [%d]: %s", errno, argv[0]);
 
     // function has argvarr ownership, release it
     char **s;
@@ -213,16 +278,9 @@ static void _spawn_with_shell(void *data)
 {
     char *command = data;
     cwc_log(CWC_DEBUG, "spawning with shell: %s", command);
-    if (fork() == 0) {
-        setsid();
 
-        if (fork() == 0) {
-            execl("/bin/sh", "/bin/sh", "-c", command, NULL);
-            cwc_log(CWC_ERROR, "spawn with shell failed: %s", command);
-        }
-
-        _exit(0);
-    }
+    if (spawn_shell_process(command, -1, -1) == -1)
+        cwc_log(CWC_ERROR, "spawn with shell failed [%d]: %s", errno, command);
 
     free(command);
 }
@@ -233,8 +291,146 @@ void spawn_with_shell(const char *const command)
                            strdup(command));
 }
 
+#define STREAM_MIN_CAPACITY 4096
+#define STREAM_READ_CHUNK   4096
+#define DEFAULT_MAX_BUFFER  (64 * 1024)
+#define DEFAULT_MAX_EXIT    (1024 * 1024)
+
+/* move the content to a new buffer starting at offset 0 */
+static bool stream_relocate(struct cwc_process_stream *s, size_t capacity)
+{
+    char *buf = malloc(capacity + 1);
+    if (!buf)
+        return false;
+
+    if (s->len) {
+        size_t first = MIN(s->len, s->capacity - s->head);
+        memcpy(buf, s->buf + s->head, first);
+        memcpy(buf + first, s->buf, s->len - first);
+    }
+
+    free(s->buf);
+    s->buf      = buf;
+    s->capacity = capacity;
+    s->head     = 0;
+    return true;
+}
+
+static bool stream_reserve(struct cwc_process_stream *s, size_t need)
+{
+    if (s->capacity >= need)
+        return true;
+
+    size_t capacity = s->capacity ? s->capacity : STREAM_MIN_CAPACITY;
+    while (capacity < need)
+        capacity *= 2;
+
+    return stream_relocate(s, capacity);
+}
+
+static void stream_consume(struct cwc_process_stream *s, size_t n)
+{
+    s->len -= n;
+    s->head = s->len ? (s->head + n) % s->capacity : 0;
+}
+
+/* make the content contiguous from s->buf + s->head */
+static void stream_linearize(struct cwc_process_stream *s)
+{
+    if (s->head + s->len <= s->capacity)
+        return;
+
+    if (!stream_relocate(s, s->capacity)) {
+        s->dropped += s->len;
+        stream_consume(s, s->len);
+    }
+}
+
+static void stream_append(struct cwc_process_stream *s,
+                          struct cwc_process_callback_info *info,
+                          const char *data,
+                          size_t n)
+{
+    size_t max = info->max_buffer;
+
+    if (s->len + n > max) {
+        size_t excess = s->len + n - max;
+        s->dropped += excess;
+
+        if (info->overflow == CWC_PROCESS_OVERFLOW_DROP_NEWEST) {
+            n -= excess;
+        } else if (n >= max) {
+            data += n - max;
+            n       = max;
+            s->len  = 0;
+            s->head = 0;
+        } else {
+            stream_consume(s, excess);
+        }
+    }
+
+    if (!n || !stream_reserve(s, s->len + n))
+        return;
+
+    size_t tail  = (s->head + s->len) % s->capacity;
+    size_t first = MIN(n, s->capacity - tail);
+    memcpy(s->buf + tail, data, first);
+    memcpy(s->buf, data + first, n - first);
+    s->len += n;
+}
+
+static void stream_close(struct cwc_process_stream *s)
+{
+    if (s->fd < 0)
+        return;
+
+    wl_event_source_remove(s->source);
+    close(s->fd);
+    s->source = NULL;
+    s->fd     = -1;
+}
+
+/* read what is available, raw and line mode read at most max_buffer so that a
+ * chatty child get backpressure from the pipe instead of losing output. Return
+ * true when the pipe reached eof.
+ */
+static bool stream_read(struct cwc_process_stream *s,
+                        struct cwc_process_callback_info *info,
+                        bool drain)
+{
+    char chunk[STREAM_READ_CHUNK];
+    size_t budget = info->max_buffer;
+
+    while (drain || budget) {
+        size_t want = sizeof(chunk);
+        if (info->mode != CWC_PROCESS_OUTPUT_EXIT) {
+            if (s->len >= info->max_buffer)
+                break;
+            want = MIN(want, info->max_buffer - s->len);
+        }
+        if (!drain)
+            want = MIN(want, budget);
+
+        ssize_t n = read(s->fd, chunk, want);
+        if (n == 0)
+            return true;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno != EAGAIN;
+        }
+
+        stream_append(s, info, chunk, n);
+        if (!drain)
+            budget -= n;
+    }
+
+    return false;
+}
+
 static void _spawn_io_callback_call(struct spawn_obj *obj,
                                     const char *outbuf,
+                                    size_t len,
                                     bool is_stdout)
 {
     struct cwc_process_callback_info *info = obj->info;
@@ -242,22 +438,40 @@ static void _spawn_io_callback_call(struct spawn_obj *obj,
 
     if (info->type == CWC_PROCESS_TYPE_LUA) {
         lua_rawgeti(L, LUA_REGISTRYINDEX, info->luaref_ioready);
-        if (lua_type(L, -1) != LUA_TFUNCTION)
+        if (lua_type(L, -1) != LUA_TFUNCTION) {
+            lua_pop(L, 1);
             return;
+        }
 
-        if (is_stdout) {
-            lua_pushstring(L, outbuf);
+        if (!is_stdout)
             lua_pushnil(L);
+
+        if (info->mode == CWC_PROCESS_OUTPUT_LINE) {
+            // batch all the lines in a single call
+            lua_newtable(L);
+            const char *end = outbuf + len;
+            int i           = 1;
+            while (outbuf < end) {
+                const char *nl = memchr(outbuf, '\n', end - outbuf);
+                size_t linelen = nl ? (size_t)(nl - outbuf) : end - outbuf;
+                lua_pushlstring(L, outbuf, linelen);
+                lua_rawseti(L, -2, i++);
+                outbuf += linelen + 1;
+            }
         } else {
-            lua_pushnil(L);
-            lua_pushstring(L, outbuf);
+            lua_pushlstring(L, outbuf, len);
         }
 
+        if (is_stdout)
+            lua_pushnil(L);
+
         lua_pushnumber(L, obj->pid);
         lua_rawgeti(L, LUA_REGISTRYINDEX, info->luaref_data);
-        if (lua_pcall(L, 4, 0, 0))
+        if (lua_pcall(L, 4, 0, 0)) {
             cwc_log(CWC_ERROR, "error when executing spawn callback: %s",
                     lua_tostring(L, -1));
+            lua_pop(L, 1);
+        }
     } else {
         if (is_stdout)
             info->on_ioready(obj, outbuf, NULL, info->data);
@@ -266,44 +480,95 @@ static void _spawn_io_callback_call(struct spawn_obj *obj,
     }
 }
 
-static void process_stdfd(int fd, struct spawn_obj *obj, bool is_stdout)
+/* pass the buffered output to the callback according to the mode, `final` is
+ * set when no more output will come from the stream.
+ */
+static void stream_deliver(struct spawn_obj *obj,
+                           struct cwc_process_stream *s,
+                           bool is_stdout,
+                           bool final)
 {
-    int ready_bytes;
-    ioctl(fd, FIONREAD, &ready_bytes);
-
-    if (ready_bytes == 0) {
-        if (is_stdout) {
-            wl_event_source_remove(obj->out);
-            close(obj->pipefd_out);
-        } else {
-            wl_event_source_remove(obj->err);
-            close(obj->pipefd_err);
-        }
+    struct cwc_process_callback_info *info = obj->info;
+    if (!s->len)
         return;
+
+    stream_linearize(s);
+    char *start = s->buf + s->head;
+    size_t len  = s->len;
+
+    switch (info->mode) {
+    case CWC_PROCESS_OUTPUT_RAW:
+        break;
+    case CWC_PROCESS_OUTPUT_LINE:
+        if (final)
+            break;
+
+        // keep the trailing partial line for the next read, a line is only
+        // split when it alone fills the buffer
+        char *nl = memrchr(start, '\n', len);
+        if (nl)
+            len = nl - start + 1;
+        else if (s->len < info->max_buffer)
+            return;
+        break;
+    case CWC_PROCESS_OUTPUT_EXIT:
+        if (!final)
+            return;
+        break;
     }
 
-    const int MAX_STACK = 2048;
-    if (ready_bytes <= MAX_STACK) {
-        char outbuf[MAX_STACK + 1];
-        int red     = read(fd, outbuf, ready_bytes);
-        outbuf[red] = 0;
+    // the spare byte after the capacity is there for a full buffer
+    char saved = start[len];
+    start[len] = '\0';
+    _spawn_io_callback_call(obj, start, len, is_stdout);
+    start[len] = saved;
 
-        _spawn_io_callback_call(obj, outbuf, is_stdout);
-    } else {
-        char *outbuf = malloc(ready_bytes + 1);
-        int red      = read(fd, outbuf, ready_bytes);
-        outbuf[red]  = 0;
+    stream_consume(s, len);
+}
+
+static void stream_finish(struct spawn_obj *obj,
+                          struct cwc_process_stream *s,
+                          bool is_stdout)
+{
+    struct cwc_process_callback_info *info = obj->info;
 
-        _spawn_io_callback_call(obj, outbuf, is_stdout);
-        free(outbuf);
+    // raw and line mode stop reading on a full buffer, deliver and continue
+    while (s->fd >= 0) {
+        bool eof = stream_read(s, info, true);
+        if (eof || info->mode == CWC_PROCESS_OUTPUT_EXIT
+            || s->len < info->max_buffer)
+            break;
+
+        stream_deliver(obj, s, is_stdout, false);
     }
+
+    stream_deliver(obj, s, is_stdout, true);
+    stream_close(s);
+
+    if (s->dropped)
+        cwc_log(CWC_INFO, "process %d: %zu bytes of %s dropped", obj->pid,
+                s->dropped, is_stdout ? "stdout" : "stderr");
+}
+
+static void process_stdfd(struct spawn_obj *obj, bool is_stdout)
+{
+    struct cwc_process_stream *s = is_stdout ? &obj->out : &obj->err;
+
+    bool eof = stream_read(s, obj->info, false);
+
+    // exit mode keep everything until the process exited
+    bool final = eof && obj->info->mode != CWC_PROCESS_OUTPUT_EXIT;
+    stream_deliver(obj, s, is_stdout, final);
+
+    if (eof)
+        stream_close(s);
 }
 
 static int on_pipe_stdout(int fd, uint32_t mask, void *data)
 {
     struct spawn_obj *obj = data;
 
-    process_stdfd(fd, obj, true);
+    process_stdfd(obj, true);
 
     return 0;
 }
@@ -312,7 +577,7 @@ static int on_pipe_stderr(int fd, uint32_t mask, void *data)
 {
     struct spawn_obj *obj = data;
 
-    process_stdfd(fd, obj, false);
+    process_stdfd(obj, false);
 
     return 0;
 }
@@ -332,9 +597,6 @@ static void _spawn_easy_async(void *data)
     char *command;
     char **argv;
     struct wl_array *argvarr;
-    struct spawn_obj *spawned = calloc(1, sizeof(*spawned));
-    if (!spawned)
-        goto cleanup;
 
     if (userdata->with_shell) {
         command = userdata->command;
@@ -345,47 +607,77 @@ static void _spawn_easy_async(void *data)
         cwc_log(CWC_DEBUG, "spawning : %s", argv[0]);
     }
 
+    struct spawn_obj *spawned = calloc(1, sizeof(*spawned));
+    if (!spawned) {
+        free(userdata->info);
+        goto cleanup;
+    }
+    spawned->out.fd = -1;
+    spawned->err.fd = -1;
+
+    struct cwc_process_callback_info *info = userdata->info;
+    if (!info->max_buffer)
+        info->max_buffer = info->mode == CWC_PROCESS_OUTPUT_EXIT
+                               ? DEFAULT_MAX_EXIT
+                               : DEFAULT_MAX_BUFFER;
+
+    // O_CLOEXEC so the read ends and the other spawns pipes don't leak to
+    // the child, dup2 clear the flag for the child stdout/stderr
     int pipefd_out[2];
     int pipefd_err[2];
-    pipe(pipefd_out);
-    pipe(pipefd_err);
-
-    pid_t childpid = fork();
-    if (childpid == -1) {
+    if (pipe2(pipefd_out, O_CLOEXEC) == -1) {
+        free(userdata->info);
+        free(spawned);
+        cwc_log(CWC_ERROR, "can't create pipe for child process");
+        goto cleanup;
+    }
+    if (pipe2(pipefd_err, O_CLOEXEC) == -1) {
         free(userdata->info);
         free(spawned);
         close(pipefd_out[0]);
-        close(pipefd_err[0]);
-        cwc_log(CWC_ERROR, "can't create child process");
-        goto cleanup_fd;
-    } else if (childpid == 0) {
-        setsid();
+        close(pipefd_out[1]);
+        cwc_log(CWC_ERROR, "can't create pipe for child process");
+        goto cleanup;
+    }
 
-        close(pipefd_out[0]);
-        close(pipefd_err[0]);
-        dup2(pipefd_out[1], STDOUT_FILENO);
-        dup2(pipefd_err[1], STDERR_FILENO);
+    // only our side is non blocking so that a read never stall the loop
+    fcntl(pipefd_out[0], F_SETFL, fcntl(pipefd_out[0], F_GETFL) | O_NONBLOCK);
+    fcntl(pipefd_err[0], F_SETFL, fcntl(pipefd_err[0], F_GETFL) | O_NONBLOCK);
 
-        if (userdata->with_shell) {
-            execl("/bin/sh", "/bin/sh", "-c", command, NULL);
-            cwc_log(CWC_ERROR, "spawn with shell failed: %s", command);
-        } else {
-            execvp(argv[0], argv);
+    pid_t childpid;
+    if (userdata->with_shell)
+        childpid = spawn_shell_process(command, pipefd_out[1], pipefd_err[1]);
+    else
+        childpid = spawn_process(argv[0], argv, pipefd_out[1], pipefd_err[1]);
+
+    if (childpid == -1) {
+        if (userdata->with_shell)
+            cwc_log(CWC_ERROR, "spawn with shell failed [%d]: %s", errno,
+                    command);
+        else
             cwc_log(CWC_ERROR, "spawn failed [%d]: %s", errno, argv[0]);
-        }
 
-        _exit(0);
+        // the exec failure is reported here instead of from the child, call
+        // the exited callback with the shell "command not found" code
+        spawned->info = userdata->info;
+        wl_list_insert(&monitored_child, &spawned->link);
+        _spawn_exit_callback_call(spawned, 127);
+        free_spawn_obj(spawned);
+
+        close(pipefd_out[0]);
+        close(pipefd_err[0]);
+        goto cleanup_fd;
     }
 
-    spawned->pid        = childpid;
-    spawned->pipefd_out = pipefd_out[0];
-    spawned->pipefd_err = pipefd_err[0];
-    spawned->info       = userdata->info;
-    spawned->out =
-        wl_event_loop_add_fd(server.wl_event_loop, spawned->pipefd_out,
+    spawned->pid    = childpid;
+    spawned->info   = userdata->info;
+    spawned->out.fd = pipefd_out[0];
+    spawned->err.fd = pipefd_err[0];
+    spawned->out.source =
+        wl_event_loop_add_fd(server.wl_event_loop, spawned->out.fd,
                              WL_EVENT_READABLE, on_pipe_stdout, spawned);
-    spawned->err =
-        wl_event_loop_add_fd(server.wl_event_loop, spawned->pipefd_err,
+    spawned->err.source =
+        wl_event_loop_add_fd(server.wl_event_loop, spawned->err.fd,
                              WL_EVENT_READABLE, on_pipe_stderr, spawned);
 
     wl_list_insert(&monitored_child, &spawned->link);
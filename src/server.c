@@ -205,14 +205,18 @@ server_init(struct cwc_server *s, char *config_path, char *library_path)
     wl_list_init(&s->layer_shells);
     wl_list_init(&s->kbd_kmaps);
     wl_list_init(&s->timers);
+    wl_list_init(&s->opacity_dirty);
 
     // initialize map so that luaC can insert something at startup
     s->main_kbd_kmap      = cwc_keybind_map_create(NULL);
     s->main_mouse_kmap    = cwc_keybind_map_create(NULL);
-    s->output_state_cache = cwc_hhmap_create(8);
-    s->signal_map         = cwc_hhmap_create(50);
+    s->output_state_cache = cwc_hhmap_create_keyed(8);
+    s->signal_map         = cwc_hhmap_create_keyed(50);
     s->input              = cwc_input_manager_get();
 
+    // timer can be created from the config
+    setup_timer_wheel(s);
+
     int lua_status = luaC_init();
     keybind_register_common_key();
 
@@ -326,6 +330,7 @@ void server_fini(struct cwc_server *s)
 
     cleanup_process(s);
     cleanup_ipc(s);
+    cleanup_timer_wheel(s);
 
     cleanup_text_input(s);
     cleanup_seat(s->input);
@@ -27,9 +27,11 @@
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-util.h>
 
 #include "cwc/config.h"
+#include "cwc/ipc.h"
 #include "cwc/luaobject.h"
 #include "cwc/server.h"
 #include "cwc/signal.h"
@@ -45,7 +47,8 @@ get_signal_entry_or_create_if_not_exist(const char *name)
     if (sig_entry)
         return sig_entry;
 
-    sig_entry = malloc(sizeof(*sig_entry));
+    sig_entry       = calloc(1, sizeof(*sig_entry));
+    sig_entry->name = strdup(name);
     wl_list_init(&sig_entry->c_callbacks);
     wl_list_init(&sig_entry->lua_callbacks);
     cwc_hhmap_insert(server.signal_map, name, sig_entry);
@@ -53,14 +56,28 @@ get_signal_entry_or_create_if_not_exist(const char *name)
     return sig_entry;
 }
 
-void cwc_signal_connect(const char *name, signal_callback_t callback)
+cwc_signal_handle_t cwc_signal_intern(const char *name)
 {
-    struct cwc_signal_entry *sig_entry =
-        get_signal_entry_or_create_if_not_exist(name);
+    return get_signal_entry_or_create_if_not_exist(name);
+}
 
+cwc_signal_handle_t cwc_signal_lookup(const char *name)
+{
+    return cwc_hhmap_get(server.signal_map, name);
+}
+
+void cwc_signal_connect_handle(cwc_signal_handle_t handle,
+                               signal_callback_t callback)
+{
     struct signal_c_callback *c_callback = malloc(sizeof(*c_callback));
     c_callback->callback                 = callback;
-    wl_list_insert(sig_entry->c_callbacks.prev, &c_callback->link);
+    wl_list_insert(handle->c_callbacks.prev, &c_callback->link);
+}
+
+void cwc_signal_connect(const char *name, signal_callback_t callback)
+{
+    cwc_signal_connect_handle(get_signal_entry_or_create_if_not_exist(name),
+                              callback);
 }
 
 void cwc_signal_connect_lua(const char *name, lua_State *L, int n)
@@ -81,13 +98,11 @@ static inline void signal_c_callback_destroy(struct signal_c_callback *c_cb)
     free(c_cb);
 }
 
-void cwc_signal_disconnect(const char *name, signal_callback_t callback)
+void cwc_signal_disconnect_handle(cwc_signal_handle_t handle,
+                                  signal_callback_t callback)
 {
-    struct cwc_signal_entry *sig_entry =
-        get_signal_entry_or_create_if_not_exist(name);
-
     struct signal_c_callback *c_callback;
-    wl_list_for_each_reverse(c_callback, &sig_entry->c_callbacks, link)
+    wl_list_for_each_reverse(c_callback, &handle->c_callbacks, link)
     {
         if (c_callback->callback == callback) {
             signal_c_callback_destroy(c_callback);
@@ -96,6 +111,12 @@ void cwc_signal_disconnect(const char *name, signal_callback_t callback)
     }
 }
 
+void cwc_signal_disconnect(const char *name, signal_callback_t callback)
+{
+    cwc_signal_disconnect_handle(get_signal_entry_or_create_if_not_exist(name),
+                                 callback);
+}
+
 static inline void signal_lua_callback_destroy(lua_State *L,
                                                struct signal_lua_callback *l_cb)
 {
@@ -147,6 +168,13 @@ void cwc_lua_signal_clear(struct cwc_hhmap *map)
     }
 }
 
+static inline void
+_emit_ipc(struct cwc_signal_entry *sig_entry, lua_State *L, int nargs)
+{
+    if (sig_entry->ipc_subscribers)
+        ipc_broadcast_signal(sig_entry, L, nargs);
+}
+
 static void _emit_c(struct cwc_signal_entry *sig_entry, void *data)
 {
     struct signal_c_callback *c_callback;
@@ -184,6 +212,7 @@ void cwc_signal_emit_c(const char *name, void *data)
         get_signal_entry_or_create_if_not_exist(name);
 
     _emit_c(sig_entry, data);
+    _emit_ipc(sig_entry, NULL, 0);
 }
 
 void cwc_signal_emit_lua(const char *name, lua_State *L, int nargs)
@@ -192,6 +221,7 @@ void cwc_signal_emit_lua(const char *name, lua_State *L, int nargs)
         get_signal_entry_or_create_if_not_exist(name);
 
     _emit_lua(sig_entry, L, nargs);
+    _emit_ipc(sig_entry, L, nargs);
 }
 
 void cwc_signal_emit(const char *name, void *data, lua_State *L, int nargs)
@@ -202,6 +232,31 @@ void cwc_signal_emit(const char *name, void *data, lua_State *L, int nargs)
 
     _emit_c(sig_entry, data);
     _emit_lua(sig_entry, L, nargs);
+    _emit_ipc(sig_entry, L, nargs);
+}
+
+void cwc_signal_emit_handle(cwc_signal_handle_t handle,
+                            void *data,
+                            lua_State *L,
+                            int nargs)
+{
+    _emit_c(handle, data);
+    _emit_lua(handle, L, nargs);
+    _emit_ipc(handle, L, nargs);
+}
+
+int cwc_object_emit_signal_handle_simple(cwc_signal_handle_t handle,
+                                         lua_State *L,
+                                         void *pointer)
+{
+    if (!cwc_signal_has_listeners(handle))
+        return 0;
+
+    luaC_object_push(L, pointer);
+    cwc_signal_emit_handle(handle, pointer, L, 1);
+    lua_pop(L, 1);
+
+    return 0;
 }
 
 int cwc_object_emit_signal_simple(const char *name, lua_State *L, void *pointer)
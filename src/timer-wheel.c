@@ -0,0 +1,319 @@
+/* timer-wheel.c - hierarchical timer wheel
+ *
+ * Copyright (C) 2025 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The wheel has WHEEL_LEVELS level of WHEEL_SIZE slot, one tick is one
+ * millisecond. Level n slot covers WHEEL_SIZE^n tick, an entry is put in the
+ * lowest level that can hold its deadline and moved down (cascaded) when the
+ * wheel reach the start of its slot so the level 0 slot only contains entries
+ * that expire exactly at that tick.
+ *
+ * The event loop timer is armed to the nearest level 0 deadline or cascade
+ * instead of ticking every millisecond.
+ */
+
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wayland-util.h>
+
+#include "cwc/server.h"
+#include "cwc/timer.h"
+
+#define WHEEL_BITS   6
+#define WHEEL_SIZE   (1 << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+
+/* deadline further than this is clamped and re-queued on cascade (~4.6 hour) */
+#define WHEEL_RANGE ((uint64_t)1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct {
+    struct wl_event_source *source;
+    struct wl_list slots[WHEEL_LEVELS][WHEEL_SIZE];
+    uint64_t now; // every entry that expires before this is already fired
+    bool running;
+
+    uint32_t active;
+    uint64_t wakeups;
+    uint64_t fired;
+
+    uint64_t window_start;
+    uint64_t window_wakeups;
+    double wakeups_per_second;
+} wheel;
+
+static uint64_t monotonic_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static inline uint64_t level_span(int level)
+{
+    return (uint64_t)1 << (WHEEL_BITS * level);
+}
+
+static void wheel_insert(struct cwc_timer_entry *entry)
+{
+    uint64_t expires = entry->expires;
+    if (expires < wheel.now)
+        expires = wheel.now;
+
+    uint64_t delta = expires - wheel.now;
+    if (delta >= WHEEL_RANGE) {
+        expires = wheel.now + WHEEL_RANGE - 1;
+        delta   = WHEEL_RANGE - 1;
+    }
+
+    int level = 0;
+    while (delta >= level_span(level + 1))
+        level++;
+
+    int slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    wl_list_insert(wheel.slots[level][slot].prev, &entry->link);
+}
+
+/* the earliest tick where something needs to be done, UINT64_MAX if empty */
+static uint64_t wheel_next_tick()
+{
+    uint64_t next = UINT64_MAX;
+
+    // level 0 entries are in [now, now + WHEEL_SIZE) so the slot maps to one
+    // tick
+    for (int i = 0; i < WHEEL_SIZE; i++) {
+        if (wl_list_empty(&wheel.slots[0][i]))
+            continue;
+
+        uint64_t tick = (wheel.now & ~(uint64_t)WHEEL_MASK) | i;
+        if (tick < wheel.now)
+            tick += WHEEL_SIZE;
+
+        if (tick < next)
+            next = tick;
+    }
+
+    // higher level slot is cascaded at the start of the slot, the current slot
+    // is already cascaded unless the start is now so it's the next round
+    for (int level = 1; level < WHEEL_LEVELS; level++) {
+        int shift       = WHEEL_BITS * level;
+        uint64_t block  = wheel.now >> shift;
+        int current_idx = block & WHEEL_MASK;
+        bool at_start   = !(wheel.now & (level_span(level) - 1));
+
+        for (int i = 0; i < WHEEL_SIZE; i++) {
+            if (wl_list_empty(&wheel.slots[level][i]))
+                continue;
+
+            int distance = (i - current_idx) & WHEEL_MASK;
+            if (distance == 0 && !at_start)
+                distance = WHEEL_SIZE;
+
+            uint64_t tick = (block + distance) << shift;
+            if (tick < next)
+                next = tick;
+        }
+    }
+
+    return next;
+}
+
+static void wheel_cascade(uint64_t tick)
+{
+    for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+        if (tick & (level_span(level) - 1))
+            continue;
+
+        int slot            = (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        struct wl_list *src = &wheel.slots[level][slot];
+
+        struct wl_list pending;
+        wl_list_init(&pending);
+        wl_list_insert_list(&pending, src);
+        wl_list_init(src);
+
+        struct cwc_timer_entry *entry, *tmp;
+        wl_list_for_each_safe(entry, tmp, &pending, link)
+        {
+            wheel_insert(entry);
+        }
+    }
+}
+
+static void wheel_expire(uint64_t tick)
+{
+    struct wl_list *slot = &wheel.slots[0][tick & WHEEL_MASK];
+
+    struct wl_list expired;
+    wl_list_init(&expired);
+    wl_list_insert_list(&expired, slot);
+    wl_list_init(slot);
+
+    // the notify may cancel or reschedule any entry, take one at a time
+    while (!wl_list_empty(&expired)) {
+        struct cwc_timer_entry *entry =
+            wl_container_of(expired.next, entry, link);
+        wl_list_remove(&entry->link);
+        wl_list_init(&entry->link);
+
+        wheel.active--;
+        wheel.fired++;
+        entry->notify(entry);
+    }
+}
+
+static void wheel_arm()
+{
+    if (!wheel.source)
+        return;
+
+    uint64_t next = wheel_next_tick();
+    if (next == UINT64_MAX) {
+        wl_event_source_timer_update(wheel.source, 0);
+        return;
+    }
+
+    uint64_t now   = monotonic_ms();
+    uint64_t delay = next > now ? next - now : 1;
+    if (delay > INT32_MAX)
+        delay = INT32_MAX;
+
+    wl_event_source_timer_update(wheel.source, delay);
+}
+
+static void update_wakeup_rate(uint64_t now)
+{
+    wheel.wakeups++;
+    wheel.window_wakeups++;
+
+    uint64_t elapsed = now - wheel.window_start;
+    if (elapsed < 1000)
+        return;
+
+    wheel.wakeups_per_second =
+        (double)wheel.window_wakeups * 1000 / (double)elapsed;
+    wheel.window_start   = now;
+    wheel.window_wakeups = 0;
+}
+
+static int on_wheel_timer(void *data)
+{
+    uint64_t target = monotonic_ms();
+    update_wakeup_rate(target);
+
+    wheel.running = true;
+
+    uint64_t tick;
+    while ((tick = wheel_next_tick()) <= target) {
+        wheel.now = tick;
+        wheel_cascade(tick);
+        wheel_expire(tick);
+        wheel.now = tick + 1;
+    }
+
+    wheel.running = false;
+    wheel_arm();
+
+    return 0;
+}
+
+void cwc_timer_entry_init(struct cwc_timer_entry *entry,
+                          void (*notify)(struct cwc_timer_entry *entry))
+{
+    wl_list_init(&entry->link);
+    entry->expires = 0;
+    entry->notify  = notify;
+}
+
+void cwc_timer_entry_schedule(struct cwc_timer_entry *entry,
+                              uint32_t timeout_ms,
+                              uint32_t slack_ms)
+{
+    if (cwc_timer_entry_is_scheduled(entry)) {
+        wl_list_remove(&entry->link);
+        wheel.active--;
+    }
+
+    uint64_t now = monotonic_ms();
+
+    // nothing to cascade in an empty wheel, catch up so the new entry land in
+    // the lowest possible level
+    if (!wheel.active && !wheel.running && now > wheel.now)
+        wheel.now = now;
+
+    uint64_t expires = now + (timeout_ms ? timeout_ms : 1);
+    if (slack_ms > 1)
+        expires = (expires + slack_ms - 1) / slack_ms * slack_ms;
+
+    // fired in the current dispatch would loop forever
+    if (wheel.running && expires <= wheel.now)
+        expires = wheel.now + 1;
+
+    entry->expires = expires;
+    wheel_insert(entry);
+    wheel.active++;
+
+    if (!wheel.running)
+        wheel_arm();
+}
+
+void cwc_timer_entry_cancel(struct cwc_timer_entry *entry)
+{
+    if (!cwc_timer_entry_is_scheduled(entry))
+        return;
+
+    wl_list_remove(&entry->link);
+    wl_list_init(&entry->link);
+    wheel.active--;
+
+    if (!wheel.running)
+        wheel_arm();
+}
+
+void cwc_timer_wheel_get_stats(struct cwc_timer_wheel_stats *stats)
+{
+    stats->active             = wheel.active;
+    stats->wakeups            = wheel.wakeups;
+    stats->fired              = wheel.fired;
+    stats->wakeups_per_second = wheel.wakeups_per_second;
+
+    // the current window is already longer than one second when the wakeup
+    // is rare
+    uint64_t elapsed = monotonic_ms() - wheel.window_start;
+    if (elapsed >= 1000)
+        stats->wakeups_per_second =
+            (double)wheel.window_wakeups * 1000 / (double)elapsed;
+}
+
+void setup_timer_wheel(struct cwc_server *s)
+{
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int i = 0; i < WHEEL_SIZE; i++)
+            wl_list_init(&wheel.slots[level][i]);
+
+    wheel.now          = monotonic_ms();
+    wheel.window_start = wheel.now;
+    wheel.source = wl_event_loop_add_timer(s->wl_event_loop, on_wheel_timer,
+                                           NULL);
+}
+
+void cleanup_timer_wheel(struct cwc_server *s)
+{
+    wl_event_source_remove(wheel.source);
+    wheel.source = NULL;
+}
@@ -26,157 +26,339 @@
 #include <string.h>
 #include <xxhash.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "cwc/util.h"
 
-static inline void __recompute_limit(struct cwc_hhmap *map)
+#define CTRL_EMPTY   0x80
+#define CTRL_DELETED 0xfe
+#define MIN_ALLOC    16
+
+/* A group is a run of control bytes compared at once, the match result is a
+ * bitmask where the set bit position >> GROUP_SHIFT is the slot offset.
+ */
+#if defined(__SSE2__)
+
+#define GROUP_WIDTH 16
+#define GROUP_SHIFT 0
+typedef uint32_t group_mask_t;
+
+static inline group_mask_t group_match(const uint8_t *ctrl, uint8_t h2)
 {
-    map->expand_at_size_exceed = map->alloc * 3 / 4;
-    map->shrink_at_size_behind = map->alloc / 5;
-#ifdef HHMAP_AUTOMATIC_REHASH
-    map->rehash_at_remove_counter_exceed = map->alloc;
-    map->remove_counter                  = 0;
-#endif /* ifdef HHMAP_AUTOMATIC_REHASH */
-    if (map->shrink_at_size_behind < 8)
-        map->shrink_at_size_behind = 0;
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
 }
 
-struct cwc_hhmap *cwc_hhmap_create(int prealloc_size)
+static inline group_mask_t group_match_empty(const uint8_t *ctrl)
+{
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_EMPTY)));
+}
+
+/* full slot has the high bit cleared */
+static inline group_mask_t group_match_free(const uint8_t *ctrl)
+{
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(__ARM_NEON)
+
+#define GROUP_WIDTH 8
+#define GROUP_SHIFT 3
+typedef uint64_t group_mask_t;
+
+static inline group_mask_t neon_mask(uint8x8_t cmp)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(cmp), 0) & 0x8080808080808080ULL;
+}
+
+static inline group_mask_t group_match(const uint8_t *ctrl, uint8_t h2)
+{
+    return neon_mask(vceq_u8(vld1_u8(ctrl), vdup_n_u8(h2)));
+}
+
+static inline group_mask_t group_match_empty(const uint8_t *ctrl)
+{
+    return neon_mask(vceq_u8(vld1_u8(ctrl), vdup_n_u8(CTRL_EMPTY)));
+}
+
+static inline group_mask_t group_match_free(const uint8_t *ctrl)
+{
+    return neon_mask(vld1_u8(ctrl));
+}
+
+#else
+
+#define GROUP_WIDTH 8
+#define GROUP_SHIFT 3
+typedef uint64_t group_mask_t;
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static inline uint64_t group_load(const uint8_t *ctrl)
+{
+    uint64_t word;
+    memcpy(&word, ctrl, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+/* may report a false positive on the byte after a real match, it's fine
+ * since the hash is compared afterward anyway.
+ */
+static inline group_mask_t group_match(const uint8_t *ctrl, uint8_t h2)
+{
+    uint64_t x = group_load(ctrl) ^ (LSBS * h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static inline group_mask_t group_match_empty(const uint8_t *ctrl)
+{
+    uint64_t x = group_load(ctrl);
+    return x & ~(x << 6) & MSBS;
+}
+
+static inline group_mask_t group_match_free(const uint8_t *ctrl)
+{
+    return group_load(ctrl) & MSBS;
+}
+
+#endif
+
+static inline uint64_t mask_next(group_mask_t *mask)
+{
+    uint64_t offset = __builtin_ctzll(*mask) >> GROUP_SHIFT;
+    *mask &= *mask - 1;
+    return offset;
+}
+
+/* 0 mark an unoccupied entry */
+static inline uint64_t hash_key(const void *key, size_t len)
+{
+    uint64_t hash = XXH3_64bits(key, len);
+    return hash ? hash : 1;
+}
+
+static inline uint8_t hash_h2(uint64_t hash)
+{
+    return hash & 0x7f;
+}
+
+static inline uint64_t max_load(uint64_t alloc)
+{
+    return alloc - alloc / 8;
+}
+
+static inline void set_ctrl(struct cwc_hhmap *map, uint64_t idx, uint8_t ctrl)
+{
+    map->ctrl[idx] = ctrl;
+    if (idx < GROUP_WIDTH)
+        map->ctrl[map->alloc + idx] = ctrl;
+}
+
+static bool table_init(struct cwc_hhmap *map, uint64_t alloc)
+{
+    uint8_t *ctrl             = malloc(alloc + GROUP_WIDTH);
+    struct hhash_entry *table = calloc(alloc, sizeof(*table));
+    if (!ctrl || !table) {
+        free(ctrl);
+        free(table);
+        return false;
+    }
+
+    memset(ctrl, CTRL_EMPTY, alloc + GROUP_WIDTH);
+    map->ctrl        = ctrl;
+    map->table       = table;
+    map->alloc       = alloc;
+    map->size        = 0;
+    map->growth_left = max_load(alloc);
+
+    return true;
+}
+
+static struct cwc_hhmap *hhmap_create(int prealloc_size, bool keyed)
 {
     struct cwc_hhmap *m = malloc(sizeof(*m));
     if (!m)
         return NULL;
 
-    uint64_t init_alloc = 8;
-    while (init_alloc < prealloc_size)
-        init_alloc <<= 1;
+    // room for prealloc_size entries without rehashing
+    uint64_t alloc = MIN_ALLOC;
+    while (max_load(alloc) < (uint64_t)MAX(prealloc_size, 0))
+        alloc <<= 1;
 
-    m->size  = 0;
-    m->alloc = init_alloc;
-    m->table = calloc(init_alloc, sizeof(*m->table));
-    __recompute_limit(m);
-    // disable shrink limit to respect initial_size
-    m->shrink_at_size_behind = 0;
+    m->keyed = keyed;
+    if (!table_init(m, alloc)) {
+        free(m);
+        return NULL;
+    }
 
     return m;
 }
 
+struct cwc_hhmap *cwc_hhmap_create(int prealloc_size)
+{
+    return hhmap_create(prealloc_size, false);
+}
+
+struct cwc_hhmap *cwc_hhmap_create_keyed(int prealloc_size)
+{
+    return hhmap_create(prealloc_size, true);
+}
+
 void cwc_hhmap_destroy(struct cwc_hhmap *map)
 {
+    if (map->keyed) {
+        for (uint64_t i = 0; i < map->alloc; i++)
+            free(map->table[i].key);
+    }
+
+    free(map->ctrl);
     free(map->table);
     free(map);
 }
 
-/* return pointer to hash_entry that found, return NULL otherwise */
-struct hhash_entry *cwc_hhmap_lookup(struct cwc_hhmap *map,
-                                     uint64_t hash,
-                                     struct hhash_entry **prev)
+static inline bool entry_match(struct cwc_hhmap *map,
+                               struct hhash_entry *entry,
+                               uint64_t hash,
+                               const void *key,
+                               size_t len)
 {
-    uint64_t alloc            = map->alloc;
-    struct hhash_entry *table = map->table;
-    uint64_t idx              = hash % alloc;
-    struct hhash_entry *root  = &table[idx];
-
-    // loop until the end of linked list
-    *prev                       = root;
-    struct hhash_entry *current = root;
-    do {
-        if (hash == current->hash)
-            break;
+    if (entry->hash != hash)
+        return false;
 
-        *prev   = current;
-        current = current->next;
+    if (!map->keyed)
+        return true;
 
-    } while (current != NULL);
-
-    return current;
+    return entry->key_len == len && memcmp(entry->key, key, len) == 0;
 }
 
-static inline void __cwc_hhmap_rehash_expand(struct cwc_hhmap *map);
+/* return pointer to hash_entry that found, return NULL otherwise */
+static struct hhash_entry *
+hhmap_lookup(struct cwc_hhmap *map, uint64_t hash, const void *key, size_t len)
+{
+    uint64_t mask = map->alloc - 1;
+    uint64_t pos  = (hash >> 7) & mask;
+    uint8_t h2    = hash_h2(hash);
+
+    // triangular probing visit every group when alloc is power of two
+    for (uint64_t step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+        const uint8_t *group = &map->ctrl[pos];
+
+        group_mask_t match = group_match(group, h2);
+        while (match) {
+            uint64_t idx              = (pos + mask_next(&match)) & mask;
+            struct hhash_entry *entry = &map->table[idx];
+            if (entry_match(map, entry, hash, key, len))
+                return entry;
+        }
+
+        if (group_match_empty(group))
+            return NULL;
+
+        pos = (pos + step) & mask;
+    }
+}
 
-static inline void
-__cwc_hhmap_insert(struct cwc_hhmap *map, uint64_t hash, void *data)
+static uint64_t find_free_slot(struct cwc_hhmap *map, uint64_t hash)
 {
-    struct hhash_entry *prev;
-    struct hhash_entry *current = cwc_hhmap_lookup(map, hash, &prev);
+    uint64_t mask = map->alloc - 1;
+    uint64_t pos  = (hash >> 7) & mask;
 
-    if (current) {
-        current->data = data;
-        return;
-    }
+    for (uint64_t step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+        group_mask_t free_slot = group_match_free(&map->ctrl[pos]);
+        if (free_slot)
+            return (pos + mask_next(&free_slot)) & mask;
 
-    // find empty block using linear probing
-    struct hhash_entry *table = map->table;
-    uint64_t alloc            = map->alloc;
-    uint64_t idx              = prev - table;
-    current                   = &table[idx];
-    while (current->hash != 0) {
-        idx += 1; // jump interval, must be prime number
-        if (idx >= alloc)
-            idx -= alloc;
-
-        current = &table[idx];
+        pos = (pos + step) & mask;
     }
+}
 
-    current->hash = hash;
-    current->data = data;
-    map->size++;
-
-    if (prev != current)
-        prev->next = current;
+/* move the entry to a fresh table, the key ownership is moved as is */
+static void place_entry(struct cwc_hhmap *map, struct hhash_entry *entry)
+{
+    uint64_t idx = find_free_slot(map, entry->hash);
 
-    __cwc_hhmap_rehash_expand(map);
+    set_ctrl(map, idx, hash_h2(entry->hash));
+    map->table[idx] = *entry;
+    map->size++;
+    map->growth_left--;
 }
 
 void __cwc_hhmap_rehash_to_size(struct cwc_hhmap *map, uint64_t new_size)
 {
-    uint64_t alloc                = map->alloc;
+    uint64_t alloc = MIN_ALLOC;
+    while (alloc < new_size || max_load(alloc) < map->size)
+        alloc <<= 1;
+
+    uint64_t old_alloc            = map->alloc;
+    uint8_t *old_ctrl             = map->ctrl;
     struct hhash_entry *old_table = map->table;
-    struct hhash_entry *new_table = calloc(new_size, sizeof(*new_table));
-    if (new_table == NULL)
-        return;
 
-    map->table = new_table;
-    map->size  = 0;
-    map->alloc = new_size;
-    __recompute_limit(map);
+    if (!table_init(map, alloc))
+        return;
 
-    for (uint64_t i = 0; i < alloc; i++) {
-        struct hhash_entry *elem = &old_table[i];
-        if (!elem->hash)
-            continue;
-        __cwc_hhmap_insert(map, elem->hash, elem->data);
+    for (uint64_t i = 0; i < old_alloc; i++) {
+        if (old_table[i].hash)
+            place_entry(map, &old_table[i]);
     }
 
+    free(old_ctrl);
     free(old_table);
 }
 
-/* expand and rehash to half filled bucket (75% load to about 40%) */
-static inline void __cwc_hhmap_rehash_expand(struct cwc_hhmap *map)
+static inline void
+__cwc_hhmap_insert(struct cwc_hhmap *map, const void *key, int len, void *data)
 {
-    if (map->expand_at_size_exceed >= map->size)
+    uint64_t hash             = hash_key(key, len);
+    struct hhash_entry *entry = hhmap_lookup(map, hash, key, len);
+
+    if (entry) {
+        entry->data = data;
         return;
+    }
 
-    __cwc_hhmap_rehash_to_size(map, map->alloc * 2);
-}
+    uint64_t idx = find_free_slot(map, hash);
 
-/* Rehash and shrink to half (20% load to 50% load)
- *
- * Want to use realloc by moving upper address to lower address originally but
- * the singly linked list point to random place makes it hard.
- */
-static inline void __cwc_hhmap_rehash_shrink(struct cwc_hhmap *map)
-{
-    if (map->size >= map->shrink_at_size_behind)
-        return;
+    // out of empty slot, drop the tombstones or grow if it's mostly filled
+    if (map->growth_left == 0 && map->ctrl[idx] == CTRL_EMPTY) {
+        if (map->size < max_load(map->alloc) / 2)
+            __cwc_hhmap_rehash_to_size(map, map->alloc);
+        else
+            __cwc_hhmap_rehash_to_size(map, map->alloc * 2);
+
+        idx = find_free_slot(map, hash);
+    }
+
+    struct hhash_entry new_entry = {.hash = hash, .data = data};
+    if (map->keyed) {
+        new_entry.key = malloc(len);
+        if (!new_entry.key)
+            return;
+
+        memcpy(new_entry.key, key, len);
+        new_entry.key_len = len;
+    }
+
+    if (map->ctrl[idx] == CTRL_EMPTY && map->growth_left)
+        map->growth_left--;
 
-    __cwc_hhmap_rehash_to_size(map, map->alloc / 2);
+    set_ctrl(map, idx, hash_h2(hash));
+    map->table[idx] = new_entry;
+    map->size++;
 }
 
 void cwc_hhmap_insert(struct cwc_hhmap *map, const char *key, void *data)
 {
-    uint64_t xxhash = XXH3_64bits(key, strlen(key));
-
-    __cwc_hhmap_insert(map, xxhash, data);
+    __cwc_hhmap_insert(map, key, strlen(key), data);
 }
 
 void cwc_hhmap_ninsert(struct cwc_hhmap *map,
@@ -184,92 +366,59 @@ void cwc_hhmap_ninsert(struct cwc_hhmap *map,
                        int key_len,
                        void *data)
 {
-    uint64_t xxhash = XXH3_64bits(key, key_len);
-    __cwc_hhmap_insert(map, xxhash, data);
+    __cwc_hhmap_insert(map, key, key_len, data);
 }
 
-static inline void *__cwc_hhmap_get(struct cwc_hhmap *map, uint64_t hash)
+static inline struct hhash_entry *
+__cwc_hhmap_get_entry(struct cwc_hhmap *map, const void *key, size_t len)
 {
-    struct hhash_entry *prev;
-    struct hhash_entry *result = cwc_hhmap_lookup(map, hash, &prev);
-
-    if (result)
-        return result->data;
-
-    return NULL;
+    return hhmap_lookup(map, hash_key(key, len), key, len);
 }
 
 void *cwc_hhmap_get(struct cwc_hhmap *map, const char *key)
 {
-    uint64_t xxhash = XXH3_64bits(key, strlen(key));
-    return __cwc_hhmap_get(map, xxhash);
+    struct hhash_entry *entry = __cwc_hhmap_get_entry(map, key, strlen(key));
+    return entry ? entry->data : NULL;
 }
 
 void *cwc_hhmap_nget(struct cwc_hhmap *map, const void *key, int key_len)
 {
-    uint64_t xxhash = XXH3_64bits(key, key_len);
-    return __cwc_hhmap_get(map, xxhash);
-}
-
-struct hhash_entry *__cwc_hhmap_get_entry(struct cwc_hhmap *map, uint64_t hash)
-{
-    struct hhash_entry *prev;
-    struct hhash_entry *result = cwc_hhmap_lookup(map, hash, &prev);
-
-    return result;
+    struct hhash_entry *entry = __cwc_hhmap_get_entry(map, key, key_len);
+    return entry ? entry->data : NULL;
 }
 
 struct hhash_entry *cwc_hhmap_get_entry(struct cwc_hhmap *map, const char *key)
 {
-    uint64_t xxhash = XXH3_64bits(key, strlen(key));
-    return __cwc_hhmap_get_entry(map, xxhash);
+    return __cwc_hhmap_get_entry(map, key, strlen(key));
 }
 
 struct hhash_entry *
 cwc_hhmap_nget_entry(struct cwc_hhmap *map, const void *key, int key_len)
 {
-    uint64_t xxhash = XXH3_64bits(key, key_len);
-    return __cwc_hhmap_get_entry(map, xxhash);
+    return __cwc_hhmap_get_entry(map, key, key_len);
 }
 
-void __cwc_hhmap_remove(struct cwc_hhmap *map, uint64_t hash)
+static void __cwc_hhmap_remove(struct cwc_hhmap *map, const void *key, int len)
 {
-    struct hhash_entry *prev;
-    struct hhash_entry *result = cwc_hhmap_lookup(map, hash, &prev);
-
-    if (result == NULL)
+    struct hhash_entry *entry = __cwc_hhmap_get_entry(map, key, len);
+    if (!entry)
         return;
 
-    // if its the last node then clear
-    if (result->next == NULL) {
-        if (prev)
-            prev->next = NULL;
-        *result = (struct hhash_entry){0};
-    } else { // keep the link for other to use
-        result->hash = 0;
-        result->data = NULL;
-    }
+    uint64_t idx = entry - map->table;
 
+    // a probe may have passed this slot, keep it going with a tombstone
+    set_ctrl(map, idx, CTRL_DELETED);
+    free(entry->key);
+    *entry = (struct hhash_entry){0};
     map->size--;
-
-#ifdef HHMAP_AUTOMATIC_REHASH
-    map->remove_counter++;
-    if (map->remove_counter >= map->rehash_at_remove_counter_exceed)
-        __cwc_hhmap_rehash_to_size(map, map->alloc);
-#else
-    __cwc_hhmap_rehash_shrink(map);
-#endif /* ifdef HHMAP_AUTOMATIC_REHASH */
 }
 
 void cwc_hhmap_remove(struct cwc_hhmap *map, const char *key)
 {
-    uint64_t xxhash = XXH3_64bits(key, strlen(key));
-    __cwc_hhmap_remove(map, xxhash);
+    __cwc_hhmap_remove(map, key, strlen(key));
 }
 
 void cwc_hhmap_nremove(struct cwc_hhmap *map, const void *key, int key_len)
 {
-
-    uint64_t xxhash = XXH3_64bits(key, key_len);
-    __cwc_hhmap_remove(map, xxhash);
+    __cwc_hhmap_remove(map, key, key_len);
 }
@@ -25,214 +25,208 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "cwc/util.h"
-
-struct cwc_vec *cwc_vec_create(int elem_sizeof, int reserved)
-{
-    struct cwc_vec *vec = calloc(1, sizeof(*vec));
-    if (!vec)
-        return NULL;
-
-    switch (elem_sizeof) {
-    case sizeof(int8_t):
-    case sizeof(int16_t):
-    case sizeof(int32_t):
-    case sizeof(int64_t):
-        break;
-    default:
-        fprintf(stderr, "non standard size\n");
-        abort();
-    }
-
-    if (reserved < 4)
-        reserved = 4;
-
-    vec->elem_sizeof = elem_sizeof;
-    vec->alloc       = reserved;
-    vec->data        = calloc(1, reserved * elem_sizeof);
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
-    return vec;
-}
+#include "cwc/util.h"
 
-void cwc_vec_destroy(struct cwc_vec *vec)
+bool __cwc_vec_grow(void **data,
+                    size_t *alloc,
+                    size_t min_alloc,
+                    size_t elem_size,
+                    void *inline_data,
+                    size_t count)
 {
-    free(vec->data);
-    free(vec);
-}
+    size_t new_alloc = *alloc < 4 ? 4 : *alloc;
+    while (new_alloc < min_alloc)
+        new_alloc *= 2;
 
-static void assign_idx(struct cwc_vec *vec, size_t idx, uint64_t packed_data)
-{
-    switch (vec->elem_sizeof) {
-    case sizeof(int8_t):
-        ((int8_t *)(vec->data))[idx] = packed_data;
-        break;
-    case sizeof(int16_t):
-        ((int16_t *)(vec->data))[idx] = packed_data;
-        break;
-    case sizeof(int32_t):
-        ((int32_t *)(vec->data))[idx] = packed_data;
-        break;
-    case sizeof(int64_t):
-        ((int64_t *)(vec->data))[idx] = packed_data;
-        break;
-    default:
-        break;
-    }
-}
+    if (new_alloc > SIZE_MAX / elem_size)
+        return false;
 
-static bool check_expand(struct cwc_vec *vec)
-{
-    if (++vec->count > vec->alloc) {
-        size_t alloc      = vec->alloc * 2;
-        void *reallocated = realloc(vec->data, alloc * vec->elem_sizeof);
-        if (!reallocated)
+    void *new_data;
+    if (*data == inline_data) {
+        new_data = malloc(new_alloc * elem_size);
+        if (!new_data)
+            return false;
+        memcpy(new_data, inline_data, count * elem_size);
+    } else {
+        new_data = realloc(*data, new_alloc * elem_size);
+        if (!new_data)
             return false;
-
-        vec->alloc = alloc;
-        vec->data  = reallocated;
     }
 
+    *data  = new_data;
+    *alloc = new_alloc;
     return true;
 }
 
-bool cwc_vec_push(struct cwc_vec *vec, void *data)
+#ifndef NDEBUG
+void __cwc_vec_bound_check(size_t idx, size_t count)
 {
-    if (!check_expand(vec))
-        return false;
+    if (idx < count)
+        return;
 
-    uint64_t a           = 0xffffffffffffffff >> (64 - vec->elem_sizeof * 8);
-    uint64_t packed_data = (uint64_t)data & a;
-    size_t idx           = vec->count - 1;
+    fprintf(stderr,
+            "index out of bounds: trying to access index %zu with vector "
+            "size %zu\n",
+            idx, count);
+    abort();
+}
+#endif
 
-    assign_idx(vec, idx, packed_data);
+/* compare 16 bytes of elements at once, the match mask has MASK_BITS bits per
+ * byte and every byte of a matching element is set.
+ */
+#if defined(__SSE2__)
+#define VEC_GROUP_MATCH
+#define MASK_BITS 1
+typedef __m128i group_t;
 
-    return true;
+static inline group_t group_splat(const void *value, size_t elem_size)
+{
+    int64_t v = 0;
+    memcpy(&v, value, elem_size);
+
+    switch (elem_size) {
+    case 1:
+        return _mm_set1_epi8(v);
+    case 2:
+        return _mm_set1_epi16(v);
+    case 4:
+        return _mm_set1_epi32(v);
+    default:
+        return _mm_set1_epi64x(v);
+    }
 }
 
-bool cwc_vec_push_at(struct cwc_vec *vec, size_t idx, void *data)
+static inline uint64_t
+group_match(const uint8_t *p, group_t needle, size_t elem_size)
 {
-    if (!check_expand(vec))
-        return false;
+    __m128i group = _mm_loadu_si128((const __m128i *)p);
+    __m128i eq;
 
-    char *cdata     = vec->data;
-    char *src       = cdata + (vec->elem_sizeof * idx);
-    char *dst       = src + (vec->elem_sizeof);
-    int byte_copied = vec->elem_sizeof * (vec->count - idx - 1);
-    memmove(dst, src, byte_copied);
-
-    uint64_t a           = 0xffffffffffffffff >> (64 - vec->elem_sizeof * 8);
-    uint64_t packed_data = (uint64_t)data & a;
+    switch (elem_size) {
+    case 1:
+        eq = _mm_cmpeq_epi8(group, needle);
+        break;
+    case 2:
+        eq = _mm_cmpeq_epi16(group, needle);
+        break;
+    case 4:
+        eq = _mm_cmpeq_epi32(group, needle);
+        break;
+    default:
+        // no 64-bit compare in SSE2, both 32-bit halves must match
+        eq = _mm_cmpeq_epi32(group, needle);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+        break;
+    }
 
-    assign_idx(vec, idx, packed_data);
+    return _mm_movemask_epi8(eq);
 }
+#elif defined(__ARM_NEON)
+#define VEC_GROUP_MATCH
+#define MASK_BITS 4
+typedef uint8x16_t group_t;
 
-static void check_shrink(struct cwc_vec *vec)
+static inline group_t group_splat(const void *value, size_t elem_size)
 {
-    if (((double)vec->count / vec->alloc) > 0.4)
-        return;
-
-    if (vec->count / 2 < 4)
-        return;
-
-    size_t alloc      = vec->alloc / 2;
-    void *reallocated = realloc(vec->data, alloc * vec->elem_sizeof);
-    if (!reallocated)
-        return;
-
-    vec->alloc = alloc;
-    vec->data  = reallocated;
+    uint64_t v = 0;
+    memcpy(&v, value, elem_size);
+
+    switch (elem_size) {
+    case 1:
+        return vdupq_n_u8(v);
+    case 2:
+        return vreinterpretq_u8_u16(vdupq_n_u16(v));
+    case 4:
+        return vreinterpretq_u8_u32(vdupq_n_u32(v));
+    default:
+        return vreinterpretq_u8_u64(vdupq_n_u64(v));
+    }
 }
 
-void cwc_vec_pop(struct cwc_vec *vec)
+static inline uint64_t
+group_match(const uint8_t *p, group_t needle, size_t elem_size)
 {
-    if (vec->count == 0)
-        return;
+    uint8x16_t group = vld1q_u8(p);
+    uint8x16_t eq;
 
-    --vec->count;
+    switch (elem_size) {
+    case 1:
+        eq = vceqq_u8(group, needle);
+        break;
+    case 2:
+        eq = vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(group),
+                                            vreinterpretq_u16_u8(needle)));
+        break;
+    case 4:
+        eq = vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(group),
+                                            vreinterpretq_u32_u8(needle)));
+        break;
+    default: {
+        // armv7 has no 64-bit compare, both 32-bit halves must match
+        uint32x4_t eq32 = vceqq_u32(vreinterpretq_u32_u8(group),
+                                    vreinterpretq_u32_u8(needle));
+        eq = vreinterpretq_u8_u32(vandq_u32(eq32, vrev64q_u32(eq32)));
+        break;
+    }
+    }
 
-    check_shrink(vec);
+    // narrow every byte to 4 bits so the mask fit in 64-bit
+    uint8x8_t nibble = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibble), 0);
 }
+#endif
 
-void cwc_vec_pop_at(struct cwc_vec *vec, size_t idx)
+/* always inlined so every elem_size get its own loop without the switch */
+static inline __attribute__((always_inline)) ptrdiff_t
+find_sized(const uint8_t *data, size_t count, size_t elem_size, void *value)
 {
-#ifndef NDEBUG
-    if (idx >= vec->count) {
-        fprintf(stderr,
-                "index out of bounds: trying to access index %ld with vector "
-                "size %ld\n",
-                idx, vec->count);
-        abort();
+    size_t i = 0;
+
+#ifdef VEC_GROUP_MATCH
+    size_t group_count = 16 / elem_size;
+    group_t needle     = group_splat(value, elem_size);
+    for (; i + group_count <= count; i += group_count) {
+        uint64_t mask = group_match(data + i * elem_size, needle, elem_size);
+        if (mask)
+            return i + __builtin_ctzll(mask) / (elem_size * MASK_BITS);
     }
 #endif
 
-    if (vec->count == 0)
-        return;
-
-    --vec->count;
-
-    char *cdata     = vec->data;
-    char *src       = cdata + (vec->elem_sizeof * (idx + 1));
-    char *dst       = src - (vec->elem_sizeof);
-    int byte_copied = vec->elem_sizeof * (vec->count - idx);
-    memmove(dst, src, byte_copied);
+    for (; i < count; i++) {
+        if (memcmp(data + i * elem_size, value, elem_size) == 0)
+            return i;
+    }
 
-    check_shrink(vec);
+    return -1;
 }
 
-static void *access_idx(struct cwc_vec *vec, size_t idx)
+ptrdiff_t
+__cwc_vec_find(const void *data, size_t count, size_t elem_size, void *value)
 {
-    switch (vec->elem_sizeof) {
-    case sizeof(int8_t):
-        return (void *)(intptr_t)(((int8_t *)(vec->data))[idx]);
-    case sizeof(int16_t):
-        return (void *)(intptr_t)(((int16_t *)(vec->data))[idx]);
-    case sizeof(int32_t):
-        return (void *)(intptr_t)(((int32_t *)(vec->data))[idx]);
-    case sizeof(int64_t):
-        return (void *)(intptr_t)(((int64_t *)(vec->data))[idx]);
+    switch (elem_size) {
+    case 1:
+        return find_sized(data, count, 1, value);
+    case 2:
+        return find_sized(data, count, 2, value);
+    case 4:
+        return find_sized(data, count, 4, value);
+    case 8:
+        return find_sized(data, count, 8, value);
     default:
-        return NULL;
-    }
-}
-
-void *cwc_vec_at(struct cwc_vec *vec, size_t idx)
-{
-#ifndef NDEBUG
-    if (idx >= vec->count) {
-        fprintf(stderr,
-                "index out of bounds: trying to access index %ld with vector "
-                "size %ld\n",
-                idx, vec->count);
-        abort();
+        break;
     }
-#endif
-
-    return access_idx(vec, idx);
-}
 
-int cwc_vec_find(struct cwc_vec *vec, void *value)
-{
-    for (size_t i = 0; i < vec->count; i++) {
-        switch (vec->elem_sizeof) {
-        case sizeof(int8_t):
-            if (((int8_t *)(vec->data))[i] == (int8_t)(intptr_t)value)
-                return i;
-            break;
-        case sizeof(int16_t):
-            if (((int16_t *)(vec->data))[i] == (int16_t)(intptr_t)value)
-                return i;
-            break;
-        case sizeof(int32_t):
-            if (((int32_t *)(vec->data))[i] == (int32_t)(intptr_t)value)
-                return i;
-            break;
-        case sizeof(int64_t):
-            if (((int64_t *)(vec->data))[i] == (int64_t)(intptr_t)value)
-                return i;
-            break;
-        default:
-            break;
-        }
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < count; i++) {
+        if (memcmp(bytes + i * elem_size, value, elem_size) == 0)
+            return i;
     }
 
     return -1;
@@ -0,0 +1,44 @@
+/* allocation counter preloaded into the compositor by cwc-bench, the bench
+ * config read it through the luajit ffi. Only glibc is supported since it
+ * forward to the __libc_* allocator.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static uint64_t alloc_count;
+static uint64_t alloc_bytes;
+
+static inline void count(size_t size)
+{
+    __atomic_add_fetch(&alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&alloc_bytes, size, __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    count(nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void cwc_bench_alloc_stats(uint64_t *count_out, uint64_t *bytes_out)
+{
+    *count_out = __atomic_load_n(&alloc_count, __ATOMIC_RELAXED);
+    *bytes_out = __atomic_load_n(&alloc_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,320 @@
+/* synthetic xdg-shell client for cwc-bench
+ *
+ * The buffer is never drawn into, a fresh memfd is zero filled which is
+ * already an opaque black XRGB8888 image and the compositor still has to
+ * upload and composite it.
+ */
+
+#define _GNU_SOURCE
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "client.h"
+#include "xdg-shell-client-protocol.h"
+
+#define DEFAULT_WIDTH     640
+#define DEFAULT_HEIGHT    480
+#define SETTLE_MAX_ROUND  16
+#define SETTLE_TIMEOUT_MS 5000
+
+struct bench_client {
+    int index;
+    struct wl_display *display;
+    struct wl_registry *registry;
+    struct wl_compositor *compositor;
+    struct wl_shm *shm;
+    struct xdg_wm_base *wm_base;
+
+    struct wl_surface *surface;
+    struct xdg_surface *xdg_surface;
+    struct xdg_toplevel *toplevel;
+
+    // size from the last toplevel configure, 0 means the client decide
+    int pending_width, pending_height;
+
+    struct wl_buffer *buffer;
+    int buffer_width, buffer_height;
+
+    struct wl_callback *sync;
+    bool committed; // since the start of the settle round
+    uint64_t configure_count;
+};
+
+static struct wl_buffer *
+create_buffer(struct wl_shm *shm, int width, int height)
+{
+    int stride = width * 4;
+    int size   = stride * height;
+
+    int fd = memfd_create("cwc-bench", MFD_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
+    struct wl_buffer *buffer = wl_shm_pool_create_buffer(
+        pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    close(fd);
+
+    return buffer;
+}
+
+static void
+wm_base_ping(void *data, struct xdg_wm_base *wm_base, uint32_t serial)
+{
+    xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+    .ping = wm_base_ping,
+};
+
+static void xdg_surface_configure(void *data,
+                                  struct xdg_surface *xdg_surface,
+                                  uint32_t serial)
+{
+    struct bench_client *client = data;
+
+    xdg_surface_ack_configure(xdg_surface, serial);
+    client->configure_count++;
+
+    int width  = client->pending_width ? client->pending_width : DEFAULT_WIDTH;
+    int height =
+        client->pending_height ? client->pending_height : DEFAULT_HEIGHT;
+
+    if (!client->buffer || width != client->buffer_width
+        || height != client->buffer_height) {
+        struct wl_buffer *buffer = create_buffer(client->shm, width, height);
+        if (buffer) {
+            // the old one is no longer used once the new one is committed
+            if (client->buffer)
+                wl_buffer_destroy(client->buffer);
+            client->buffer        = buffer;
+            client->buffer_width  = width;
+            client->buffer_height = height;
+        }
+
+        wl_surface_attach(client->surface, client->buffer, 0, 0);
+        wl_surface_damage_buffer(client->surface, 0, 0, width, height);
+    }
+
+    wl_surface_commit(client->surface);
+    client->committed = true;
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+    .configure = xdg_surface_configure,
+};
+
+static void toplevel_configure(void *data,
+                               struct xdg_toplevel *toplevel,
+                               int32_t width,
+                               int32_t height,
+                               struct wl_array *states)
+{
+    struct bench_client *client = data;
+    client->pending_width       = width;
+    client->pending_height      = height;
+}
+
+static void toplevel_close(void *data, struct xdg_toplevel *toplevel) {}
+
+static const struct xdg_toplevel_listener toplevel_listener = {
+    .configure = toplevel_configure,
+    .close     = toplevel_close,
+};
+
+static void registry_global(void *data,
+                            struct wl_registry *registry,
+                            uint32_t name,
+                            const char *interface,
+                            uint32_t version)
+{
+    struct bench_client *client = data;
+
+    if (strcmp(interface, wl_compositor_interface.name) == 0) {
+        client->compositor =
+            wl_registry_bind(registry, name, &wl_compositor_interface, 4);
+    } else if (strcmp(interface, wl_shm_interface.name) == 0) {
+        client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+    } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+        client->wm_base =
+            wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+        xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, client);
+    }
+}
+
+static void
+registry_global_remove(void *data, struct wl_registry *registry, uint32_t name)
+{
+}
+
+static const struct wl_registry_listener registry_listener = {
+    .global        = registry_global,
+    .global_remove = registry_global_remove,
+};
+
+struct bench_client *bench_client_create(const char *display_name, int index)
+{
+    struct bench_client *client = calloc(1, sizeof(*client));
+    if (!client)
+        return NULL;
+
+    client->index   = index;
+    client->display = wl_display_connect(display_name);
+    if (!client->display) {
+        free(client);
+        return NULL;
+    }
+
+    client->registry = wl_display_get_registry(client->display);
+    wl_registry_add_listener(client->registry, &registry_listener, client);
+    wl_display_roundtrip(client->display);
+
+    if (!client->compositor || !client->shm || !client->wm_base) {
+        fprintf(stderr, "client %d: missing required global\n", index);
+        bench_client_destroy(client);
+        return NULL;
+    }
+
+    client->surface = wl_compositor_create_surface(client->compositor);
+    client->xdg_surface =
+        xdg_wm_base_get_xdg_surface(client->wm_base, client->surface);
+    xdg_surface_add_listener(client->xdg_surface, &xdg_surface_listener,
+                             client);
+
+    client->toplevel = xdg_surface_get_toplevel(client->xdg_surface);
+    xdg_toplevel_add_listener(client->toplevel, &toplevel_listener, client);
+
+    char title[32];
+    snprintf(title, sizeof(title), "cwc-bench %d", index);
+    xdg_toplevel_set_title(client->toplevel, title);
+    xdg_toplevel_set_app_id(client->toplevel, "cwc-bench");
+
+    wl_surface_commit(client->surface);
+    wl_display_flush(client->display);
+
+    return client;
+}
+
+void bench_client_destroy(struct bench_client *client)
+{
+    if (client->sync)
+        wl_callback_destroy(client->sync);
+    if (client->toplevel)
+        xdg_toplevel_destroy(client->toplevel);
+    if (client->xdg_surface)
+        xdg_surface_destroy(client->xdg_surface);
+    if (client->surface)
+        wl_surface_destroy(client->surface);
+    if (client->buffer)
+        wl_buffer_destroy(client->buffer);
+    if (client->wm_base)
+        xdg_wm_base_destroy(client->wm_base);
+    if (client->shm)
+        wl_shm_destroy(client->shm);
+    if (client->compositor)
+        wl_compositor_destroy(client->compositor);
+
+    wl_registry_destroy(client->registry);
+    wl_display_disconnect(client->display);
+    free(client);
+}
+
+uint64_t bench_client_configure_count(struct bench_client *client)
+{
+    return client->configure_count;
+}
+
+static void sync_done(void *data, struct wl_callback *callback, uint32_t time)
+{
+    struct bench_client *client = data;
+
+    wl_callback_destroy(callback);
+    client->sync = NULL;
+}
+
+static const struct wl_callback_listener sync_listener = {
+    .done = sync_done,
+};
+
+/* poll every connection once, return false on timeout or error */
+static bool dispatch_clients(struct bench_client **clients,
+                             int count,
+                             struct pollfd *fds)
+{
+    for (int i = 0; i < count; i++) {
+        struct wl_display *display = clients[i]->display;
+        while (wl_display_prepare_read(display) != 0)
+            wl_display_dispatch_pending(display);
+
+        wl_display_flush(display);
+        fds[i] = (struct pollfd){
+            .fd     = wl_display_get_fd(display),
+            .events = POLLIN,
+        };
+    }
+
+    int ready = poll(fds, count, SETTLE_TIMEOUT_MS);
+
+    bool ok = ready > 0;
+    for (int i = 0; i < count; i++) {
+        struct wl_display *display = clients[i]->display;
+        if (ready > 0 && (fds[i].revents & POLLIN))
+            wl_display_read_events(display);
+        else
+            wl_display_cancel_read(display);
+
+        if (wl_display_dispatch_pending(display) < 0
+            || wl_display_get_error(display))
+            ok = false;
+    }
+
+    return ok;
+}
+
+bool bench_clients_settle(struct bench_client **clients, int count)
+{
+    struct pollfd *fds = calloc(count, sizeof(*fds));
+    if (!fds)
+        return false;
+
+    bool ok = true;
+    for (int round = 0; ok && round < SETTLE_MAX_ROUND; round++) {
+        for (int i = 0; i < count; i++) {
+            clients[i]->committed = false;
+            clients[i]->sync      = wl_display_sync(clients[i]->display);
+            wl_callback_add_listener(clients[i]->sync, &sync_listener,
+                                     clients[i]);
+        }
+
+        int pending = count;
+        while (ok && pending) {
+            ok      = dispatch_clients(clients, count, fds);
+            pending = 0;
+            for (int i = 0; i < count; i++)
+                pending += clients[i]->sync != NULL;
+        }
+
+        bool committed = false;
+        for (int i = 0; i < count; i++)
+            committed |= clients[i]->committed;
+
+        if (!committed)
+            break;
+    }
+
+    free(fds);
+    return ok;
+}
@@ -0,0 +1,27 @@
+#ifndef _CWC_BENCH_CLIENT_H
+#define _CWC_BENCH_CLIENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* synthetic xdg-shell client, each one has its own wayland connection. It ack
+ * every configure and commit a SHM buffer of the configured size.
+ */
+struct bench_client;
+
+/* connect to the display and commit the initial toplevel without a buffer,
+ * return NULL on failure.
+ */
+struct bench_client *bench_client_create(const char *display_name, int index);
+void bench_client_destroy(struct bench_client *client);
+
+/* dispatch every client until each of them received its sync done, then
+ * repeat while a round made any client commit so the configure caused by the
+ * commit is also handled. Return false on timeout or connection error.
+ */
+bool bench_clients_settle(struct bench_client **clients, int count);
+
+/* total configure handled by the client */
+uint64_t bench_client_configure_count(struct bench_client *client);
+
+#endif // !_CWC_BENCH_CLIENT_H
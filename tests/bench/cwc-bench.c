@@ -0,0 +1,608 @@
+/* cwc-bench - end to end compositor benchmark on the headless backend
+ *
+ * usage: cwc-bench [options] [scenario...]
+ *
+ * The harness start cwc with tests/bench/rc.lua on the headless backend and
+ * the pixman renderer in a private XDG_RUNTIME_DIR, connect the synthetic
+ * clients, then run every scenario step by calling `bench.step` over ipc. A
+ * step latency is from sending the ipc eval until every client acked its
+ * configures and the compositor processed the resulting commits.
+ *
+ * The result is printed as JSON with the latency percentiles, the compositor
+ * and client CPU time, and the compositor allocations (when the counter
+ * module is preloaded) and lua heap growth of each scenario.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/harness.h"
+#include "client.h"
+#include "cwc/ipc.h"
+
+#ifndef CWC_BENCH_CWC
+#define CWC_BENCH_CWC "cwc"
+#endif
+#ifndef CWC_BENCH_RC
+#define CWC_BENCH_RC "tests/bench/rc.lua"
+#endif
+#ifndef CWC_BENCH_LIB
+#define CWC_BENCH_LIB "lib"
+#endif
+#ifndef CWC_BENCH_ALLOC
+#define CWC_BENCH_ALLOC ""
+#endif
+
+#define STARTUP_TIMEOUT_SEC 10
+
+static char *help_txt =
+    "Usage:\n"
+    "  cwc-bench [options] [scenario...]\n"
+    "\n"
+    "Options:\n"
+    "  -h, --help       show this message\n"
+    "  -n, --clients    synthetic client count (default 16)\n"
+    "  -s, --steps      step count of each scenario (default 500)\n"
+    "  -o, --output     write the JSON result to the file instead of stdout\n"
+    "  -b, --binary     cwc executable\n"
+    "  -c, --config     bench lua configuration\n"
+    "  -l, --library    cwc lua library directory\n"
+    "  -a, --alloc      allocation counter module, empty to disable\n"
+    "  -d, --debug      show the compositor log\n"
+    "\n"
+    "Scenarios:\n"
+    "  tag_switch, bsp_retile, master_retile, interactive_resize,\n"
+    "  pointer_motion, keybind_storm (default all)";
+
+#define ARG    1
+#define NO_ARG 0
+static struct option long_options[] = {
+    {"help",    NO_ARG, NULL, 'h'},
+    {"clients", ARG,    NULL, 'n'},
+    {"steps",   ARG,    NULL, 's'},
+    {"output",  ARG,    NULL, 'o'},
+    {"binary",  ARG,    NULL, 'b'},
+    {"config",  ARG,    NULL, 'c'},
+    {"library", ARG,    NULL, 'l'},
+    {"alloc",   ARG,    NULL, 'a'},
+    {"debug",   NO_ARG, NULL, 'd'},
+    {NULL,      0,      NULL, 0  },
+};
+
+struct scenario {
+    const char *name;
+    /* minimum interval between step start, 0 to run back to back */
+    int pace_us;
+};
+
+static const struct scenario scenarios[] = {
+    {"tag_switch",         0   },
+    {"bsp_retile",         0   },
+    {"master_retile",      0   },
+    {"interactive_resize", 0   },
+    {"pointer_motion",     1000},
+    {"keybind_storm",      0   },
+};
+
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+struct scenario_result {
+    const struct scenario *scenario;
+    int steps;
+    uint64_t *latency_ns;
+    double compositor_cpu_ms;
+    double client_cpu_ms;
+    int64_t alloc_count; // -1 if unknown
+    int64_t alloc_bytes;
+    double lua_kb;
+    uint64_t configures; // handled by the clients
+    char *warning;
+};
+
+static struct {
+    int client_count;
+    int steps;
+    const char *output;
+    const char *alloc;
+
+    struct harness_compositor cwc;
+    int ipc_fd;
+    char *msg;
+
+    struct bench_client **clients;
+} B = {
+    .client_count = 16,
+    .steps        = 500,
+    .alloc        = CWC_BENCH_ALLOC,
+    .cwc =
+        {
+            .binary  = CWC_BENCH_CWC,
+            .config  = CWC_BENCH_RC,
+            .library = CWC_BENCH_LIB,
+        },
+    .ipc_fd       = -1,
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_until_ns(uint64_t deadline)
+{
+    struct timespec ts = {
+        .tv_sec  = deadline / 1000000000,
+        .tv_nsec = deadline % 1000000000,
+    };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+//==================== COMPOSITOR ====================
+
+static bool compositor_spawn()
+{
+    char clients[16];
+    snprintf(clients, sizeof(clients), "%d", B.client_count);
+    setenv("CWC_BENCH_CLIENTS", clients, true);
+
+    // only the compositor get the counter, LD_PRELOAD is read at exec
+    bool preload = B.alloc[0] && access(B.alloc, R_OK) == 0;
+    if (preload)
+        setenv("LD_PRELOAD", B.alloc, true);
+    else if (B.alloc[0])
+        fprintf(stderr, "allocation counter %s not found\n", B.alloc);
+
+    bool spawned = harness_compositor_spawn(&B.cwc);
+    if (preload)
+        unsetenv("LD_PRELOAD");
+
+    return spawned;
+}
+
+/* CPU time of the compositor in ms, schedstat has ns resolution while stat
+ * only has clock ticks.
+ */
+static double compositor_cpu_ms()
+{
+    char path[64];
+    unsigned long long ns;
+
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", B.cwc.pid);
+    FILE *f = fopen(path, "r");
+    if (f) {
+        int n = fscanf(f, "%llu", &ns);
+        fclose(f);
+        if (n == 1)
+            return ns / 1e6;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", B.cwc.pid);
+    if (!(f = fopen(path, "r")))
+        return 0;
+
+    unsigned long utime = 0, stime = 0;
+    int n = fscanf(f, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u "
+                      "%*u %lu %lu",
+                   &utime, &stime);
+    fclose(f);
+
+    return n == 2 ? (utime + stime) * 1e3 / sysconf(_SC_CLK_TCK) : 0;
+}
+
+static double self_cpu_ms()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+           + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+//======================= IPC ========================
+
+/* evaluate the lua chunk, return the tostring of the first returned value or
+ * NULL if the connection is broken. The result is valid until the next call.
+ */
+static const char *ipc_eval(const char *fmt, ...)
+{
+    char chunk[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(chunk, sizeof(chunk), fmt, args);
+    va_end(args);
+
+    int msg_size = ipc_create_message(B.msg, IPC_MAX_MESSAGE, IPC_EVAL, chunk);
+    if (msg_size < 0 || !harness_send_all(B.ipc_fd, B.msg, msg_size))
+        return NULL;
+
+    enum cwc_ipc_opcode opcode;
+    uint32_t body_len;
+    do {
+        if (!harness_recv_all(B.ipc_fd, B.msg, HEADER_SIZE, -1)
+            || !check_header(B.msg))
+            return NULL;
+
+        ipc_get_body(B.msg, &opcode);
+        body_len = ipc_get_body_length(B.msg);
+        if (body_len > IPC_MAX_BODY
+            || !harness_recv_all(B.ipc_fd, B.msg + HEADER_SIZE, body_len,
+                                 -1))
+            return NULL;
+    } while (opcode != IPC_EVAL_RESPONSE);
+
+    B.msg[HEADER_SIZE + body_len] = '\0';
+    return B.msg + HEADER_SIZE;
+}
+
+//===================== CLIENTS ======================
+
+static bool clients_connect()
+{
+    const char *display = ipc_eval("return os.getenv('WAYLAND_DISPLAY')");
+    if (!display || strcmp(display, "nil") == 0)
+        return false;
+
+    char *display_name = strdup(display);
+    B.clients          = calloc(B.client_count, sizeof(*B.clients));
+
+    for (int i = 0; i < B.client_count; i++) {
+        if (!(B.clients[i] = bench_client_create(display_name, i))) {
+            free(display_name);
+            return false;
+        }
+    }
+
+    free(display_name);
+
+    // wait for the map, the compositor may need a few round
+    uint64_t deadline = now_ns() + STARTUP_TIMEOUT_SEC * 1000000000ULL;
+    while (now_ns() < deadline) {
+        if (!bench_clients_settle(B.clients, B.client_count))
+            return false;
+
+        const char *mapped = ipc_eval("return bench.mapped()");
+        if (!mapped)
+            return false;
+
+        if (atoi(mapped) >= B.client_count)
+            return true;
+
+        usleep(1000);
+    }
+
+    return false;
+}
+
+//==================== SCENARIOS =====================
+
+static uint64_t clients_configure_count()
+{
+    uint64_t total = 0;
+    for (int i = 0; i < B.client_count; i++)
+        total += bench_client_configure_count(B.clients[i]);
+
+    return total;
+}
+
+static bool read_stats(int64_t *count, int64_t *bytes, double *lua_kb)
+{
+    const char *stats = ipc_eval("return bench.stats()");
+    long long c, b;
+    if (!stats || sscanf(stats, "%lld %lld %lf", &c, &b, lua_kb) != 3)
+        return false;
+
+    *count = c;
+    *bytes = b;
+    return true;
+}
+
+static bool run_scenario(const struct scenario *s, struct scenario_result *r)
+{
+    r->scenario   = s;
+    r->steps      = B.steps;
+    r->latency_ns = calloc(B.steps, sizeof(*r->latency_ns));
+
+    const char *ret = ipc_eval("return bench.setup('%s')", s->name);
+    if (!ret || strcmp(ret, "true") != 0) {
+        fprintf(stderr, "%s: setup failed (%s)\n", s->name,
+                ret ? ret : "connection closed");
+        return false;
+    }
+
+    if (!bench_clients_settle(B.clients, B.client_count))
+        return false;
+
+    int64_t count0, bytes0;
+    double lua_kb0;
+    if (!read_stats(&count0, &bytes0, &lua_kb0))
+        return false;
+
+    double compositor_cpu0 = compositor_cpu_ms();
+    double client_cpu0     = self_cpu_ms();
+    uint64_t configures0   = clients_configure_count();
+
+    // same chunk every step so the ipc eval cache keep it compiled
+    char step_chunk[128];
+    snprintf(step_chunk, sizeof(step_chunk), "return bench.step('%s')",
+             s->name);
+
+    uint64_t next_start = now_ns();
+    for (int i = 0; i < B.steps; i++) {
+        if (s->pace_us) {
+            sleep_until_ns(next_start);
+            next_start += s->pace_us * 1000ULL;
+        }
+
+        uint64_t start = now_ns();
+        if (!ipc_eval("%s", step_chunk)
+            || !bench_clients_settle(B.clients, B.client_count)) {
+            fprintf(stderr, "%s: step %d failed\n", s->name, i);
+            return false;
+        }
+        r->latency_ns[i] = now_ns() - start;
+    }
+
+    r->compositor_cpu_ms = compositor_cpu_ms() - compositor_cpu0;
+    r->client_cpu_ms     = self_cpu_ms() - client_cpu0;
+    r->configures        = clients_configure_count() - configures0;
+
+    int64_t count1, bytes1;
+    double lua_kb1;
+    if (!read_stats(&count1, &bytes1, &lua_kb1))
+        return false;
+
+    r->alloc_count = count0 < 0 ? -1 : count1 - count0;
+    r->alloc_bytes = bytes0 < 0 ? -1 : bytes1 - bytes0;
+    r->lua_kb      = lua_kb1 - lua_kb0;
+
+    ret = ipc_eval("return bench.teardown('%s')", s->name);
+    if (!ret)
+        return false;
+    if (strcmp(ret, "nil") != 0)
+        r->warning = strdup(ret);
+
+    return bench_clients_settle(B.clients, B.client_count);
+}
+
+//====================== OUTPUT ======================
+
+static void print_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            fprintf(out, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(out, "\\u%04x", *s);
+        else
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void print_result(FILE *out, struct scenario_result *r)
+{
+    uint64_t *lat = r->latency_ns;
+    int n         = r->steps;
+    qsort(lat, n, sizeof(*lat), cmp_u64);
+
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += lat[i];
+
+    fprintf(out, "    {\n      \"name\": \"%s\",\n", r->scenario->name);
+    fprintf(out, "      \"steps\": %d,\n", n);
+    fprintf(out, "      \"pace_us\": %d,\n", r->scenario->pace_us);
+    fprintf(out,
+            "      \"latency_us\": {\"mean\": %.1f, \"p50\": %.1f, "
+            "\"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f},\n",
+            total / (double)n / 1e3, lat[n / 2] / 1e3, lat[n * 90 / 100] / 1e3,
+            lat[n * 99 / 100] / 1e3, lat[n - 1] / 1e3);
+    fprintf(out,
+            "      \"cpu_ms\": {\"compositor\": %.2f, \"clients\": %.2f},\n",
+            r->compositor_cpu_ms, r->client_cpu_ms);
+
+    if (r->alloc_count < 0)
+        fprintf(out, "      \"allocations\": null,\n");
+    else
+        fprintf(out,
+                "      \"allocations\": {\"count\": %lld, \"bytes\": %lld, "
+                "\"per_step\": %.1f},\n",
+                (long long)r->alloc_count, (long long)r->alloc_bytes,
+                r->alloc_count / (double)n);
+
+    fprintf(out, "      \"lua_heap_kb\": %.1f,\n", r->lua_kb);
+    fprintf(out, "      \"configures\": %llu,\n",
+            (unsigned long long)r->configures);
+    fprintf(out, "      \"warning\": ");
+    if (r->warning)
+        print_json_string(out, r->warning);
+    else
+        fprintf(out, "null");
+    fprintf(out, "\n    }");
+}
+
+static void print_report(FILE *out, struct scenario_result *results, int count)
+{
+    const char *version = ipc_eval("return cwc.get_version()");
+
+    fprintf(out, "{\n  \"cwc\": ");
+    print_json_string(out, version ? version : "unknown");
+    fprintf(out, ",\n  \"clients\": %d,\n  \"scenarios\": [\n",
+            B.client_count);
+
+    for (int i = 0; i < count; i++) {
+        print_result(out, &results[i]);
+        fprintf(out, i + 1 < count ? ",\n" : "\n");
+    }
+
+    fprintf(out, "  ]\n}\n");
+}
+
+//====================== SETUP =======================
+
+static void cleanup()
+{
+    if (B.clients) {
+        for (int i = 0; i < B.client_count; i++)
+            if (B.clients[i])
+                bench_client_destroy(B.clients[i]);
+        free(B.clients);
+    }
+
+    if (B.ipc_fd >= 0) {
+        ipc_eval("cwc.quit()");
+        close(B.ipc_fd);
+    }
+
+    harness_compositor_stop(&B.cwc);
+
+    free(B.msg);
+}
+
+static const struct scenario *find_scenario(const char *name)
+{
+    for (size_t i = 0; i < SCENARIO_COUNT; i++)
+        if (strcmp(scenarios[i].name, name) == 0)
+            return &scenarios[i];
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int c;
+    while ((c = getopt_long(argc, argv, "hn:s:o:b:c:l:a:d", long_options,
+                            NULL))
+           != -1)
+        switch (c) {
+        case 'n':
+            B.client_count = atoi(optarg);
+            break;
+        case 's':
+            B.steps = atoi(optarg);
+            break;
+        case 'o':
+            B.output = optarg;
+            break;
+        case 'b':
+            B.cwc.binary = optarg;
+            break;
+        case 'c':
+            B.cwc.config = optarg;
+            break;
+        case 'l':
+            B.cwc.library = optarg;
+            break;
+        case 'a':
+            B.alloc = optarg;
+            break;
+        case 'd':
+            B.cwc.debug = true;
+            break;
+        case 'h':
+            puts(help_txt);
+            return 0;
+        default:
+            puts(help_txt);
+            return 1;
+        }
+
+    if (B.client_count < 1 || B.steps < 1) {
+        fprintf(stderr, "client and step count must be positive\n");
+        return 1;
+    }
+
+    // validate the scenario names before starting anything
+    const struct scenario *selected[SCENARIO_COUNT];
+    int selected_count = 0;
+    if (optind >= argc) {
+        for (size_t i = 0; i < SCENARIO_COUNT; i++)
+            selected[selected_count++] = &scenarios[i];
+    }
+    for (int i = optind; i < argc; i++) {
+        const struct scenario *s = find_scenario(argv[i]);
+        if (!s) {
+            fprintf(stderr, "unknown scenario %s\n", argv[i]);
+            return 1;
+        }
+        if (selected_count < (int)SCENARIO_COUNT)
+            selected[selected_count++] = s;
+    }
+
+    if (!harness_runtime_dir_create(&B.cwc, "/tmp/cwc-bench-XXXXXX")) {
+        perror("can't create runtime directory");
+        return 1;
+    }
+
+    B.msg = malloc(IPC_MAX_MESSAGE + 1);
+    signal(SIGPIPE, SIG_IGN);
+
+    int exit_code = 1;
+    struct scenario_result *results = calloc(selected_count, sizeof(*results));
+    int done                        = 0;
+
+    if (!B.msg || !results || !compositor_spawn())
+        goto cleanup;
+
+    B.ipc_fd = harness_ipc_connect(&B.cwc, STARTUP_TIMEOUT_SEC * 1000);
+    if (B.ipc_fd < 0) {
+        fprintf(stderr, "can't connect to the compositor ipc\n");
+        goto cleanup;
+    }
+
+    if (!clients_connect()) {
+        fprintf(stderr, "synthetic clients failed to map\n");
+        goto cleanup;
+    }
+
+    for (; done < selected_count; done++) {
+        fprintf(stderr, "running %s\n", selected[done]->name);
+        if (!run_scenario(selected[done], &results[done]))
+            goto cleanup;
+    }
+
+    FILE *out = B.output ? fopen(B.output, "w") : stdout;
+    if (!out) {
+        perror("can't open the output");
+        goto cleanup;
+    }
+
+    print_report(out, results, done);
+    if (out != stdout)
+        fclose(out);
+
+    exit_code = 0;
+
+cleanup:
+    cleanup();
+
+    for (int i = 0; results && i < selected_count; i++) {
+        free(results[i].latency_ns);
+        free(results[i].warning);
+    }
+    free(results);
+
+    return exit_code;
+}
@@ -0,0 +1,51 @@
+-- property access microbenchmark, compares the precomputed getter table
+-- dispatch with the old `"get_" .. k` lookup emulated in lua.
+
+local cwc = cwc
+
+local ITERATION = 1e6
+
+local function legacy_index(obj, k)
+    local index = getmetatable(obj).__cwcindex
+    local getter = index["get_" .. k]
+    if type(getter) == "function" then return getter(obj) end
+
+    return index[k]
+end
+
+local function measure(name, fn)
+    local start = os.clock()
+    fn()
+    local elapsed = os.clock() - start
+
+    print(string.format("%-32s %12.0f access/s", name, ITERATION / elapsed))
+end
+
+local function bench_object(label, obj, prop)
+    measure(string.format("%s.%s", label, prop), function()
+        for _ = 1, ITERATION do
+            local _ = obj[prop]
+        end
+    end)
+
+    measure(string.format("%s.%s (get_ concat)", label, prop), function()
+        for _ = 1, ITERATION do
+            local _ = legacy_index(obj, prop)
+        end
+    end)
+end
+
+return function()
+    print("\n------------------------------ PROPERTY BENCHMARK ------------------------------")
+    local s = cwc.screen.focused()
+    bench_object("screen", s, "name")
+    bench_object("screen", s, "workarea")
+
+    local c = cwc.client.get()[1]
+    if c then
+        bench_object("client", c, "title")
+        bench_object("client", c, "fullscreen")
+    else
+        print("no client available, skipping client property benchmark")
+    end
+end
@@ -0,0 +1,249 @@
+-- compositor side of cwc-bench, the harness start cwc with this config on the
+-- headless backend then call the `bench` table over ipc. Every scenario step
+-- only does the action, the harness measure until the synthetic clients
+-- settled.
+
+local cful = require("cuteful")
+local enum = require("cuteful.enum")
+
+local cwc = cwc
+
+local CLIENTS = tonumber(os.getenv("CWC_BENCH_CLIENTS")) or 16
+local TAGS = 4
+
+local mod = enum.modifier
+local key_state = enum.key_state
+local event_code = cful.kbd.event_code
+
+cwc.create_output(1)
+
+-- spread the clients round robin over the first tags so a tag switch always
+-- show and hide some clients
+local mapped = 0
+cwc.connect_signal("client::map", function(c)
+    mapped = mapped + 1
+    c:move_to_tag((mapped - 1) % TAGS + 1)
+end)
+
+cwc.connect_signal("client::unmap", function()
+    mapped = mapped - 1
+end)
+
+local function screen()
+    return cwc.screen.focused()
+end
+
+local function pointer()
+    return cwc.pointer.get()[1]
+end
+
+local function visible_clients()
+    return screen():get_clients(true)
+end
+
+local function view_tag(idx, layout_mode)
+    local tag = screen():get_tag(idx)
+    if layout_mode then tag.layout_mode = layout_mode end
+    tag:view_only()
+    return tag
+end
+
+------------------------------- KEYBIND STORM -------------------------------
+
+local storm_mods = {
+    { mods = { mod.LOGO },           keys = { "KEY_LEFTMETA" } },
+    { mods = { mod.LOGO, mod.SHIFT }, keys = { "KEY_LEFTMETA", "KEY_LEFTSHIFT" } },
+    { mods = { mod.CTRL, mod.ALT },  keys = { "KEY_LEFTCTRL", "KEY_LEFTALT" } },
+    { mods = { mod.LOGO, mod.CTRL }, keys = { "KEY_LEFTMETA", "KEY_LEFTCTRL" } },
+}
+
+local storm_keys = {}
+for byte = string.byte("a"), string.byte("z") do
+    table.insert(storm_keys, string.char(byte))
+end
+for digit = 0, 9 do
+    table.insert(storm_keys, tostring(digit))
+end
+
+local storm_combo = {}
+local storm_fired = 0
+
+local function storm_bind()
+    for _, m in ipairs(storm_mods) do
+        for _, key in ipairs(storm_keys) do
+            cwc.kbd.bind(m.mods, key, function()
+                storm_fired = storm_fired + 1
+            end, { description = "cwc-bench " .. key, group = "cwc-bench" })
+
+            table.insert(storm_combo, {
+                mods = m.keys,
+                key = event_code["KEY_" .. key:upper()],
+            })
+        end
+    end
+end
+
+local function storm_send(combo)
+    local kbd = cwc.kbd.get()[1]
+
+    for _, name in ipairs(combo.mods) do
+        kbd:send_key(event_code[name], key_state.PRESSED)
+    end
+
+    kbd:send_key(combo.key, key_state.PRESSED)
+    kbd:send_key(combo.key, key_state.RELEASED)
+
+    for i = #combo.mods, 1, -1 do
+        kbd:send_key(event_code[combo.mods[i]], key_state.RELEASED)
+    end
+end
+
+--------------------------------- SCENARIOS ---------------------------------
+
+local scenarios = {}
+
+scenarios.tag_switch = {
+    setup = function() view_tag(1, enum.layout_mode.MASTER) end,
+    step = function(i) screen():get_tag(i % TAGS + 1):view_only() end,
+}
+
+scenarios.bsp_retile = {
+    setup = function() view_tag(1, enum.layout_mode.BSP) end,
+    step = function(i)
+        local clients = visible_clients()
+        if #clients < 2 then return end
+
+        local c = clients[i % #clients + 1]
+        if i % 2 == 0 then
+            c:toggle_split()
+        else
+            c:swap(clients[(i + 1) % #clients + 1])
+        end
+    end,
+}
+
+scenarios.master_retile = {
+    setup = function() view_tag(1, enum.layout_mode.MASTER) end,
+    step = function(i)
+        local tag = screen():get_tag(1)
+        if i % 2 == 0 then
+            tag.mwfact = 0.3 + (i % 9) * 0.05
+        else
+            tag.master_count = i % 3 + 1
+        end
+    end,
+    teardown = function()
+        local tag = screen():get_tag(1)
+        tag.mwfact = 0.5
+        tag.master_count = 1
+    end,
+}
+
+local resize_client
+scenarios.interactive_resize = {
+    setup = function()
+        view_tag(1, enum.layout_mode.MASTER)
+        resize_client = visible_clients()[1]
+        if not resize_client then return end
+
+        resize_client.floating = true
+        resize_client.geometry = { x = 200, y = 200, width = 800, height = 600 }
+        resize_client:raise()
+
+        -- near the bottom right corner
+        pointer():move_to(990, 790)
+        cwc.pointer.resize_interactive()
+    end,
+    step = function(i)
+        -- grow for 50 steps then shrink back
+        local d = (math.floor(i / 50) % 2 == 0) and 4 or -4
+        pointer():move(d, d)
+    end,
+    teardown = function()
+        cwc.pointer.stop_interactive()
+        if resize_client then resize_client.floating = false end
+        resize_client = nil
+    end,
+}
+
+scenarios.pointer_motion = {
+    setup = function()
+        view_tag(1, enum.layout_mode.MASTER)
+        pointer():move_to(0, 0)
+    end,
+    step = function(i)
+        -- lissajous path over the whole output so it cross every client
+        local t = i / 100
+        pointer():move_to(960 + 900 * math.sin(3 * t), 540 + 500 * math.sin(2 * t))
+    end,
+}
+
+scenarios.keybind_storm = {
+    setup = function()
+        if #storm_combo == 0 then storm_bind() end
+        storm_fired = 0
+    end,
+    step = function(i)
+        storm_send(storm_combo[(i * 7) % #storm_combo + 1])
+    end,
+    teardown = function(steps)
+        if storm_fired ~= steps then
+            return string.format("%d of %d keybind fired", storm_fired, steps)
+        end
+    end,
+}
+
+------------------------------------ API ------------------------------------
+
+local step_count = 0
+local ffi_ok, ffi = pcall(require, "ffi")
+local alloc_stats
+
+if ffi_ok then
+    ffi.cdef [[ void cwc_bench_alloc_stats(uint64_t *count, uint64_t *bytes); ]]
+    local ok, fn = pcall(function() return ffi.C.cwc_bench_alloc_stats end)
+    if ok then alloc_stats = fn end
+end
+
+bench = {}
+
+--- mapped synthetic client count
+function bench.mapped()
+    return mapped
+end
+
+--- return "count bytes lua_kb", count and bytes are -1 when the allocation
+-- counter is not preloaded
+function bench.stats()
+    local count, bytes = -1, -1
+    if alloc_stats then
+        local buf = ffi.new("uint64_t[2]")
+        alloc_stats(buf, buf + 1)
+        count, bytes = tonumber(buf[0]), tonumber(buf[1])
+    end
+
+    return string.format("%.0f %.0f %.1f", count, bytes, collectgarbage("count"))
+end
+
+--- return false if the scenario doesn't exist
+function bench.setup(name)
+    local s = scenarios[name]
+    if not s then return false end
+
+    step_count = 0
+    if s.setup then s.setup() end
+    return true
+end
+
+function bench.step(name)
+    scenarios[name].step(step_count)
+    step_count = step_count + 1
+end
+
+--- return a message when the scenario didn't behave as expected
+function bench.teardown(name)
+    local s = scenarios[name]
+    if s.teardown then return s.teardown(step_count) end
+end
+
+print(string.format("cwc-bench config loaded, waiting for %d clients", CLIENTS))
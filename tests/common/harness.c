@@ -0,0 +1,189 @@
+/* shared helpers for the tests that run a real compositor */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "harness.h"
+
+extern char **environ;
+
+/* the compositor to stop when a check fail */
+static struct harness_compositor *active;
+
+void harness_check_fail(const char *file, int line, const char *expr)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+
+    if (active)
+        harness_compositor_stop(active);
+
+    exit(1);
+}
+
+bool harness_runtime_dir_create(struct harness_compositor *hc,
+                                const char *template)
+{
+    if (strlen(template) >= sizeof(hc->runtime_dir))
+        return false;
+
+    strcpy(hc->runtime_dir, template);
+    if (!mkdtemp(hc->runtime_dir)) {
+        hc->runtime_dir[0] = '\0';
+        return false;
+    }
+
+    return true;
+}
+
+bool harness_compositor_spawn(struct harness_compositor *hc)
+{
+    setenv("XDG_RUNTIME_DIR", hc->runtime_dir, true);
+    setenv("WLR_BACKENDS", "headless", true);
+    setenv("WLR_RENDERER", "pixman", true);
+    setenv("WLR_LIBINPUT_NO_DEVICES", "1", true);
+    unsetenv("WAYLAND_DISPLAY");
+    unsetenv("DISPLAY");
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (!hc->debug) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                         O_WRONLY, 0);
+        if (!hc->keep_stderr)
+            posix_spawn_file_actions_addopen(&actions, STDERR_FILENO,
+                                             "/dev/null", O_WRONLY, 0);
+    }
+
+    char *argv[] = {
+        (char *)hc->binary, "-c", (char *)hc->config, "-l", (char *)hc->library,
+        hc->debug ? "-dd" : NULL, NULL,
+    };
+
+    int err = posix_spawnp(&hc->pid, hc->binary, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (err) {
+        fprintf(stderr, "can't spawn %s: %s\n", hc->binary, strerror(err));
+        hc->pid = 0;
+        return false;
+    }
+
+    active = hc;
+    return true;
+}
+
+bool harness_compositor_alive(struct harness_compositor *hc)
+{
+    return hc->pid > 0 && waitpid(hc->pid, NULL, WNOHANG) == 0;
+}
+
+void harness_compositor_stop(struct harness_compositor *hc)
+{
+    if (active == hc)
+        active = NULL;
+
+    if (hc->pid > 0 && harness_compositor_alive(hc)) {
+        kill(hc->pid, SIGTERM);
+        for (int i = 0; i < 100 && harness_compositor_alive(hc); i++)
+            usleep(10000);
+
+        if (harness_compositor_alive(hc)) {
+            kill(hc->pid, SIGKILL);
+            waitpid(hc->pid, NULL, 0);
+        }
+    }
+    hc->pid = 0;
+
+    if (!hc->runtime_dir[0])
+        return;
+
+    DIR *dir = opendir(hc->runtime_dir);
+    if (dir) {
+        struct dirent *ent;
+        while ((ent = readdir(dir))) {
+            if (ent->d_name[0] == '.')
+                continue;
+            unlinkat(dirfd(dir), ent->d_name, 0);
+        }
+        closedir(dir);
+        rmdir(hc->runtime_dir);
+    }
+    hc->runtime_dir[0] = '\0';
+}
+
+int harness_ipc_connect(struct harness_compositor *hc, int timeout_msec)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/cwc.%d.%d.sock",
+             hc->runtime_dir, getuid(), hc->pid);
+
+    for (int waited = 0;
+         waited < timeout_msec && harness_compositor_alive(hc); waited += 10) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+
+        close(fd);
+        usleep(10000);
+    }
+
+    return -1;
+}
+
+bool harness_send_all(int fd, const char *buf, size_t len)
+{
+    while (len) {
+        ssize_t sent = send(fd, buf, len, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+
+        if (sent <= 0)
+            return false;
+
+        buf += sent;
+        len -= sent;
+    }
+
+    return true;
+}
+
+bool harness_recv_all(int fd, char *buf, size_t len, int timeout_msec)
+{
+    while (len) {
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        int ready         = poll(&pfd, 1, timeout_msec);
+        if (ready < 0 && errno == EINTR)
+            continue;
+
+        if (ready <= 0)
+            return false;
+
+        ssize_t received = recv(fd, buf, len, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+
+        if (received <= 0)
+            return false;
+
+        buf += received;
+        len -= received;
+    }
+
+    return true;
+}
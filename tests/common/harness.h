@@ -0,0 +1,65 @@
+/* shared helpers for the tests that run a real compositor, start cwc on the
+ * headless backend in a private XDG_RUNTIME_DIR and talk to it over ipc.
+ */
+
+#ifndef _TESTS_COMMON_HARNESS_H
+#define _TESTS_COMMON_HARNESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+struct harness_compositor {
+    const char *binary;
+    const char *config;
+    const char *library;
+    bool debug;       // pass -dd and keep the compositor stdout
+    bool keep_stderr; // stderr is discarded unless this or debug is set
+
+    char runtime_dir[64];
+    pid_t pid;
+};
+
+/* like assert but stay active under NDEBUG, on failure the spawned compositor
+ * is stopped before exiting.
+ */
+#define HARNESS_CHECK(cond)                                \
+    do {                                                   \
+        if (!(cond))                                       \
+            harness_check_fail(__FILE__, __LINE__, #cond); \
+    } while (0)
+
+void harness_check_fail(const char *file, int line, const char *expr)
+    __attribute__((noreturn));
+
+/* create the runtime directory from the template such as
+ * "/tmp/cwc-test-XXXXXX", return false on failure.
+ */
+bool harness_runtime_dir_create(struct harness_compositor *hc,
+                                const char *template);
+
+/* spawn the compositor with the environment of the calling process, the caller
+ * may set additional variables before calling.
+ */
+bool harness_compositor_spawn(struct harness_compositor *hc);
+
+bool harness_compositor_alive(struct harness_compositor *hc);
+
+/* terminate the compositor, kill it if it doesn't exit within a second, then
+ * remove the runtime directory.
+ */
+void harness_compositor_stop(struct harness_compositor *hc);
+
+/* connect to the compositor ipc socket, retrying until it's up or the timeout
+ * passed. Return the fd or -1.
+ */
+int harness_ipc_connect(struct harness_compositor *hc, int timeout_msec);
+
+bool harness_send_all(int fd, const char *buf, size_t len);
+
+/* return false on error or if nothing arrived within the timeout, a negative
+ * timeout block indefinitely.
+ */
+bool harness_recv_all(int fd, char *buf, size_t len, int timeout_msec);
+
+#endif // !_TESTS_COMMON_HARNESS_H
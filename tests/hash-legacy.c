@@ -0,0 +1,223 @@
+/* hash-legacy.c - the chained hhmap before it became a swiss table, only kept
+ * as the baseline for the benchmark in hash.c
+ *
+ * Copyright (C) 2024 Dwi Asmoro Bangun <dwiaceromo@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xxhash.h>
+
+#include "hash-legacy.h"
+
+static inline void __recompute_limit(struct legacy_hhmap *map)
+{
+    map->expand_at_size_exceed           = map->alloc * 3 / 4;
+    map->shrink_at_size_behind           = map->alloc / 5;
+    map->rehash_at_remove_counter_exceed = map->alloc;
+    map->remove_counter                  = 0;
+    if (map->shrink_at_size_behind < 8)
+        map->shrink_at_size_behind = 0;
+}
+
+struct legacy_hhmap *legacy_hhmap_create(int prealloc_size)
+{
+    struct legacy_hhmap *m = malloc(sizeof(*m));
+    if (!m)
+        return NULL;
+
+    uint64_t init_alloc = 8;
+    while (init_alloc < prealloc_size)
+        init_alloc <<= 1;
+
+    m->size  = 0;
+    m->alloc = init_alloc;
+    m->table = calloc(init_alloc, sizeof(*m->table));
+    __recompute_limit(m);
+    // disable shrink limit to respect initial_size
+    m->shrink_at_size_behind = 0;
+
+    return m;
+}
+
+void legacy_hhmap_destroy(struct legacy_hhmap *map)
+{
+    free(map->table);
+    free(map);
+}
+
+/* return pointer to hash_entry that found, return NULL otherwise */
+static struct legacy_hhash_entry *
+legacy_hhmap_lookup(struct legacy_hhmap *map,
+                    uint64_t hash,
+                    struct legacy_hhash_entry **prev)
+{
+    uint64_t alloc            = map->alloc;
+    struct legacy_hhash_entry *table = map->table;
+    uint64_t idx              = hash % alloc;
+    struct legacy_hhash_entry *root  = &table[idx];
+
+    // loop until the end of linked list
+    *prev                       = root;
+    struct legacy_hhash_entry *current = root;
+    do {
+        if (hash == current->hash)
+            break;
+
+        *prev   = current;
+        current = current->next;
+
+    } while (current != NULL);
+
+    return current;
+}
+
+static inline void __legacy_hhmap_rehash_expand(struct legacy_hhmap *map);
+
+static inline void
+__legacy_hhmap_insert(struct legacy_hhmap *map, uint64_t hash, void *data)
+{
+    struct legacy_hhash_entry *prev;
+    struct legacy_hhash_entry *current = legacy_hhmap_lookup(map, hash, &prev);
+
+    if (current) {
+        current->data = data;
+        return;
+    }
+
+    // find empty block using linear probing
+    struct legacy_hhash_entry *table = map->table;
+    uint64_t alloc            = map->alloc;
+    uint64_t idx              = prev - table;
+    current                   = &table[idx];
+    while (current->hash != 0) {
+        idx += 1; // jump interval, must be prime number
+        if (idx >= alloc)
+            idx -= alloc;
+
+        current = &table[idx];
+    }
+
+    current->hash = hash;
+    current->data = data;
+    map->size++;
+
+    if (prev != current)
+        prev->next = current;
+
+    __legacy_hhmap_rehash_expand(map);
+}
+
+static void __legacy_hhmap_rehash_to_size(struct legacy_hhmap *map,
+                                         uint64_t new_size)
+{
+    uint64_t alloc                = map->alloc;
+    struct legacy_hhash_entry *old_table = map->table;
+    struct legacy_hhash_entry *new_table = calloc(new_size, sizeof(*new_table));
+    if (new_table == NULL)
+        return;
+
+    map->table = new_table;
+    map->size  = 0;
+    map->alloc = new_size;
+    __recompute_limit(map);
+
+    for (uint64_t i = 0; i < alloc; i++) {
+        struct legacy_hhash_entry *elem = &old_table[i];
+        if (!elem->hash)
+            continue;
+        __legacy_hhmap_insert(map, elem->hash, elem->data);
+    }
+
+    free(old_table);
+}
+
+/* expand and rehash to half filled bucket (75% load to about 40%) */
+static inline void __legacy_hhmap_rehash_expand(struct legacy_hhmap *map)
+{
+    if (map->expand_at_size_exceed >= map->size)
+        return;
+
+    __legacy_hhmap_rehash_to_size(map, map->alloc * 2);
+}
+
+void legacy_hhmap_ninsert(struct legacy_hhmap *map,
+                          void *key,
+                          int key_len,
+                          void *data)
+{
+    uint64_t xxhash = XXH3_64bits(key, key_len);
+    __legacy_hhmap_insert(map, xxhash, data);
+}
+
+static inline void *__legacy_hhmap_get(struct legacy_hhmap *map,
+                                       uint64_t hash)
+{
+    struct legacy_hhash_entry *prev;
+    struct legacy_hhash_entry *result = legacy_hhmap_lookup(map, hash, &prev);
+
+    if (result)
+        return result->data;
+
+    return NULL;
+}
+
+void *legacy_hhmap_nget(struct legacy_hhmap *map, const void *key, int key_len)
+{
+    uint64_t xxhash = XXH3_64bits(key, key_len);
+    return __legacy_hhmap_get(map, xxhash);
+}
+
+static void __legacy_hhmap_remove(struct legacy_hhmap *map, uint64_t hash)
+{
+    struct legacy_hhash_entry *prev;
+    struct legacy_hhash_entry *result = legacy_hhmap_lookup(map, hash, &prev);
+
+    if (result == NULL)
+        return;
+
+    // if its the last node then clear
+    if (result->next == NULL) {
+        if (prev)
+            prev->next = NULL;
+        *result = (struct legacy_hhash_entry){0};
+    } else { // keep the link for other to use
+        result->hash = 0;
+        result->data = NULL;
+    }
+
+    map->size--;
+
+    // the automatic rehash as it was built with HHMAP_AUTOMATIC_REHASH
+    map->remove_counter++;
+    if (map->remove_counter >= map->rehash_at_remove_counter_exceed)
+        __legacy_hhmap_rehash_to_size(map, map->alloc);
+}
+
+void legacy_hhmap_nremove(struct legacy_hhmap *map,
+                          const void *key,
+                          int key_len)
+{
+
+    uint64_t xxhash = XXH3_64bits(key, key_len);
+    __legacy_hhmap_remove(map, xxhash);
+}
@@ -0,0 +1,33 @@
+#ifndef _CWC_TESTS_HASH_LEGACY_H
+#define _CWC_TESTS_HASH_LEGACY_H
+
+#include <stdint.h>
+
+struct legacy_hhash_entry {
+    struct legacy_hhash_entry *next;
+    uint64_t hash;
+    void *data;
+};
+
+struct legacy_hhmap {
+    uint64_t size;
+    uint64_t alloc;
+    uint64_t expand_at_size_exceed;
+    uint64_t shrink_at_size_behind;
+    uint32_t rehash_at_remove_counter_exceed;
+    uint32_t remove_counter;
+    struct legacy_hhash_entry *table;
+};
+
+struct legacy_hhmap *legacy_hhmap_create(int prealloc_size);
+void legacy_hhmap_destroy(struct legacy_hhmap *map);
+void legacy_hhmap_ninsert(struct legacy_hhmap *map,
+                          void *key,
+                          int key_len,
+                          void *data);
+void *legacy_hhmap_nget(struct legacy_hhmap *map, const void *key, int key_len);
+void legacy_hhmap_nremove(struct legacy_hhmap *map,
+                          const void *key,
+                          int key_len);
+
+#endif // !_CWC_TESTS_HASH_LEGACY_H
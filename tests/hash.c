@@ -1,9 +1,24 @@
-#include <assert.h>
+/* hhmap test, run with `bench [table_size]` to compare the swiss table with
+ * the previous chained map instead.
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "cwc/util.h"
+#include "hash-legacy.h"
+
+/* assert is compiled out in the release build, this one stays */
+#define CHECK(cond)                                                \
+    do {                                                           \
+        if (!(cond)) {                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, \
+                    __LINE__, #cond);                              \
+            exit(1);                                               \
+        }                                                          \
+    } while (0)
 
 #define KEY_LEN 10
 
@@ -43,7 +58,7 @@ void destroy_data(struct cwc_hhmap *m)
         memset(key, 0, KEY_LEN);
         sprintf(key, "%d", i);
         char *val = cwc_hhmap_nget(m, key, KEY_LEN);
-        assert(val == NULL);
+        CHECK(val == NULL);
     }
 }
 
@@ -62,7 +77,7 @@ void basic_perf(struct cwc_hhmap *m)
         sprintf(key, "%d", i);
         char *value = cwc_hhmap_nget(m, key, KEY_LEN);
         // printf("%d %ld %ld\n", i, m->size, m->alloc);
-        assert(value == i);
+        CHECK(value == i);
     }
 
     for (int i = 0; i < TABLE_SIZE; i++) {
@@ -78,7 +93,7 @@ void basic_perf(struct cwc_hhmap *m)
         memset(key, 0, KEY_LEN);
         sprintf(key, "%d", i);
         char *value = cwc_hhmap_nget(m, key, KEY_LEN);
-        assert(value == NULL);
+        CHECK(value == NULL);
     }
 }
 
@@ -127,19 +142,202 @@ void repeated_read(struct cwc_hhmap *m)
     }
 }
 
-int main()
+// insert/remove churn checked against a plain array
+void churn(struct cwc_hhmap *m)
 {
-    TABLE_SIZE          = 1e7;
-    struct cwc_hhmap *m = cwc_hhmap_create(0);
-    setup_data(m);
+    int n         = 5000;
+    char *present = calloc(n, 1);
+
+    srand(42);
+    for (int round = 0; round < 200000; round++) {
+        int i = rand() % n;
+        char key[KEY_LEN];
+        memset(key, 0, KEY_LEN);
+        sprintf(key, "%d", i);
 
-    for (int i = 0; i < 5; i++) {
-        // basic_perf(m);
-        repeated_read(m);
+        if (rand() % 2) {
+            cwc_hhmap_ninsert(m, key, KEY_LEN, (void *)(long)(i + 1));
+            present[i] = 1;
+        } else {
+            cwc_hhmap_nremove(m, key, KEY_LEN);
+            present[i] = 0;
+        }
     }
 
-    destroy_data(m);
+    uint64_t count = 0;
+    for (int i = 0; i < n; i++) {
+        char key[KEY_LEN];
+        memset(key, 0, KEY_LEN);
+        sprintf(key, "%d", i);
+
+        void *value = cwc_hhmap_nget(m, key, KEY_LEN);
+        CHECK(value == (present[i] ? (void *)(long)(i + 1) : NULL));
+        count += present[i];
+    }
+    CHECK(m->size == count);
+
+    // the occupied entry iteration used by the callers
+    uint64_t occupied = 0;
+    for (uint64_t i = 0; i < m->alloc; i++)
+        occupied += m->table[i].hash != 0;
+    CHECK(occupied == count);
+
+    free(present);
+}
+
+void keyed_operation()
+{
+    struct cwc_hhmap *m = cwc_hhmap_create_keyed(0);
+
+    cwc_hhmap_insert(m, "client::map", "a");
+    cwc_hhmap_insert(m, "client::unmap", "b");
+    CHECK(strcmp(cwc_hhmap_get(m, "client::map"), "a") == 0);
+    CHECK(strcmp(cwc_hhmap_get(m, "client::unmap"), "b") == 0);
+    CHECK(cwc_hhmap_get(m, "client::ma") == NULL);
+
+    struct hhash_entry *entry = cwc_hhmap_get_entry(m, "client::map");
+    CHECK(entry->key_len == strlen("client::map"));
+    CHECK(memcmp(entry->key, "client::map", entry->key_len) == 0);
+
+    cwc_hhmap_remove(m, "client::map");
+    CHECK(cwc_hhmap_get(m, "client::map") == NULL);
+    CHECK(m->size == 1);
+    cwc_hhmap_remove(m, "client::unmap");
+
+    churn(m);
+    cwc_hhmap_destroy(m);
+}
+
+//================== BENCHMARK ====================
+
+struct bench_map {
+    const char *name;
+    void *(*create)();
+    void (*destroy)(void *m);
+    void (*insert)(void *m, void *key, int len, void *data);
+    void *(*get)(void *m, const void *key, int len);
+    void (*remove)(void *m, const void *key, int len);
+};
+
+static void *swiss_create()
+{
+    return cwc_hhmap_create(0);
+}
+
+static void *swiss_keyed_create()
+{
+    return cwc_hhmap_create_keyed(0);
+}
+
+static void *legacy_create()
+{
+    return legacy_hhmap_create(0);
+}
+
+static const struct bench_map bench_maps[] = {
+    {"swiss", swiss_create, (void *)cwc_hhmap_destroy,
+     (void *)cwc_hhmap_ninsert, (void *)cwc_hhmap_nget,
+     (void *)cwc_hhmap_nremove},
+    {"swiss keyed", swiss_keyed_create, (void *)cwc_hhmap_destroy,
+     (void *)cwc_hhmap_ninsert, (void *)cwc_hhmap_nget,
+     (void *)cwc_hhmap_nremove},
+    {"legacy", legacy_create, (void *)legacy_hhmap_destroy,
+     (void *)legacy_hhmap_ninsert, (void *)legacy_hhmap_nget,
+     (void *)legacy_hhmap_nremove},
+};
 
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* print the time per operation since start and return the new start */
+static double bench_report(const char *label, double start)
+{
+    printf("  %-8s %8.1f ns/op\n", label,
+           (now_sec() - start) * 1e9 / TABLE_SIZE);
+    return now_sec();
+}
+
+static void bench(const struct bench_map *bm, char *keys, int *order)
+{
+    void *m           = bm->create();
+    volatile long sum = 0;
+
+    printf("%s\n", bm->name);
+
+    double start = now_sec();
+    for (int i = 0; i < TABLE_SIZE; i++)
+        bm->insert(m, &keys[i * KEY_LEN], KEY_LEN, keys);
+    start = bench_report("insert", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        sum += (long)bm->get(m, &keys[order[i] * KEY_LEN], KEY_LEN);
+    start = bench_report("hit", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        sum += (long)bm->get(m, &keys[(TABLE_SIZE + i) * KEY_LEN], KEY_LEN);
+    start = bench_report("miss", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        char *key = &keys[order[i] * KEY_LEN];
+        bm->remove(m, key, KEY_LEN);
+        bm->insert(m, key, KEY_LEN, keys);
+    }
+    start = bench_report("churn", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        bm->remove(m, &keys[i * KEY_LEN], KEY_LEN);
+    bench_report("remove", start);
+
+    bm->destroy(m);
+}
+
+static int bench_main(int size)
+{
+    TABLE_SIZE = size;
+
+    // the second half is never inserted for the miss lookup
+    char *keys = calloc(TABLE_SIZE * 2, KEY_LEN);
+    int *order = malloc(TABLE_SIZE * sizeof(*order));
+    for (int i = 0; i < TABLE_SIZE * 2; i++)
+        snprintf(&keys[i * KEY_LEN], KEY_LEN, "%d", i);
+
+    srand(69);
+    for (int i = 0; i < TABLE_SIZE; i++)
+        order[i] = rand() % TABLE_SIZE;
+
+    printf("%d entries, %d bytes key\n\n", TABLE_SIZE, KEY_LEN);
+    for (size_t i = 0; i < LENGTH(bench_maps); i++)
+        bench(&bench_maps[i], keys, order);
+
+    free(keys);
+    free(order);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench_main(argc > 2 ? atoi(argv[2]) : 1000000);
+
+    TABLE_SIZE          = 1e6;
+    struct cwc_hhmap *m = cwc_hhmap_create(0);
+
+    basic_perf(m);
+    churn(m);
     cwc_hhmap_destroy(m);
+
+    keyed_operation();
+
+    m = cwc_hhmap_create(0);
+    setup_data(m);
+    repeated_read(m);
+    destroy_data(m);
+    cwc_hhmap_destroy(m);
+
+    puts("hhmap test PASSED");
     return 0;
 }
@@ -1,10 +1,18 @@
+// same workload as hash.c, run with `bench [table_size]` for the benchmark
 #include <boost/unordered/unordered_flat_map.hpp>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <unordered_map>
+#include <vector>
 using namespace std;
 
+#define KEY_LEN 10
+
 static int TABLE_SIZE;
 
 // boost::unordered::unordered_flat_map<string, char*> umap;
@@ -88,8 +96,78 @@ void repeated_read()
     }
 }
 
-int main()
+// print the time per operation since start and return the new start
+static chrono::steady_clock::time_point
+bench_report(const char *label, chrono::steady_clock::time_point start)
+{
+    auto now = chrono::steady_clock::now();
+    double ns = chrono::duration<double, nano>(now - start).count();
+    printf("  %-8s %8.1f ns/op\n", label, ns / TABLE_SIZE);
+    return chrono::steady_clock::now();
+}
+
+template <typename Map>
+static void bench(const char *name, vector<string> &keys, vector<int> &order)
 {
+    Map map;
+    volatile long sum = 0;
+
+    printf("%s\n", name);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < TABLE_SIZE; i++)
+        map[keys[i]] = nullptr;
+    start = bench_report("insert", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        sum += map.find(keys[order[i]]) != map.end();
+    start = bench_report("hit", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        sum += map.find(keys[TABLE_SIZE + i]) != map.end();
+    start = bench_report("miss", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        map.erase(keys[order[i]]);
+        map[keys[order[i]]] = nullptr;
+    }
+    start = bench_report("churn", start);
+
+    for (int i = 0; i < TABLE_SIZE; i++)
+        map.erase(keys[i]);
+    bench_report("remove", start);
+}
+
+static int bench_main(int size)
+{
+    TABLE_SIZE = size;
+
+    // fixed length key like hash.c, the second half is never inserted
+    vector<string> keys(TABLE_SIZE * 2);
+    vector<int> order(TABLE_SIZE);
+    for (int i = 0; i < TABLE_SIZE * 2; i++) {
+        char key[KEY_LEN] = {0};
+        snprintf(key, KEY_LEN, "%d", i);
+        keys[i] = string(key, KEY_LEN);
+    }
+
+    srand(69);
+    for (int i = 0; i < TABLE_SIZE; i++)
+        order[i] = rand() % TABLE_SIZE;
+
+    printf("%d entries, %d bytes key\n\n", TABLE_SIZE, KEY_LEN);
+    bench<unordered_map<string, char *>>("std::unordered_map", keys, order);
+    bench<boost::unordered::unordered_flat_map<string, char *>>(
+        "boost::unordered_flat_map", keys, order);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench_main(argc > 2 ? atoi(argv[2]) : 1000000);
+
     TABLE_SIZE = 1e7;
     setup_data();
     for (int i = 0; i < 5; i++) {
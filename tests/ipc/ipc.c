@@ -0,0 +1,243 @@
+/* ipc signal subscription test, start cwc on the headless backend and check
+ * subscribe -> emit -> receive, the subscription limits, and the
+ * `ipc::dropped` notice for a client that doesn't read fast enough.
+ */
+
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../common/harness.h"
+#include "cwc/ipc.h"
+
+#ifndef CWC_IPC_TEST_CWC
+#define CWC_IPC_TEST_CWC "cwc"
+#endif
+#ifndef CWC_IPC_TEST_RC
+#define CWC_IPC_TEST_RC "tests/ipc/rc.lua"
+#endif
+#ifndef CWC_IPC_TEST_LIB
+#define CWC_IPC_TEST_LIB "lib"
+#endif
+
+#define STARTUP_TIMEOUT_MSEC 10000
+#define RECV_TIMEOUT_MSEC    5000
+
+// must be above SIGNAL_BACKLOG_LIMIT plus what the socket buffer can hold
+#define FLOOD_COUNT   4096
+#define FLOOD_PAYLOAD 1024
+
+static struct harness_compositor cwc = {
+    .binary      = CWC_IPC_TEST_CWC,
+    .config      = CWC_IPC_TEST_RC,
+    .library     = CWC_IPC_TEST_LIB,
+    .keep_stderr = true,
+};
+static char *msg;
+
+struct message {
+    enum cwc_ipc_opcode opcode;
+    const char *body; // null terminated, valid until the next recv
+    uint32_t len;
+};
+
+static int ipc_connect()
+{
+    int fd = harness_ipc_connect(&cwc, STARTUP_TIMEOUT_MSEC);
+    if (fd < 0) {
+        fprintf(stderr, "can't connect to the compositor ipc\n");
+        harness_compositor_stop(&cwc);
+        exit(1);
+    }
+
+    return fd;
+}
+
+static void send_message(int fd, enum cwc_ipc_opcode opcode, const char *body)
+{
+    int size = ipc_create_message(msg, IPC_MAX_MESSAGE, opcode, body);
+    HARNESS_CHECK(size > 0);
+
+    bool sent = harness_send_all(fd, msg, size);
+    HARNESS_CHECK(sent);
+}
+
+static bool recv_message(int fd, struct message *m, int timeout)
+{
+    if (!harness_recv_all(fd, msg, HEADER_SIZE, timeout))
+        return false;
+
+    HARNESS_CHECK(check_header(msg));
+    m->body = ipc_get_body(msg, &m->opcode);
+    m->len  = ipc_get_body_length(msg);
+    HARNESS_CHECK(m->len <= IPC_MAX_BODY);
+
+    // the rest of the message is already on the way
+    bool received =
+        harness_recv_all(fd, msg + HEADER_SIZE, m->len, RECV_TIMEOUT_MSEC);
+    HARNESS_CHECK(received);
+    msg[HEADER_SIZE + m->len] = '\0';
+
+    return true;
+}
+
+/* evaluate the chunk and return the response, the connection must not have
+ * any signal in flight.
+ */
+static const char *eval(int fd, const char *fmt, ...)
+{
+    char chunk[512];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(chunk, sizeof(chunk), fmt, args);
+    va_end(args);
+
+    send_message(fd, IPC_EVAL, chunk);
+
+    struct message m;
+    bool received = recv_message(fd, &m, RECV_TIMEOUT_MSEC);
+    HARNESS_CHECK(received);
+    HARNESS_CHECK(m.opcode == IPC_EVAL_RESPONSE);
+
+    return m.body;
+}
+
+/* the messages in a connection are handled in order, once the eval response
+ * arrived the (un)subscription before it is applied.
+ */
+static void subscription(int fd, enum cwc_ipc_opcode opcode, const char *names)
+{
+    send_message(fd, opcode, names);
+    eval(fd, "return 0");
+}
+
+static void expect_signal(int fd, const char *body)
+{
+    struct message m;
+    bool received = recv_message(fd, &m, RECV_TIMEOUT_MSEC);
+    HARNESS_CHECK(received);
+    HARNESS_CHECK(m.opcode == IPC_SIGNAL);
+
+    if (strcmp(m.body, body) != 0) {
+        fprintf(stderr, "expected signal \"%s\" got \"%s\"\n", body, m.body);
+        HARNESS_CHECK(false);
+    }
+}
+
+static void emit_receive_test(int sub, int ctl)
+{
+    subscription(sub, IPC_SUBSCRIBE, "test::ipc test::ipc::sentinel");
+
+    eval(ctl, "cwc.emit_signal('test::ipc', 'x', 42)");
+    expect_signal(sub, "test::ipc\nx\t42");
+
+    // no longer delivered after unsubscribing, the sentinel mark the end
+    subscription(sub, IPC_UNSUBSCRIBE, "test::ipc");
+    eval(ctl, "cwc.emit_signal('test::ipc', 'y') "
+              "cwc.emit_signal('test::ipc::sentinel')");
+    expect_signal(sub, "test::ipc::sentinel\n");
+
+    // unknown name is just ignored
+    subscription(sub, IPC_UNSUBSCRIBE,
+                 "test::ipc::never_used test::ipc::sentinel");
+    subscription(sub, IPC_SUBSCRIBE, "test::ipc");
+}
+
+static void limit_test(int ctl)
+{
+    int sub = ipc_connect();
+
+    // oversized name is rejected
+    char name[256];
+    memset(name, 'n', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    memcpy(name, "test::", 6);
+
+    subscription(sub, IPC_SUBSCRIBE, name);
+    subscription(sub, IPC_SUBSCRIBE, "test::ipc::sentinel");
+    eval(ctl, "cwc.emit_signal('%s')", name);
+    eval(ctl, "cwc.emit_signal('test::ipc::sentinel')");
+    expect_signal(sub, "test::ipc::sentinel\n");
+
+    // the subscription past the limit is rejected
+    char *names = malloc(512 * 32);
+    names[0]    = '\0';
+    for (int i = 0; i < 512; i++)
+        sprintf(names + strlen(names), "test::ipc::cap%d ", i);
+
+    subscription(sub, IPC_SUBSCRIBE, names);
+    eval(ctl, "cwc.emit_signal('test::ipc::cap0') "
+              "cwc.emit_signal('test::ipc::cap511') "
+              "cwc.emit_signal('test::ipc::sentinel')");
+    expect_signal(sub, "test::ipc::cap0\n");
+    expect_signal(sub, "test::ipc::sentinel\n");
+
+    free(names);
+    close(sub);
+}
+
+static void dropped_test(int sub, int ctl)
+{
+    // flood without reading so the backlog of the subscriber fill up
+    eval(ctl,
+         "local payload = string.rep('p', %d) "
+         "for _ = 1, %d do cwc.emit_signal('test::ipc', payload) end",
+         FLOOD_PAYLOAD, FLOOD_COUNT);
+
+    // drain what's queued before the limit was reached
+    int received = 0;
+    struct message m;
+    while (recv_message(sub, &m, 500)) {
+        HARNESS_CHECK(m.opcode == IPC_SIGNAL);
+        HARNESS_CHECK(strncmp(m.body, "test::ipc\n", 10) == 0);
+        HARNESS_CHECK(m.len == 10 + FLOOD_PAYLOAD);
+        received++;
+    }
+    HARNESS_CHECK(received > 0 && received < FLOOD_COUNT);
+
+    // the next signal tells how many were missed
+    eval(ctl, "cwc.emit_signal('test::ipc', 'last')");
+
+    bool notified = recv_message(sub, &m, RECV_TIMEOUT_MSEC);
+    HARNESS_CHECK(notified);
+    HARNESS_CHECK(m.opcode == IPC_SIGNAL);
+    HARNESS_CHECK(strncmp(m.body, "ipc::dropped\n", 13) == 0);
+    HARNESS_CHECK(received + atoi(m.body + 13) == FLOOD_COUNT);
+
+    expect_signal(sub, "test::ipc\nlast");
+}
+
+int main()
+{
+    if (!harness_runtime_dir_create(&cwc, "/tmp/cwc-ipc-test-XXXXXX")) {
+        perror("can't create runtime directory");
+        return 1;
+    }
+
+    msg = malloc(IPC_MAX_MESSAGE + 1);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!msg || !harness_compositor_spawn(&cwc)) {
+        harness_compositor_stop(&cwc);
+        return 1;
+    }
+
+    int sub = ipc_connect();
+    int ctl = ipc_connect();
+
+    emit_receive_test(sub, ctl);
+    limit_test(ctl);
+    dropped_test(sub, ctl);
+
+    close(sub);
+    close(ctl);
+    harness_compositor_stop(&cwc);
+    free(msg);
+
+    puts("OK");
+    return 0;
+}
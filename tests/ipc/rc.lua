@@ -0,0 +1,2 @@
+-- config for the ipc test, the test only talk to the compositor over ipc so
+-- there's nothing to set up.
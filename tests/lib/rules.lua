@@ -58,6 +58,28 @@ assert(false == check_rule(sample_obj, {
     where_not_any = { appid = { "diff" }, workspace = { 3, 5 } },
 }))
 
+assert(check_rule(sample_obj, {
+    where = { appid = "^test object$", workspace = 5 },
+}))
+assert(false == check_rule(sample_obj, {
+    where = { appid = "^test$" },
+}))
+assert(check_rule(sample_obj, {
+    where = { appid = "t.st obj" },
+}))
+assert(check_rule(sample_obj, {
+    where_any = { appid = { "^diff$", "^test object$" } },
+}))
+assert(false == check_rule(sample_obj, {
+    where_any = {},
+}))
+
+crules.apply_rule(sample_obj, {
+    where = { appid = "^test object$" },
+    set = { workspace = 7 },
+})
+assert(sample_obj.workspace == 7)
+
 local id = crules.add_rule {
     where = { appid = "any" },
     set = { tag = 5 },
@@ -66,4 +88,32 @@ local id = crules.add_rule {
 
 crules.remove_rule(id)
 
+-- a setter changing another property must not leave the shared lookup stale
+local side_state = { geometry = "tiled" }
+local side_obj = setmetatable({ set_fullscreen = true }, {
+    __index = side_state,
+    __newindex = function(_, k, v)
+        side_state[k] = v
+        if k == "fullscreen" then side_state.geometry = v and "fullscreen" or "tiled" end
+    end,
+})
+
+local side_applied = false
+local side_id1 = crules.add_rule {
+    where = { geometry = "^tiled$" },
+    set = { fullscreen = true },
+    when = { "test::rules_side_effect" },
+}
+local side_id2 = crules.add_rule {
+    where = { geometry = "^fullscreen$" },
+    run = function() side_applied = true end,
+    when = { "test::rules_side_effect" },
+}
+
+cwc.emit_signal("test::rules_side_effect", side_obj)
+assert(side_applied)
+
+crules.remove_rule(side_id1)
+crules.remove_rule(side_id2)
+
 print(string.format("%s test \27[1;32mPASSED\27[0m", debug.getinfo(1, "S").source))
@@ -0,0 +1,84 @@
+/* object push benchmark, compares the ref based registry lookup with the old
+ * string keyed registry lookup.
+ */
+
+#include <lauxlib.h>
+#include <lua.h>
+#include <lualib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "cwc/luaobject.h"
+#include "private/luac.h"
+
+#define OBJECT_COUNT 100
+#define PUSH_COUNT   100000
+
+static struct {
+    int dummy;
+} objects[OBJECT_COUNT];
+
+static inline int legacy_object_push(lua_State *L, const void *pointer)
+{
+    lua_pushstring(L, LUAC_OBJECT_REGISTRY_KEY);
+    lua_rawget(L, LUA_REGISTRYINDEX);
+    lua_pushlightuserdata(L, (void *)pointer);
+    lua_rawget(L, -2);
+    lua_remove(L, -2);
+    return 1;
+}
+
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(lua_State *L,
+                  const char *name,
+                  int (*push)(lua_State *L, const void *pointer))
+{
+    int found    = 0;
+    double start = now_sec();
+    for (int i = 0; i < PUSH_COUNT; i++) {
+        push(L, &objects[i % OBJECT_COUNT]);
+        found += !lua_isnil(L, -1);
+        lua_pop(L, 1);
+    }
+    double elapsed = now_sec() - start;
+
+    if (found != PUSH_COUNT) {
+        fprintf(stderr, "%s: only %d of %d object found\n", name, found,
+                PUSH_COUNT);
+        exit(1);
+    }
+
+    printf("%-24s %10.3f ms %14.0f push/s\n", name, elapsed * 1e3,
+           PUSH_COUNT / elapsed);
+}
+
+int main()
+{
+    lua_State *L = luaL_newstate();
+    luaL_openlibs(L);
+    luaC_object_setup(L);
+
+    for (int i = 0; i < OBJECT_COUNT; i++) {
+        lua_newtable(L);
+        luaC_object_register(L, -1, &objects[i]);
+        lua_pop(L, 1);
+    }
+
+    // warm up
+    bench(L, "warm up", luaC_object_push);
+
+    bench(L, "string key registry", legacy_object_push);
+    bench(L, "ref registry", luaC_object_push);
+
+    lua_close(L);
+    return 0;
+}
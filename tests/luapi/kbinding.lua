@@ -1,6 +1,7 @@
 -- Test the cwc_kbindmap and cwc_kbind property
 
 local enum = require("cuteful.enum")
+local ckbd = require("cuteful.kbd")
 
 local cwc = cwc
 local kbd = cwc.kbd
@@ -82,6 +83,36 @@ local function test()
     end)
     assert(not success)
 
+    -- every active map is dispatched from one merged index
+    local hits = 0
+    local map_a = kbd.create_bindmap()
+    local map_b = kbd.create_bindmap()
+    map_a:bind({}, "F9", function() hits = hits + 1 end)
+    map_b:bind({}, "F9", function() hits = hits + 10 end)
+    ckbd.click(ckbd.event_code.KEY_F9)
+    assert(hits == 11)
+    map_b.active = false
+    ckbd.click(ckbd.event_code.KEY_F9)
+    assert(hits == 12)
+    map_a:destroy()
+    map_b:destroy()
+
+    -- a repeated bind that unbinds itself or clears its map must not re-arm
+    local kbd_dev = cwc.kbd.get()[1]
+    local map_r = kbd.create_bindmap()
+    map_r:bind({}, "F10", function()
+        map_r:bind({}, "F10", function() end)
+    end, { repeated = true })
+    map_r:bind({}, "F11", function()
+        map_r:clear()
+    end, { repeated = true })
+    kbd_dev:send_key(ckbd.event_code.KEY_F10, enum.key_state.PRESSED)
+    kbd_dev:send_key(ckbd.event_code.KEY_F11, enum.key_state.PRESSED)
+    kbd_dev:send_key(ckbd.event_code.KEY_F11, enum.key_state.RELEASED)
+    kbd_dev:send_key(ckbd.event_code.KEY_F10, enum.key_state.RELEASED)
+    assert(#map_r.member == 0)
+    map_r:destroy()
+
     print("cwc_kbd && cwc_kbindmap && cwc_kbind test \27[1;32m\27[1;32mPASSED\27[0m\27[0m")
 end
 
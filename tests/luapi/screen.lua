@@ -59,6 +59,7 @@ local function ro_test(s)
     assert(type(s.restored) == "boolean")
     assert(type(s.adaptive_sync_status) == "boolean")
     assert(type(s.adaptive_sync_supported) == "boolean")
+    assert(s.opacity_nodes_visited >= 0)
 
     assert(type(s.workarea) == "table")
     assert(s.workarea.x >= 0)
@@ -103,6 +104,67 @@ local function method_test(s)
     assert(#s.clients == #s:get_clients())
     assert(#s.containers == #s:get_containers())
     assert(#s.minimized == #s:get_minimized())
+
+    -- second call reuse the cached list, mutating it must not leak
+    local hits = cwc.snapshot_stats().hits
+    local clients = s:get_clients()
+    table.insert(clients, false)
+    assert(#s:get_clients() == #clients - 1)
+    assert(cwc.snapshot_stats().hits > hits)
+
+    -- duplicate requests are merged into one call in the next frame
+    local frame_called = 0
+    local id = s:add_frame_callback(function(screen, data)
+        assert(screen == s)
+        assert(data == "data")
+        frame_called = frame_called + 1
+    end, "data")
+    assert(s:request_frame(id))
+    assert(s:request_frame(id))
+    assert(frame_called == 0)
+
+    -- re-requesting itself runs again on the following frame, requesting a
+    -- callback that the dispatch hasn't reached yet runs it in the same frame
+    local rerequest_called, later_called = 0, 0
+    local rerequest_id, later_id
+    rerequest_id = s:add_frame_callback(function(screen)
+        rerequest_called = rerequest_called + 1
+        assert(frame_called == 1)
+        if rerequest_called == 1 then
+            assert(later_called == 0)
+            assert(screen:request_frame(rerequest_id))
+            assert(screen:request_frame(later_id))
+        else
+            assert(later_called == 1)
+        end
+    end)
+    later_id = s:add_frame_callback(function()
+        later_called = later_called + 1
+        assert(rerequest_called == 1)
+    end)
+    assert(s:request_frame(rerequest_id))
+
+    cwc.timer.new(1, function()
+        assert(frame_called == 1)
+        assert(rerequest_called == 2)
+        assert(later_called == 1)
+
+        assert(s:remove_frame_callback(id))
+        assert(not s:remove_frame_callback(id))
+        assert(not s:request_frame(id))
+        assert(s:remove_frame_callback(rerequest_id))
+        assert(s:remove_frame_callback(later_id))
+    end, { one_shot = true })
+
+    local stats = s:frame_stats(true)
+    assert(stats.frames >= 0)
+    assert(stats.rendered + stats.skipped + stats.held + stats.build_failed
+        + stats.commit_failed == stats.frames)
+    assert(stats.frame_time.p50 <= stats.frame_time.p99)
+    assert(stats.frame_time.p99 <= stats.frame_time.max)
+    assert(#stats.records <= stats.frames)
+    assert(s:frame_stats().records == nil)
+
     s:get_nearest(enum.direction.LEFT)
     s:focus()
 end
@@ -38,6 +38,7 @@ end
 local function readonly_test(tag)
     assert(tag.index == 3)
     assert(tostring(tag.screen):match("cwc_screen"))
+    assert(tag.bsp_configure_count >= 0)
 end
 
 local function property_test(tag)
@@ -14,6 +14,7 @@ local pointer_test = require("luapi.pointer")
 local kbd_test = require("luapi.kbd")
 local tablet_test = require("luapi.tablet")
 local input_test = require("luapi.input")
+local property_bench = require("bench.property")
 
 local cwc = cwc
 
@@ -96,6 +97,42 @@ cwc.kbd.bind({}, "F12", function()
     tablet_test.api()
     input_test.api()
 
+    -- the automatic start timer has fired at least once
+    local tstats = cwc.timer.stats()
+    assert(tstats.wakeups >= 1 and tstats.fired >= 1)
+    local slack_timer = cwc.timer.new(60, function() end, { slack = 1 })
+    assert(slack_timer.slack == 1)
+    assert(cwc.timer.stats().active == tstats.active + 1)
+    slack_timer:destroy()
+
+    -- line mode batch the lines into a table and flush the partial one at eof
+    local lines = {}
+    cwc.spawn_with_shell("printf 'a\\nb\\nc'", {
+        mode = "line",
+        callback = function(out)
+            for _, line in ipairs(out or {}) do table.insert(lines, line) end
+        end,
+    }, function(exit_code)
+        assert(exit_code == 0)
+        assert(#lines == 3 and lines[1] == "a" and lines[3] == "c")
+    end)
+
+    -- output larger than max_size still arrive as whole lines
+    local short_lines = {}
+    cwc.spawn_with_shell("seq -f 'line-%g' 1 2000", {
+        mode = "line",
+        max_size = 100,
+        callback = function(out)
+            for _, line in ipairs(out or {}) do table.insert(short_lines, line) end
+        end,
+    }, function(exit_code)
+        assert(exit_code == 0)
+        assert(#short_lines == 2000)
+        for i, line in ipairs(short_lines) do
+            assert(line == "line-" .. i, line)
+        end
+    end)
+
     cwc.screen.focused():get_tag(2):view_only()
     container_test.api()
     print("--------------------------------- API TEST END ------------------------------------")
@@ -120,6 +157,12 @@ cwc.kbd.bind({}, "F1", function()
     io.flush()
 end)
 
+-- benchmark by pressing F11, not run automatically since it takes a while
+cwc.kbd.bind({}, "F11", function()
+    property_bench()
+    io.flush()
+end)
+
 cwc.kbd.bind({ MODKEY, mod.CTRL }, "r", cwc.reload, { description = "reload configuration" })
 kbd.bind({ MODKEY, mod.CTRL }, "Delete", cwc.quit, { description = "exit cwc", group = "cwc" })
 
@@ -0,0 +1,136 @@
+/* spawn latency and main loop stall benchmark
+ *
+ * usage: spawn [heap_mb] [iteration]
+ *
+ * The heap is allocated and touched first to mimic a compositor with a big lua
+ * heap. "stall" is how long the spawning call blocks the caller (what the main
+ * loop feel), "latency" is until the child (/bin/true) has exited.
+ */
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static char *const true_argv[] = {"/bin/true", NULL};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// the old way, without the second fork since only the first one block
+static pid_t spawn_fork()
+{
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        execv(true_argv[0], true_argv);
+        _exit(127);
+    }
+
+    return pid;
+}
+
+static pid_t spawn_posix()
+{
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+
+    sigset_t sigmask, sigdefault;
+    sigemptyset(&sigmask);
+    sigfillset(&sigdefault);
+    posix_spawnattr_setsigmask(&attr, &sigmask);
+    posix_spawnattr_setsigdefault(&attr, &sigdefault);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK
+                                        | POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid;
+    int err = posix_spawn(&pid, true_argv[0], NULL, &attr, true_argv, environ);
+    posix_spawnattr_destroy(&attr);
+
+    return err ? -1 : pid;
+}
+
+static void report(const char *name, uint64_t *samples, int n)
+{
+    qsort(samples, n, sizeof(*samples), cmp_u64);
+
+    uint64_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += samples[i];
+
+    printf("  %-8s mean %9.1f us  p50 %9.1f us  p99 %9.1f us  max %9.1f us\n",
+           name, total / (double)n / 1e3, samples[n / 2] / 1e3,
+           samples[n * 99 / 100] / 1e3, samples[n - 1] / 1e3);
+}
+
+static void bench(const char *name, pid_t (*spawner)(), int iteration)
+{
+    uint64_t *stall   = calloc(iteration, sizeof(*stall));
+    uint64_t *latency = calloc(iteration, sizeof(*latency));
+
+    for (int i = 0; i < iteration; i++) {
+        uint64_t start = now_ns();
+        pid_t pid      = spawner();
+        uint64_t ret   = now_ns();
+
+        if (pid == -1) {
+            fprintf(stderr, "%s: spawn failed\n", name);
+            exit(1);
+        }
+
+        waitpid(pid, NULL, 0);
+        uint64_t done = now_ns();
+
+        stall[i]   = ret - start;
+        latency[i] = done - start;
+    }
+
+    printf("%s\n", name);
+    report("stall", stall, iteration);
+    report("latency", latency, iteration);
+
+    free(stall);
+    free(latency);
+}
+
+int main(int argc, char **argv)
+{
+    size_t heap_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    int iteration  = argc > 2 ? atoi(argv[2]) : 200;
+    if (iteration <= 0)
+        iteration = 1;
+
+    char *heap = malloc(heap_mb << 20);
+    if (heap_mb && !heap) {
+        fprintf(stderr, "can't allocate %zu MiB\n", heap_mb);
+        return 1;
+    }
+    memset(heap, 1, heap_mb << 20);
+
+    printf("heap %zu MiB, %d iteration\n\n", heap_mb, iteration);
+    bench("fork+exec", spawn_fork, iteration);
+    bench("posix_spawn", spawn_posix, iteration);
+
+    free(heap);
+    return 0;
+}
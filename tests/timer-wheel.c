@@ -0,0 +1,311 @@
+/* timer wheel test, the wheel is included directly so the test can drive its
+ * dispatch with a fake monotonic clock instead of waiting in the event loop.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server-core.h>
+
+/* assert is compiled out in the release build, this one stays */
+#define CHECK(cond)                                                \
+    do {                                                           \
+        if (!(cond)) {                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, \
+                    __LINE__, #cond);                              \
+            exit(1);                                               \
+        }                                                          \
+    } while (0)
+
+static uint64_t fake_now_ms;
+
+static int fake_clock_gettime(clockid_t clk, struct timespec *ts)
+{
+    ts->tv_sec  = fake_now_ms / 1000;
+    ts->tv_nsec = (fake_now_ms % 1000) * 1000000;
+    return 0;
+}
+
+#define clock_gettime fake_clock_gettime
+#include "../src/timer-wheel.c"
+#undef clock_gettime
+
+struct test_entry {
+    struct cwc_timer_entry entry;
+    int fired;
+    uint64_t fired_at; // wheel tick when notified
+    int order;
+    int reschedule; // times left to reschedule itself from the notify
+    uint32_t interval;
+};
+
+static int fire_counter;
+
+static void on_expired(struct cwc_timer_entry *entry)
+{
+    struct test_entry *t = wl_container_of(entry, t, entry);
+
+    // the level 0 slot must only contain entries of that exact tick
+    CHECK(entry->expires == wheel.now);
+
+    t->fired++;
+    t->fired_at = wheel.now;
+    t->order    = fire_counter++;
+
+    if (t->reschedule > 0) {
+        t->reschedule--;
+        cwc_timer_entry_schedule(entry, t->interval, 0);
+    }
+}
+
+static void test_entry_init(struct test_entry *t)
+{
+    *t = (struct test_entry){0};
+    cwc_timer_entry_init(&t->entry, on_expired);
+}
+
+/* move the clock and run the dispatch like the event loop timer would */
+static void advance_to(uint64_t ms)
+{
+    fake_now_ms = ms;
+    on_wheel_timer(NULL);
+}
+
+static void advance_by(uint64_t ms)
+{
+    advance_to(fake_now_ms + ms);
+}
+
+static void reset_wheel(uint64_t start)
+{
+    for (int level = 0; level < WHEEL_LEVELS; level++)
+        for (int i = 0; i < WHEEL_SIZE; i++)
+            CHECK(wl_list_empty(&wheel.slots[level][i]));
+    CHECK(wheel.active == 0);
+
+    fake_now_ms  = start;
+    wheel.now    = start;
+    fire_counter = 0;
+}
+
+static void insert_and_order_test()
+{
+    reset_wheel(1000);
+
+    uint32_t timeouts[] = {5, 3, 1000, 70, 64, 1, 63, 4096};
+    int len             = sizeof(timeouts) / sizeof(*timeouts);
+    struct test_entry entries[sizeof(timeouts) / sizeof(*timeouts)];
+
+    for (int i = 0; i < len; i++) {
+        test_entry_init(&entries[i]);
+        cwc_timer_entry_schedule(&entries[i].entry, timeouts[i], 0);
+        CHECK(cwc_timer_entry_is_scheduled(&entries[i].entry));
+    }
+    CHECK(wheel.active == (uint32_t)len);
+
+    // step one millisecond at a time so nothing fires early or late
+    for (uint64_t t = 1; t <= 5000; t++) {
+        advance_to(1000 + t);
+        for (int i = 0; i < len; i++)
+            CHECK(entries[i].fired == (t >= timeouts[i]));
+    }
+
+    for (int i = 0; i < len; i++) {
+        CHECK(entries[i].fired_at == 1000 + timeouts[i]);
+        CHECK(!cwc_timer_entry_is_scheduled(&entries[i].entry));
+
+        for (int j = 0; j < len; j++)
+            if (timeouts[i] < timeouts[j])
+                CHECK(entries[i].order < entries[j].order);
+    }
+    CHECK(wheel.active == 0);
+}
+
+static void cancel_test()
+{
+    reset_wheel(50000);
+
+    struct test_entry a, b, c;
+    test_entry_init(&a);
+    test_entry_init(&b);
+    test_entry_init(&c);
+
+    // cancel an entry that was never scheduled is a no-op
+    cwc_timer_entry_cancel(&a.entry);
+    CHECK(wheel.active == 0);
+
+    cwc_timer_entry_schedule(&a.entry, 10, 0);
+    cwc_timer_entry_schedule(&b.entry, 100000, 0); // level 2
+    cwc_timer_entry_schedule(&c.entry, 20, 0);
+    CHECK(wheel.active == 3);
+
+    cwc_timer_entry_cancel(&a.entry);
+    cwc_timer_entry_cancel(&b.entry);
+    CHECK(!cwc_timer_entry_is_scheduled(&a.entry));
+    CHECK(wheel.active == 1);
+
+    // reschedule moves the entry instead of adding it twice
+    cwc_timer_entry_schedule(&c.entry, 30, 0);
+    CHECK(wheel.active == 1);
+
+    advance_by(200000);
+    CHECK(a.fired == 0 && b.fired == 0);
+    CHECK(c.fired == 1 && c.fired_at == 50030);
+    CHECK(wheel.active == 0);
+}
+
+/* one entry per level, each one must be cascaded down to level 0 */
+static void cascade_test(uint64_t start)
+{
+    reset_wheel(start);
+
+    uint32_t timeouts[] = {
+        63,                                       // level 0
+        WHEEL_SIZE + 3,                           // level 1
+        WHEEL_SIZE * WHEEL_SIZE + 5,              // level 2
+        WHEEL_SIZE * WHEEL_SIZE * WHEEL_SIZE + 7, // level 3
+        WHEEL_RANGE - 2,                          // last tick of level 3
+        WHEEL_RANGE * 3 + 11, // past the range, clamped and re-queued
+    };
+    int len = sizeof(timeouts) / sizeof(*timeouts);
+    struct test_entry entries[sizeof(timeouts) / sizeof(*timeouts)];
+
+    for (int i = 0; i < len; i++) {
+        test_entry_init(&entries[i]);
+        cwc_timer_entry_schedule(&entries[i].entry, timeouts[i], 0);
+    }
+
+    // a single dispatch far in the future walks through every cascade
+    advance_to(start + WHEEL_RANGE * 4);
+
+    for (int i = 0; i < len; i++) {
+        CHECK(entries[i].fired == 1);
+        CHECK(entries[i].fired_at == start + timeouts[i]);
+        CHECK(entries[i].order == i);
+    }
+    CHECK(wheel.active == 0);
+}
+
+static void slack_test()
+{
+    reset_wheel(10003);
+
+    struct test_entry a, b;
+    test_entry_init(&a);
+    test_entry_init(&b);
+
+    // both are rounded up to the same 100ms boundary
+    cwc_timer_entry_schedule(&a.entry, 20, 100);
+    cwc_timer_entry_schedule(&b.entry, 60, 100);
+    advance_by(200);
+
+    CHECK(a.fired_at == 10100 && b.fired_at == 10100);
+}
+
+static void reschedule_in_notify_test()
+{
+    reset_wheel(123456);
+
+    struct test_entry t;
+    test_entry_init(&t);
+    t.reschedule = 9;
+    t.interval   = 10;
+
+    // the reschedule is relative to the clock so step like a punctual loop
+    cwc_timer_entry_schedule(&t.entry, 10, 0);
+    for (int i = 0; i < 1000; i++)
+        advance_by(1);
+
+    CHECK(t.fired == 10);
+    CHECK(t.fired_at == 123456 + 100);
+    CHECK(wheel.active == 0);
+
+    // zero timeout from the notify must not fire again in the same tick
+    test_entry_init(&t);
+    t.reschedule = 1;
+    t.interval   = 0;
+    cwc_timer_entry_schedule(&t.entry, 5, 0);
+    advance_by(5);
+    CHECK(t.fired == 1);
+    advance_by(1);
+    CHECK(t.fired == 2);
+}
+
+#define STRESS_COUNT 2000
+
+static void stress_test()
+{
+    reset_wheel(777);
+    srand(42);
+
+    static struct test_entry entries[STRESS_COUNT];
+    uint64_t expected[STRESS_COUNT];
+
+    for (int i = 0; i < STRESS_COUNT; i++) {
+        test_entry_init(&entries[i]);
+
+        uint32_t timeout = rand() % 3 ? rand() % 5000 : rand() % 3000000;
+        uint32_t slack   = rand() % 4 ? 0 : rand() % 50;
+        cwc_timer_entry_schedule(&entries[i].entry, timeout, slack);
+        expected[i] = entries[i].entry.expires;
+
+        // cancel a few of them
+        if (rand() % 10 == 0) {
+            cwc_timer_entry_cancel(&entries[i].entry);
+            expected[i] = 0;
+        }
+
+        // schedule while the clock moves so the insert isn't always aligned
+        if (rand() % 8 == 0)
+            advance_by(rand() % 3);
+    }
+
+    while (wheel.active)
+        advance_by(1 + rand() % 20000);
+
+    for (int i = 0; i < STRESS_COUNT; i++) {
+        if (!expected[i]) {
+            CHECK(entries[i].fired == 0);
+            continue;
+        }
+
+        CHECK(entries[i].fired == 1);
+        CHECK(entries[i].fired_at == expected[i]);
+    }
+
+    for (int i = 0; i < STRESS_COUNT; i++)
+        for (int j = 0; j < STRESS_COUNT; j++)
+            if (expected[i] && expected[j] && expected[i] < expected[j])
+                CHECK(entries[i].order < entries[j].order);
+}
+
+int main()
+{
+    struct cwc_server s = {0};
+    s.wl_event_loop     = wl_event_loop_create();
+
+    fake_now_ms = 1;
+    setup_timer_wheel(&s);
+
+    insert_and_order_test();
+    cancel_test();
+    slack_test();
+    reschedule_in_notify_test();
+
+    // start at a few places so the cascade also happen across the wrap of
+    // each level
+    cascade_test(100000);
+    cascade_test(WHEEL_SIZE - 1);
+    cascade_test(WHEEL_SIZE * WHEEL_SIZE * WHEEL_SIZE - 2);
+    cascade_test(WHEEL_RANGE - 3);
+    cascade_test(WHEEL_RANGE * 5 + 17);
+
+    stress_test();
+
+    cleanup_timer_wheel(&s);
+    wl_event_loop_destroy(s.wl_event_loop);
+
+    puts("OK");
+    return 0;
+}
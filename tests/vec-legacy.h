@@ -0,0 +1,24 @@
+#ifndef _CWC_TESTS_VEC_LEGACY_H
+#define _CWC_TESTS_VEC_LEGACY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct legacy_vec {
+    uint64_t count;
+    uint64_t alloc;
+    uint64_t elem_sizeof;
+    void *data;
+};
+
+struct legacy_vec *legacy_vec_create(int elem_sizeof, int reserved);
+void legacy_vec_destroy(struct legacy_vec *vec);
+bool legacy_vec_push(struct legacy_vec *vec, void *data);
+bool legacy_vec_push_at(struct legacy_vec *vec, size_t idx, void *data);
+void legacy_vec_pop(struct legacy_vec *vec);
+void legacy_vec_pop_at(struct legacy_vec *vec, size_t idx);
+void *legacy_vec_at(struct legacy_vec *vec, size_t idx);
+int legacy_vec_find(struct legacy_vec *vec, void *value);
+
+#endif // !_CWC_TESTS_VEC_LEGACY_H
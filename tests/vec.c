@@ -1,78 +1,306 @@
-#include <assert.h>
+/* vector test, run with `bench [vector_size]` to compare the typed vector with
+ * the previous size switched cwc_vec instead.
+ */
+
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "cwc/util.h"
+#include "vec-legacy.h"
+
+/* assert is compiled out in the release build, this one stays */
+#define CHECK(cond)                                                \
+    do {                                                           \
+        if (!(cond)) {                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, \
+                    __LINE__, #cond);                              \
+            exit(1);                                               \
+        }                                                          \
+    } while (0)
+
+CWC_VEC_DEFINE_SCALAR(int_vec, int, 4)
+CWC_VEC_DEFINE_SCALAR(u8_vec, uint8_t, 4)
+CWC_VEC_DEFINE_SCALAR(i16_vec, int16_t, 4)
+CWC_VEC_DEFINE_SCALAR(u64_vec, uint64_t, 4)
+CWC_VEC_DEFINE_SCALAR(ptr_vec, void *, 4)
+
+struct point {
+    int x, y;
+};
+CWC_VEC_DEFINE(point_vec, struct point, 2)
 
 static void functional_test()
 {
-    struct cwc_vec *vec = cwc_vec_create(sizeof(int), 10);
-
-    cwc_vec_push(vec, (void *)INT_MAX);
-    assert((int)(intptr_t)cwc_vec_at(vec, 0) == INT_MAX);
-    cwc_vec_pop(vec);
-
-    cwc_vec_push(vec, (void *)0x20);
-    assert((int)(intptr_t)cwc_vec_at(vec, 0) == 0x20);
-
-    cwc_vec_push(vec, (void *)INT_MIN);
-    assert((int)(intptr_t)cwc_vec_at(vec, 1) == INT_MIN);
-
-    cwc_vec_push(vec, (void *)0xffffffffffffffff);
-    assert((int)(intptr_t)cwc_vec_at(vec, 2) == -1);
-
-    cwc_vec_push_at(vec, 1, (void *)300);
-    printf("%d\n", (int)(intptr_t)cwc_vec_at(vec, 1));
-    assert((int)(intptr_t)cwc_vec_at(vec, 0) == 0x20);
-    assert((int)(intptr_t)cwc_vec_at(vec, 1) == 300);
-    assert((int)(intptr_t)cwc_vec_at(vec, 2) == INT_MIN);
-    assert((int)(intptr_t)cwc_vec_at(vec, 3) == -1);
-    assert(cwc_vec_find(vec, (void *)INT_MIN) == 2);
-    assert(vec->count == 4);
-
-    cwc_vec_pop_at(vec, 1);
-    assert((int)(intptr_t)cwc_vec_at(vec, 0) == 0x20);
-    assert((int)(intptr_t)cwc_vec_at(vec, 1) == INT_MIN);
-    assert((int)(intptr_t)cwc_vec_at(vec, 2) == -1);
-    assert(cwc_vec_find(vec, (void *)-1) == 2);
-    assert(vec->count == 3);
-
-    cwc_vec_destroy(vec);
+    struct int_vec vec;
+    int_vec_init(&vec);
+
+    int_vec_push(&vec, INT_MAX);
+    CHECK(*int_vec_at(&vec, 0) == INT_MAX);
+    int popped = int_vec_pop(&vec);
+    CHECK(popped == INT_MAX);
+
+    int_vec_push(&vec, 0x20);
+    CHECK(*int_vec_at(&vec, 0) == 0x20);
+
+    int_vec_push(&vec, INT_MIN);
+    CHECK(*int_vec_at(&vec, 1) == INT_MIN);
+
+    int_vec_push(&vec, -1);
+    CHECK(*int_vec_at(&vec, 2) == -1);
+
+    int_vec_insert(&vec, 1, 300);
+    CHECK(vec.data[0] == 0x20);
+    CHECK(vec.data[1] == 300);
+    CHECK(vec.data[2] == INT_MIN);
+    CHECK(vec.data[3] == -1);
+    CHECK(int_vec_find(&vec, INT_MIN) == 2);
+    CHECK(vec.count == 4);
+    CHECK(vec.data == vec.inline_data);
+
+    // fifth element move it to the heap
+    int_vec_insert(&vec, 0, 7);
+    CHECK(vec.data != vec.inline_data);
+    CHECK(vec.data[0] == 7);
+    CHECK(vec.data[4] == -1);
+
+    int_vec_erase(&vec, 0);
+    int_vec_erase(&vec, 1);
+    CHECK(vec.data[0] == 0x20);
+    CHECK(vec.data[1] == INT_MIN);
+    CHECK(vec.data[2] == -1);
+    CHECK(int_vec_find(&vec, -1) == 2);
+    CHECK(int_vec_find(&vec, 300) == -1);
+    CHECK(vec.count == 3);
+
+    int sum = 0;
+    int *elem;
+    cwc_vec_for_each(elem, &vec)
+    {
+        sum += *elem == INT_MIN ? 0 : *elem;
+    }
+    CHECK(sum == 0x20 - 1);
+
+    int_vec_fini(&vec);
+    CHECK(vec.count == 0 && vec.data == vec.inline_data);
+
+    struct point_vec points;
+    point_vec_init(&points);
+    for (int i = 0; i < 100; i++)
+        point_vec_push(&points, (struct point){i, -i});
+    point_vec_erase(&points, 50);
+    CHECK(points.count == 99);
+    CHECK(points.data[50].x == 51 && points.data[98].y == -99);
+    point_vec_fini(&points);
+
     puts("Functional test passed");
 }
 
-static void fill_shrink_test()
+/* every length and position so the match land in the vector group, across
+ * the group boundary, and in the scalar tail
+ */
+#define FIND_TEST(vec_name, type, a, b)                                        \
+    do {                                                                       \
+        struct vec_name vec;                                                   \
+        vec_name##_init(&vec);                                                 \
+        for (int len = 0; len < 70; len++) {                                   \
+            vec_name##_clear(&vec);                                            \
+            for (int i = 0; i < len; i++)                                      \
+                vec_name##_push(&vec, (type)(a));                              \
+            CHECK(vec_name##_find(&vec, (type)(b)) == -1);                     \
+            for (int i = 0; i < len; i++) {                                    \
+                vec.data[i] = (type)(b);                                       \
+                CHECK(vec_name##_find(&vec, (type)(b)) == i);                  \
+                vec.data[i] = (type)(a);                                       \
+            }                                                                  \
+        }                                                                      \
+        vec_name##_fini(&vec);                                                 \
+    } while (0)
+
+static void find_test()
+{
+    FIND_TEST(u8_vec, uint8_t, 1, 0xff);
+    FIND_TEST(i16_vec, int16_t, -1, -2);
+    FIND_TEST(int_vec, int, INT_MIN, -1);
+    // only one 32-bit half match
+    FIND_TEST(u64_vec, uint64_t, 0x1234567800000000, 0x12345678);
+    FIND_TEST(u64_vec, uint64_t, 0x12345678, 0x1234567800000000);
+    FIND_TEST(ptr_vec, void *, &find_test, NULL);
+
+    puts("Find test passed");
+}
+
+static void fill_test()
 {
-    struct cwc_vec *vec = cwc_vec_create(sizeof(int), 1e6 + 1);
+    struct int_vec vec;
+    int_vec_init(&vec);
+    int_vec_reserve(&vec, 1e6 + 1);
 
     printf("filling vector to %d element\n", INT_MAX);
     for (size_t i = 0; i < INT_MAX; i++) {
-        if (!cwc_vec_push(vec, (void *)(intptr_t)i))
-            cwc_assert(false, "failed to push");
+        if (!int_vec_push(&vec, i))
+            cwc_CHECK(false, "failed to push");
     }
 
     puts("checking the data");
     for (size_t i = 0; i < INT_MAX; i++) {
-        assert((size_t)(uintptr_t)cwc_vec_at(vec, i) == i);
+        CHECK((size_t)*int_vec_at(&vec, i) == i);
     }
 
     puts("popping the data");
     for (size_t i = 0; i < INT_MAX; i++) {
-        cwc_vec_pop(vec);
-        // cwc_vec_pop_at(vec, 0);
+        int_vec_pop(&vec);
     }
 
-    assert(vec->count == 0);
+    CHECK(vec.count == 0);
+
+    int_vec_fini(&vec);
+}
+
+//================== BENCHMARK ====================
+
+static int VEC_SIZE;
+
+static double now_sec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* print the time per operation since start and return the new start */
+static double bench_report(const char *label, double start, int op)
+{
+    printf("  %-8s %8.2f ns/op\n", label, (now_sec() - start) * 1e9 / op);
+    return now_sec();
+}
+
+static void bench_typed(int *needles, int needle_count)
+{
+    struct int_vec vec;
+    int_vec_init(&vec);
+    volatile long sum = 0;
+
+    puts("typed");
 
-    cwc_vec_destroy(vec);
+    double start = now_sec();
+    for (int i = 0; i < VEC_SIZE; i++)
+        int_vec_push(&vec, i);
+    start = bench_report("push", start, VEC_SIZE);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        sum += *int_vec_at(&vec, i);
+    start = bench_report("at", start, VEC_SIZE);
+
+    for (int i = 0; i < needle_count; i++)
+        sum += int_vec_find(&vec, needles[i]);
+    start = bench_report("find", start, needle_count);
+
+    for (int i = 0; i < needle_count; i++) {
+        int_vec_erase(&vec, needles[i] % VEC_SIZE);
+        int_vec_insert(&vec, needles[i] % VEC_SIZE, i);
+    }
+    start = bench_report("shift", start, needle_count);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        int_vec_pop(&vec);
+    bench_report("pop", start, VEC_SIZE);
+
+    int_vec_fini(&vec);
+}
+
+static void bench_scalar_find(int *needles, int needle_count)
+{
+    int *data         = malloc(VEC_SIZE * sizeof(*data));
+    volatile long sum = 0;
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        data[i] = i;
+
+    puts("scalar loop");
+
+    double start = now_sec();
+    for (int i = 0; i < needle_count; i++) {
+        int idx = -1;
+        for (int j = 0; j < VEC_SIZE; j++) {
+            if (data[j] == needles[i]) {
+                idx = j;
+                break;
+            }
+        }
+        sum += idx;
+    }
+    bench_report("find", start, needle_count);
+
+    free(data);
+}
+
+static void bench_legacy(int *needles, int needle_count)
+{
+    struct legacy_vec *vec = legacy_vec_create(sizeof(int), 4);
+    volatile long sum      = 0;
+
+    puts("legacy");
+
+    double start = now_sec();
+    for (int i = 0; i < VEC_SIZE; i++)
+        legacy_vec_push(vec, (void *)(intptr_t)i);
+    start = bench_report("push", start, VEC_SIZE);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        sum += (intptr_t)legacy_vec_at(vec, i);
+    start = bench_report("at", start, VEC_SIZE);
+
+    for (int i = 0; i < needle_count; i++)
+        sum += legacy_vec_find(vec, (void *)(intptr_t)needles[i]);
+    start = bench_report("find", start, needle_count);
+
+    for (int i = 0; i < needle_count; i++) {
+        legacy_vec_pop_at(vec, needles[i] % VEC_SIZE);
+        legacy_vec_push_at(vec, needles[i] % VEC_SIZE, (void *)(intptr_t)i);
+    }
+    start = bench_report("shift", start, needle_count);
+
+    for (int i = 0; i < VEC_SIZE; i++)
+        legacy_vec_pop(vec);
+    bench_report("pop", start, VEC_SIZE);
+
+    legacy_vec_destroy(vec);
+}
+
+static int bench_main(int size)
+{
+    VEC_SIZE = size > 0 ? size : 1;
+
+    // keep the find work roughly constant regardless the vector size
+    int needle_count = 100000000 / VEC_SIZE + 1;
+    int *needles     = malloc(needle_count * sizeof(*needles));
+
+    // a quarter of the needles is missing
+    srand(69);
+    for (int i = 0; i < needle_count; i++)
+        needles[i] = rand() % (VEC_SIZE + VEC_SIZE / 3 + 1);
+
+    printf("%d element, %d lookup\n\n", VEC_SIZE, needle_count);
+    bench_typed(needles, needle_count);
+    bench_legacy(needles, needle_count);
+    bench_scalar_find(needles, needle_count);
+
+    free(needles);
+    return 0;
 }
 
-int main()
+int main(int argc, char **argv)
 {
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return bench_main(argc > 2 ? atoi(argv[2]) : 1000);
 
     functional_test();
-    fill_shrink_test();
+    find_test();
+    fill_test();
 
     puts("OK");
     return 0;